@@ -0,0 +1,133 @@
+#include "alloc.h"
+#include "perf_counters.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*!
+    \file bench.c
+    \brief Бенчмарки аллокатора
+
+    Для каждого случая выводится время на операцию (нс/оп). С ключом --perf
+    под строкой выводятся аппаратные счетчики на операцию; недоступные
+    счетчики выводятся как n/a.
+*/
+
+//! Количество пар выделения и освобождения
+#define PAIRS 1000000
+//! Количество повторов заполнения кучи
+#define FILLS 200
+//! Наибольшее количество блоков в куче
+#define MAX_BLOCKS (PAGE_COUNT * SMALL_SEGMENTS)
+
+//! Аппаратные счетчики
+static perf_counters perf;
+//! Счетчики открыты
+static bool perf_enabled = false;
+//! Время начала случая
+static struct timespec case_begin;
+//! Выделенные блоки
+static void* blocks[MAX_BLOCKS];
+
+/*!
+    \brief Начать измеряемый случай: запуск счетчиков и отметка времени
+*/
+static void start_case() {
+    if (perf_enabled) {
+        perf_counters_start(&perf);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &case_begin);
+}
+/*!
+    \brief Вывести значение счетчика на операцию или n/a
+*/
+static void print_counter(const perf_sample* sample, perf_counter_t index, const char* unit, uint64_t ops) {
+    if (sample->valid[index]) {
+        printf(" %10.1f %s", (double)sample->values[index] / ops, unit);
+    } else {
+        printf(" %10s %s", "n/a", unit);
+    }
+}
+/*!
+    \brief Завершить случай и вывести результат
+    \param[in] name Название случая
+    \param[in] ops Количество операций
+*/
+static void report(const char* name, uint64_t ops) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_sample sample;
+    if (perf_enabled) {
+        // Счетчики останавливаются до вывода: печать и подготовка следующего случая не учитываются
+        perf_counters_stop(&perf);
+        sample = perf_counters_read(&perf);
+    }
+    double ns = (double)(end.tv_sec - case_begin.tv_sec) * 1e9 + (double)(end.tv_nsec - case_begin.tv_nsec);
+    printf("%-28s %10llu ops %10.1f ns/op\n", name, (unsigned long long)ops, ns / ops);
+    if (!perf_enabled) {
+        return;
+    }
+    printf("%-28s", "  perf");
+    print_counter(&sample, PERF_CYCLES, "cycles/op", ops);
+    print_counter(&sample, PERF_INSTRUCTIONS, "instr/op", ops);
+    print_counter(&sample, PERF_BRANCH_MISSES, "br-miss/op", ops);
+    print_counter(&sample, PERF_L1D_MISSES, "L1d-miss/op", ops);
+    print_counter(&sample, PERF_LLC_MISSES, "LLC-miss/op", ops);
+    printf("\n");
+}
+/*!
+    \brief Выделить и сразу освободить блок
+    \param[in] name Название случая
+    \param[in] size Размер блока
+*/
+static void bench_pairs(const char* name, size_t size) {
+    alloc_init();
+    start_case();
+    for (uint32_t i = 0; i < PAIRS; i++) {
+        void* ptr = custom_malloc(size);
+        custom_free(ptr);
+    }
+    report(name, 2ull * PAIRS);
+}
+/*!
+    \brief Заполнить кучу блоками и освободить их
+
+    По мере заполнения find_free_block() просматривает все больше занятых битов
+    \param[in] name Название случая
+    \param[in] size Размер блока
+*/
+static void bench_fill(const char* name, size_t size) {
+    uint64_t ops = 0;
+    alloc_init();
+    start_case();
+    for (uint32_t r = 0; r < FILLS; r++) {
+        size_t count = 0;
+        while (count < MAX_BLOCKS && (blocks[count] = custom_malloc(size)) != NULL) {
+            count++;
+        }
+        for (size_t i = 0; i < count; i++) {
+            custom_free(blocks[i]);
+        }
+        ops += 2 * count + 1;
+    }
+    report(name, ops);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            perf_enabled = perf_counters_open(&perf);
+            if (!perf_enabled) {
+                printf("perf counters unavailable, reporting wall-clock time only\n");
+            }
+        }
+    }
+    bench_pairs("malloc/free small pair", BLOCK_SMALL);
+    bench_pairs("malloc/free big pair", BLOCK_BIG);
+    bench_fill("fill/free small heap", BLOCK_SMALL);
+    bench_fill("fill/free big heap", BLOCK_BIG);
+    if (perf_enabled) {
+        perf_counters_close(&perf);
+    }
+    return 0;
+}
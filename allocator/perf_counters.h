@@ -0,0 +1,174 @@
+/*!
+    \file perf_counters.h
+    \brief Аппаратные счетчики производительности для бенчмарка аллокатора
+
+    Счетчики тактов, инструкций, промахов предсказания переходов, промахов
+    чтения L1 данных и кэша последнего уровня через perf_event_open.
+    Считается только вызывающий поток в пользовательском режиме. Счетчик,
+    который недоступен (виртуальная машина, контейнер, не Linux),
+    помечается как недоступный, остальные работают. Значения считаются от
+    perf_counters_start() до perf_counters_stop() или perf_counters_read():
+    запуск запоминает значение и время счетчика, чтение возвращает разность.
+*/
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//! Счетчики
+typedef enum {
+    PERF_CYCLES,        ///< Такты
+    PERF_INSTRUCTIONS,  ///< Инструкции
+    PERF_BRANCH_MISSES, ///< Промахи предсказания переходов
+    PERF_L1D_MISSES,    ///< Промахи чтения L1 данных
+    PERF_LLC_MISSES,    ///< Промахи чтения кэша последнего уровня
+    PERF_COUNTERS       ///< Количество счетчиков
+} perf_counter_t;
+
+//! Набор счетчиков
+typedef struct {
+    int fds[PERF_COUNTERS];             ///< Дескрипторы (-1 - недоступен)
+    uint64_t base[PERF_COUNTERS][3];    ///< Значение, время включения и время работы на момент запуска
+} perf_counters;
+
+//! Значения счетчиков
+typedef struct {
+    uint64_t values[PERF_COUNTERS];     ///< Значения
+    bool valid[PERF_COUNTERS];          ///< Счетчик доступен
+} perf_sample;
+
+/*!
+    \brief Открыть счетчики (остановленными)
+    \param[out] counters Набор счетчиков
+    \return true - доступен хотя бы один счетчик
+*/
+static bool perf_counters_open(perf_counters* counters) {
+    bool any = false;
+    memset(counters->base, 0, sizeof(counters->base));
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        counters->fds[i] = -1;
+    }
+#ifdef __linux__
+    const uint32_t types[PERF_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                           PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+    const uint64_t configs[PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        any = any || counters->fds[i] >= 0;
+    }
+#endif
+    return any;
+}
+/*!
+    \brief Закрыть счетчики
+    \param[in] counters Набор счетчиков
+*/
+static void perf_counters_close(perf_counters* counters) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+#ifdef __linux__
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+        }
+#endif
+        counters->fds[i] = -1;
+    }
+}
+/*!
+    \brief Прочитать значение, время включения и время работы счетчика
+    \param[in] fd Дескриптор счетчика
+    \param[out] raw Значения
+    \return true - успешно
+*/
+static bool perf_counter_read_raw(int fd, uint64_t raw[3]) {
+#ifdef __linux__
+    return fd >= 0 && read(fd, raw, 3 * sizeof(uint64_t)) == (ssize_t)(3 * sizeof(uint64_t));
+#else
+    (void)fd;
+    (void)raw;
+    return false;
+#endif
+}
+/*!
+    \brief Запустить счетчики и запомнить их значения (начало случая)
+
+    Значения запоминаются до включения, поэтому чтение остальных счетчиков
+    не попадает в случай
+    \param[in] counters Набор счетчиков
+*/
+static void perf_counters_start(perf_counters* counters) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (!perf_counter_read_raw(counters->fds[i], counters->base[i])) {
+            memset(counters->base[i], 0, sizeof(counters->base[i]));
+        }
+    }
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+/*!
+    \brief Остановить счетчики (время между случаями не учитывается)
+    \param[in] counters Набор счетчиков
+*/
+static void perf_counters_stop(const perf_counters* counters) {
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#else
+    (void)counters;
+#endif
+}
+/*!
+    \brief Прочитать значения с момента запуска
+
+    При мультиплексировании разность масштабируется по доле времени случая,
+    когда счетчик был активен
+    \param[in] counters Набор счетчиков
+    \return Значения счетчиков
+*/
+static perf_sample perf_counters_read(const perf_counters* counters) {
+    perf_sample sample;
+    memset(&sample, 0, sizeof(sample));
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        uint64_t raw[3];
+        if (!perf_counter_read_raw(counters->fds[i], raw)) {
+            continue;
+        }
+        uint64_t value = raw[0] - counters->base[i][0];
+        uint64_t enabled = raw[1] - counters->base[i][1];
+        uint64_t running = raw[2] - counters->base[i][2];
+        if (running == 0) {
+            continue;
+        }
+        sample.values[i] = running < enabled ? (uint64_t)((double)value * enabled / running) : value;
+        sample.valid[i] = true;
+    }
+    return sample;
+}
+#endif
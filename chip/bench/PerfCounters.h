@@ -0,0 +1,155 @@
+/*!
+    \file PerfCounters.h
+    \brief Аппаратные счетчики производительности для бенчмарков (perf_event_open)
+*/
+#pragma once
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+/*!
+    \class PerfCounters
+    \brief Счетчики тактов, инструкций, промахов предсказания переходов и кэшей
+
+    Считается только вызывающий поток и только пользовательский режим, поэтому
+    достаточно perf_event_paranoid <= 2. Счетчик, который ядро или
+    процессор не поддерживают (виртуальная машина, контейнер, не Linux),
+    помечается недоступным, остальные работают. Значения считаются от start()
+    до stop() или read(): запуск запоминает значение и время счетчика, чтение
+    возвращает разность. При мультиплексировании разность масштабируется по
+    доле времени случая, когда счетчик был активен.
+*/
+class PerfCounters{
+    public:
+    //! Счетчики
+    enum counter : uint8_t{
+        CYCLES,                     ///<Такты
+        INSTRUCTIONS,               ///<Инструкции
+        BRANCH_MISSES,              ///<Промахи предсказания переходов
+        L1D_MISSES,                 ///<Промахи чтения L1 данных
+        LLC_MISSES,                 ///<Промахи чтения кэша последнего уровня
+        COUNT                       ///<Количество счетчиков
+    };
+    //! Значения счетчиков
+    struct sample{
+        uint64_t values[COUNT] {};  ///<Значения
+        bool valid[COUNT] {};       ///<Счетчик доступен
+    };
+
+    private:
+    //! Дескрипторы счетчиков (-1 - недоступен)
+    int _fds[COUNT];
+    //! Значение, время включения и время работы счетчиков на момент start()
+    uint64_t _base[COUNT][3] {};
+
+    //! Прочитать значение, время включения и время работы счетчика
+    static bool readRaw(int fd, uint64_t raw[3]){
+#ifdef __linux__
+        return fd >= 0 && ::read(fd, raw, 3 * sizeof(uint64_t)) == static_cast<ssize_t>(3 * sizeof(uint64_t));
+#else
+        (void)fd; (void)raw;
+        return false;
+#endif
+    }
+
+    public:
+    PerfCounters(){
+        for (int& fd : _fds) { fd = -1; }
+    }
+    ~PerfCounters(){ close(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    /*!
+        Открыть счетчики (остановленными)
+        \return true - доступен хотя бы один счетчик
+    */
+    bool open(){
+        close();
+#ifdef __linux__
+        const uint32_t types[COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                       PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+        const uint64_t configs[COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        for (uint8_t i{0}; i < COUNT; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            _fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+        return available();
+    }
+    //! Закрыть счетчики
+    void close(){
+        for (int& fd : _fds) {
+#ifdef __linux__
+            if (fd >= 0) { ::close(fd); }
+#endif
+            fd = -1;
+        }
+    }
+    //! Доступен ли хотя бы один счетчик
+    bool available() const{
+        for (int fd : _fds) {
+            if (fd >= 0) { return true; }
+        }
+        return false;
+    }
+    //! Запустить счетчики и запомнить их значения (начало случая)
+    void start(){
+#ifdef __linux__
+        //! Значения запоминаются до включения: чтение остальных счетчиков не попадает в случай
+        for (uint8_t i{0}; i < COUNT; i++) {
+            if (!readRaw(_fds[i], _base[i])) {
+                std::memset(_base[i], 0, sizeof(_base[i]));
+            }
+        }
+        for (int fd : _fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+    //! Остановить счетчики (время между случаями не учитывается)
+    void stop(){
+#ifdef __linux__
+        for (int fd : _fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+#endif
+    }
+    //! Значения с момента start()
+    sample read() const{
+        sample result;
+        for (uint8_t i{0}; i < COUNT; i++) {
+            uint64_t raw[3];
+            if (!readRaw(_fds[i], raw)) {
+                continue;
+            }
+            uint64_t value = raw[0] - _base[i][0];
+            uint64_t enabled = raw[1] - _base[i][1];
+            uint64_t running = raw[2] - _base[i][2];
+            if (running == 0) {
+                continue;
+            }
+            result.values[i] = running < enabled ? static_cast<uint64_t>(double(value) * enabled / running) : value;
+            result.valid[i] = true;
+        }
+        return result;
+    }
+};
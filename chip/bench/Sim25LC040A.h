@@ -0,0 +1,114 @@
+/*!
+    \file Sim25LC040A.h
+    \brief Программная модель EEPROM 25LC040A для бенчмарков
+*/
+#pragma once
+#include "Driver.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class Sim25LC040A
+    \brief Программная модель EEPROM 25LC040A, подключаемая вместо SPI драйвера
+
+    512 байт, страница 16 байт, 9-й бит адреса в инструкции. Поддерживает
+    чтение, страничную запись (адрес заворачивается внутри страницы), WREN/WRDI
+    и регистр состояния. Считает циклы записи и моделирует время работы:
+    передачу байт по шине и время цикла записи.
+*/
+class Sim25LC040A : public IDriver{
+    public:
+    //! Объем (байты)
+    static constexpr uint32_t CAPACITY = 512;
+    //! Размер страницы (байты)
+    static constexpr uint32_t PAGE_SIZE = 16;
+    //! Время передачи одного байта при частоте шины 10 МГц (нс)
+    static constexpr uint64_t BYTE_NS = 800;
+    //! Время цикла записи (нс)
+    static constexpr uint64_t WRITE_CYCLE_NS = 5000000;
+    //! Счетчики операций
+    struct counters{
+        uint64_t transactions {0};  ///<Количество транзакций (select..deselect)
+        uint64_t bytes {0};         ///<Передано байт по шине
+        uint64_t writeCycles {0};   ///<Выполнено циклов записи
+        uint64_t deviceNs {0};      ///<Модельное время работы (нс)
+    };
+
+    private:
+    std::vector<uint8_t> _memory;
+    counters _counters;
+    uint8_t _command {0};
+    uint32_t _index {0};
+    uint32_t _address {0};
+    bool _wel {false};
+    bool _busy {false};
+    //! Моделируется отключение питания
+    bool _powerFail {false};
+    //! Сколько байт еще будет записано до отключения питания
+    uint32_t _remaining {0};
+
+    public:
+    Sim25LC040A() : _memory(CAPACITY, 0xFF) {}
+    //! Счетчики операций
+    const counters& stats() const { return _counters; }
+    //! Сбросить счетчики
+    void resetStats() { _counters = counters{}; }
+    //! Содержимое памяти
+    const uint8_t* data() const { return _memory.data(); }
+    /*!
+        Смоделировать отключение питания: после bytes записанных байт все
+        следующие записи теряются
+        \param[in] bytes Количество байт до отключения (0 - отключения нет)
+    */
+    void failAfter(uint32_t bytes) { _powerFail = bytes != 0; _remaining = bytes; }
+
+    void select() override {
+        _index = 0;
+        _address = 0;
+        _counters.transactions++;
+    }
+    void deselect() override {
+        switch (_command & 0xF7) {
+            case 0x06: _wel = true; break;
+            case 0x04: _wel = false; break;
+            case 0x02:
+                if (_wel && _index > 2) {
+                    _counters.writeCycles++;
+                    _counters.deviceNs += WRITE_CYCLE_NS;
+                    _busy = true;
+                    _wel = false;
+                }
+                break;
+            default: break;
+        }
+    }
+    uint8_t transfer(uint8_t byte) override {
+        _counters.bytes++;
+        _counters.deviceNs += BYTE_NS;
+        uint8_t out = 0xFF;
+        if (_index == 0) {
+            _command = byte;
+            _address = (byte & 0x08) ? 0x100 : 0;
+        } else if (_command == 0x05) {
+            //! Цикл записи завершается к моменту очередного опроса, его время уже учтено
+            out = (_busy ? 0x01 : 0x00) | (_wel ? 0x02 : 0x00);
+            _busy = false;
+        } else if (_index == 1) {
+            _address |= byte;
+        } else {
+            uint32_t offset = _index - 2;
+            switch (_command & 0xF7) {
+                case 0x03: out = _memory[(_address + offset) % CAPACITY]; break;
+                case 0x02:
+                    if (_wel && (!_powerFail || _remaining > 0)) {
+                        uint32_t page = _address & ~(PAGE_SIZE - 1);
+                        _memory[page + ((_address + offset) & (PAGE_SIZE - 1))] = byte;
+                        _remaining -= _powerFail;
+                    }
+                    break;
+                default: break;
+            }
+        }
+        _index++;
+        return out;
+    }
+};
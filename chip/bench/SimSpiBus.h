@@ -0,0 +1,38 @@
+/*!
+    \file SimSpiBus.h
+    \brief Программная модель общей шины SPI для бенчмарков
+*/
+#pragma once
+#include "SharedSpiBus.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class SimSpiBus
+    \brief Физическая шина SPI, к линиям CS которой подключены модели микросхем
+
+    Линия CS с номером i управляет select()/deselect() i-й модели,
+    байты передаются выбранной модели.
+*/
+class SimSpiBus : public ISpiBus{
+    std::vector<IDriver*> _devices;
+    IDriver* _selected {nullptr};
+
+    public:
+    /*!
+        Конструктор
+        \param[in] devices Модели микросхем по номерам линий CS
+    */
+    explicit SimSpiBus(std::vector<IDriver*> devices) : _devices(std::move(devices)) {}
+    void setChipSelect(uint8_t line, bool active) override {
+        if (active) {
+            _selected = _devices.at(line);
+            _selected->select();
+        } else {
+            _devices.at(line)->deselect();
+            _selected = nullptr;
+        }
+    }
+    uint8_t transfer(uint8_t byte) override {
+        return _selected != nullptr ? _selected->transfer(byte) : 0xFF;
+    }
+};
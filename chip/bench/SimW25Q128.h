@@ -0,0 +1,179 @@
+/*!
+    \file SimW25Q128.h
+    \brief Программная модель NOR Flash W25Q128 для бенчмарков
+*/
+#pragma once
+#include "Driver.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+/*!
+    \class SimW25Q128
+    \brief Программная модель NOR Flash W25Q128, подключаемая вместо SPI драйвера
+
+    Поддерживает чтение, быструю запись, страничную запись (только 1 -> 0),
+    стирание сектора/блока/чипа, регистр состояния, JEDEC ID и таблицу SFDP
+    (JESD216B) с параметрами W25Q128 и заданным объемом. Объем больше 16 Мбайт
+    адресуется 4 байтами: инструкциями 0x13/0x0C/0x12/0x21/0x5C/0xDC или в
+    режиме 0xB7 (выход - 0xE9). Считает операции и
+    моделирует время работы микросхемы: передачу байт по шине и типовые
+    времена записи и стирания из документации.
+*/
+class SimW25Q128 : public IDriver{
+    public:
+    //! Время передачи одного байта при частоте шины 50 МГц (нс)
+    static constexpr uint64_t BYTE_NS = 160;
+    //! Типовое время записи страницы (нс)
+    static constexpr uint64_t PAGE_PROGRAM_NS = 700000;
+    //! Типовое время стирания сектора 4 Кбайт (нс)
+    static constexpr uint64_t SECTOR_ERASE_NS = 45000000;
+    //! Типовое время стирания блока 32 Кбайт (нс)
+    static constexpr uint64_t BLOCK_32K_ERASE_NS = 120000000;
+    //! Типовое время стирания блока 64 Кбайт (нс)
+    static constexpr uint64_t BLOCK_64K_ERASE_NS = 150000000;
+    //! Счетчики операций
+    struct counters{
+        uint64_t transactions {0};  ///<Количество транзакций (select..deselect)
+        uint64_t bytes {0};         ///<Передано байт по шине
+        uint64_t programs {0};      ///<Выполнено страничных записей
+        uint64_t erases {0};        ///<Выполнено стираний
+        uint64_t deviceNs {0};      ///<Модельное время работы (нс)
+    };
+
+    private:
+    std::vector<uint8_t> _memory;
+    std::vector<uint8_t> _sfdp;
+    counters _counters;
+    uint8_t _command {0};
+    uint32_t _index {0};
+    uint32_t _address {0};
+    bool _wel {false};
+    bool _busy {false};
+    bool _fourByteMode {false};
+
+    //! Количество байт адреса инструкции
+    uint32_t addressBytes() const {
+        switch (_command) {
+            case 0x13: case 0x0C: case 0x12: case 0x21: case 0x5C: case 0xDC: return 4;
+            case 0x5A: return 3;
+            default: return _fourByteMode ? 4 : 3;
+        }
+    }
+
+    void erase(uint32_t size, uint64_t ns){
+        uint32_t base = _address & ~(size - 1) & (_memory.size() - 1);
+        std::memset(&_memory[base], 0xFF, size);
+        _counters.erases++;
+        _counters.deviceNs += ns;
+        _busy = true;
+    }
+
+    public:
+    /*!
+        Конструктор
+        \param[in] capacity Объем памяти (степень двойки, байты)
+        \param[in] fourByteOpcodes Объявлять в SFDP отдельные инструкции с адресом 4 байта
+    */
+    explicit SimW25Q128(uint32_t capacity = 16u * 1024u * 1024u, bool fourByteOpcodes = true) : _memory(capacity, 0xFF) {
+        bool wide = capacity > 16u * 1024u * 1024u;
+        //! Заголовок SFDP, один заголовок параметров, основная таблица из 16 слов по адресу 0x10
+        const uint32_t table[16] {
+            wide ? 0xFFFB20E5 : 0xFFF920E5, //!< стирание 4К инструкцией 0x20, адрес 3 или 3/4 байта
+            capacity * 8 - 1,       //!< объем в битах минус 1
+            0x6B08EB44, 0xBB423B08, 0xFFFFFFFE, 0xFF00FFFF, 0xEB40FFFF,
+            0x520F200C,             //!< стирание 4К (0x20) и 32К (0x52)
+            0xFF00D810,             //!< стирание 64К (0xD8)
+            0x00A60220,             //!< времена стирания: 48 мс, 128 мс, 160 мс
+            0x4C002A82,             //!< страница 256 байт, запись 704 мкс, стирание чипа 52 с
+            0xD9A0CC34, 0x7A75AE7A, 0x757A7EEC, 0x5CD5E6F7,
+            (wide ? (fourByteOpcodes ? 0x21000000u : 0x01000000u) : 0u) | 0x000FF000u //!< переход в адрес 4 байта
+        };
+        _sfdp = {'S', 'F', 'D', 'P', 0x06, 0x01, 0x00, 0xFF, 0x00, 0x06, 0x01, 0x10, 0x10, 0x00, 0x00, 0xFF};
+        for (uint32_t word : table) {
+            for (uint8_t i{0}; i < 4; i++) {
+                _sfdp.push_back((word >> (8 * i)) & 0xFF);
+            }
+        }
+    }
+    //! Счетчики операций
+    const counters& stats() const { return _counters; }
+    //! Сбросить счетчики
+    void resetStats() { _counters = counters{}; }
+    //! Содержимое памяти
+    const uint8_t* data() const { return _memory.data(); }
+
+    void select() override {
+        _index = 0;
+        _address = 0;
+        _counters.transactions++;
+    }
+    void deselect() override {
+        bool addressed = _index >= 1 + addressBytes();
+        switch (_command) {
+            case 0xB7: _fourByteMode = true; break;
+            case 0xE9: _fourByteMode = false; break;
+            case 0x06: _wel = true; break;
+            case 0x04: _wel = false; break;
+            case 0x02:
+            case 0x12:
+                if (_wel && addressed) {
+                    _counters.programs++;
+                    _counters.deviceNs += PAGE_PROGRAM_NS;
+                    _busy = true;
+                    _wel = false;
+                }
+                break;
+            case 0x20: case 0x21: if (_wel && addressed) { erase(4u * 1024u, SECTOR_ERASE_NS); _wel = false; } break;
+            case 0x52: case 0x5C: if (_wel && addressed) { erase(32u * 1024u, BLOCK_32K_ERASE_NS); _wel = false; } break;
+            case 0xD8: case 0xDC: if (_wel && addressed) { erase(64u * 1024u, BLOCK_64K_ERASE_NS); _wel = false; } break;
+            case 0xC7:
+                if (_wel) {
+                    std::memset(_memory.data(), 0xFF, _memory.size());
+                    _counters.erases++;
+                    _counters.deviceNs += BLOCK_64K_ERASE_NS * (_memory.size() / (64u * 1024u));
+                    _busy = true;
+                    _wel = false;
+                }
+                break;
+            default: break;
+        }
+    }
+    uint8_t transfer(uint8_t byte) override {
+        _counters.bytes++;
+        _counters.deviceNs += BYTE_NS;
+        uint8_t out = 0xFF;
+        if (_index == 0) {
+            _command = byte;
+        } else if (_command == 0x9F) {
+            uint8_t capacity{0};
+            while ((uint32_t(1) << capacity) < _memory.size()) { capacity++; }
+            const uint8_t id[3] {0xEF, 0x40, capacity};
+            out = _index <= 3 ? id[_index - 1] : 0xFF;
+        } else if (_command == 0x05) {
+            //! Операция завершается к моменту очередного опроса, ее время уже учтено
+            out = (_busy ? 0x01 : 0x00) | (_wel ? 0x02 : 0x00);
+            _busy = false;
+        } else if (_index <= addressBytes()) {
+            _address = (_address << 8) | byte;
+        } else {
+            uint32_t offset = _index - 1 - addressBytes();
+            uint32_t mask = static_cast<uint32_t>(_memory.size() - 1);
+            switch (_command) {
+                case 0x03: case 0x13: out = _memory[(_address + offset) & mask]; break;
+                case 0x0B: case 0x0C: if (offset > 0) { out = _memory[(_address + offset - 1) & mask]; } break;
+                case 0x5A: if (offset > 0 && _address + offset - 1 < _sfdp.size()) { out = _sfdp[_address + offset - 1]; } break;
+                case 0x02:
+                case 0x12:
+                    if (_wel) {
+                        //! Адрес внутри страницы заворачивается, как в микросхеме
+                        uint32_t page = _address & ~0xFFu & mask;
+                        _memory[page + ((_address + offset) & 0xFFu)] &= byte;
+                    }
+                    break;
+                default: break;
+            }
+        }
+        _index++;
+        return out;
+    }
+};
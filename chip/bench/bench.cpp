@@ -0,0 +1,988 @@
+#include "SimW25Q128.h"
+#include "SimSpiBus.h"
+#include "Sim25LC040A.h"
+#include "25LCxxx.h"
+#include "W25Q128.h"
+#include "KVStore.h"
+#include "AppendPoint.h"
+#include "NORCounter.h"
+#include "EEPROMEmulator.h"
+#include "Storage.h"
+#include "SharedSpiBus.h"
+#include "StripedVolume.h"
+#include "MirroredVolume.h"
+#include "CompressedLog.h"
+#include "CRC32.h"
+#include "ABRecordStore.h"
+#include "NORFileSystem.h"
+#include "StorageStream.h"
+#include "NORScheduler.h"
+#include "FlashMapping.h"
+#include "ChipWorker.h"
+#include "SocketSpi.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/*!
+    Бенчмарки поверх программной модели W25Q128
+
+    Для каждого случая выводится время на операцию на хосте (нс/оп),
+    модельное время работы микросхемы на операцию (мкс/оп) и счетчики операций.
+    С ключом --perf под каждой строкой выводятся аппаратные счетчики потока,
+    запустившего случай (такты, инструкции, промахи переходов, L1 и LLC на
+    операцию); недоступные счетчики выводятся как n/a.
+*/
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+//! Аппаратные счетчики (открываются ключом --perf)
+PerfCounters perf;
+
+//! Начало измеряемого случая: запуск счетчиков и отметка времени
+clock_type::time_point startCase(){
+    perf.start();
+    return clock_type::now();
+}
+//! Значение счетчика на операцию или n/a
+void printCounter(const PerfCounters::sample& sample, PerfCounters::counter index, const char* unit, uint32_t ops){
+    if (sample.valid[index]) {
+        std::printf(" %10.1f %s", double(sample.values[index]) / ops, unit);
+    } else {
+        std::printf(" %10s %s", "n/a", unit);
+    }
+}
+
+void report(const char* name, uint32_t ops, clock_type::duration elapsed, const SimW25Q128& sim){
+    //! Счетчики останавливаются до вывода: печать и подготовка следующего случая не учитываются
+    perf.stop();
+    PerfCounters::sample sample = perf.read();
+    double hostNs = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+    double deviceUs = sim.stats().deviceNs / 1000.0 / ops;
+    std::printf("%-28s %8u ops %10.0f ns/op %10.1f us/op (device) %8llu erases %8llu programs\n",
+                name, ops, hostNs, deviceUs,
+                static_cast<unsigned long long>(sim.stats().erases),
+                static_cast<unsigned long long>(sim.stats().programs));
+    if (!perf.available()) {
+        return;
+    }
+    std::printf("%-28s", "  perf");
+    printCounter(sample, PerfCounters::CYCLES, "cycles/op", ops);
+    printCounter(sample, PerfCounters::INSTRUCTIONS, "instr/op", ops);
+    printCounter(sample, PerfCounters::BRANCH_MISSES, "br-miss/op", ops);
+    printCounter(sample, PerfCounters::L1D_MISSES, "L1d-miss/op", ops);
+    printCounter(sample, PerfCounters::LLC_MISSES, "LLC-miss/op", ops);
+    std::printf("\n");
+}
+
+//! Запись, чтение и обновление ключей журналируемого хранилища
+void benchDetect(){
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    sim.resetStats();
+    auto begin = startCase();
+    chip.detect();
+    report("detect (JEDEC ID + SFDP)", 1, clock_type::now() - begin, sim);
+    const NORW25Q128::deviceInfo& info = chip.info();
+    std::printf("%-28s %02X %02X %02X, %u bytes, page %u, sector erase %u us, page program %u us\n", "detected",
+        info.manufacturer, info.memoryType, info.capacityId, info.capacity, info.pageSize, info.erase[0].typicalUs, info.pageProgramUs);
+    if (chip.checkError() != NORW25Q128::error::OK) {
+        std::printf("detect error\n");
+    }
+}
+void benchKVStore(){
+    constexpr uint32_t KEYS = 1000;
+    constexpr uint32_t UPDATES = 20000;
+    constexpr uint16_t VALUE_SIZE = 32;
+    constexpr uint16_t SECTORS = 64;
+    constexpr uint16_t CHECKPOINT_SECTORS = 8;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    KVStore store{&chip, 0, SECTORS, CHECKPOINT_SECTORS};
+    store.format();
+    std::mt19937 rng{42};
+    uint8_t value[VALUE_SIZE];
+
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; i < KEYS; i++) {
+        for (auto& b : value) { b = static_cast<uint8_t>(rng()); }
+        store.put("key" + std::to_string(i), value, VALUE_SIZE);
+    }
+    report("kv put (insert)", KEYS, clock_type::now() - begin, sim);
+
+    sim.resetStats();
+    begin = startCase();
+    for (uint32_t i{0}; i < UPDATES; i++) {
+        for (auto& b : value) { b = static_cast<uint8_t>(rng()); }
+        store.put("key" + std::to_string(rng() % KEYS), value, VALUE_SIZE);
+    }
+    report("kv put (update)", UPDATES, clock_type::now() - begin, sim);
+    std::printf("%-28s %10.2f\n", "kv erases per 1000 updates", sim.stats().erases * 1000.0 / UPDATES);
+
+    sim.resetStats();
+    begin = startCase();
+    for (uint32_t i{0}; i < UPDATES; i++) {
+        store.get("key" + std::to_string(rng() % KEYS), value, VALUE_SIZE);
+    }
+    report("kv get", UPDATES, clock_type::now() - begin, sim);
+
+    //! Полный просмотр журнала и монтирование по контрольной точке
+    sim.resetStats();
+    begin = startCase();
+    KVStore scanned{&chip, 0, SECTORS};
+    scanned.mount();
+    report("kv mount (full scan)", 1, clock_type::now() - begin, sim);
+    sim.resetStats();
+    begin = startCase();
+    KVStore restored{&chip, 0, SECTORS, CHECKPOINT_SECTORS};
+    restored.mount();
+    report("kv mount (checkpoint)", 1, clock_type::now() - begin, sim);
+    std::printf("%-28s %10u -> %u bytes read, %u checkpoints\n", "kv mount read", scanned.stats().mountReadBytes,
+                restored.stats().mountReadBytes, store.stats().checkpoints);
+    if (store.checkError() != KVStore::error::OK || scanned.size() != KEYS || restored.size() != KEYS) {
+        std::printf("kv store error\n");
+    }
+}
+
+//! Поиск конца журнала на всей микросхеме: двоичный поиск против последовательного просмотра
+void benchAppendPoint(){
+    constexpr uint32_t CAPACITY = 16u * 1024u * 1024u;
+    constexpr uint32_t FILLED = 11u * 1024u * 1024u + 1234u;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    uint8_t page[NORW25Q128::PAGE_SIZE];
+    for (auto& b : page) { b = 0x5A; }
+    for (uint32_t address{0}; address < FILLED; address += NORW25Q128::PAGE_SIZE) {
+        chip.pageProgram(address, page, static_cast<uint16_t>(std::min<uint32_t>(NORW25Q128::PAGE_SIZE, FILLED - address)));
+    }
+
+    sim.resetStats();
+    auto begin = startCase();
+    uint32_t linear{0};
+    uint8_t sector[NORW25Q128::SECTOR_SIZE];
+    for (uint32_t address{0}; address < CAPACITY; address += NORW25Q128::SECTOR_SIZE) {
+        chip.readArray(address, NORW25Q128::SECTOR_SIZE, sector);
+        if (sector[0] == 0xFF) {
+            linear = address;
+            break;
+        }
+    }
+    report("log end (sector scan)", 1, clock_type::now() - begin, sim);
+
+    sim.resetStats();
+    begin = startCase();
+    AppendPointFinder finder{&chip};
+    uint32_t found = finder.findAppendPoint(0, CAPACITY);
+    report("log end (binary search)", 1, clock_type::now() - begin, sim);
+    std::printf("%-28s %10u probes, end 0x%06X (scan 0x%06X)\n", "log end probes", finder.probes(), found, linear);
+    if (found != FILLED) {
+        std::printf("append point error\n");
+    }
+}
+
+//! Инкремент счетчика в термометрическом коде
+void benchCounter(){
+    constexpr uint32_t INCREMENTS = 100000;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    NORCounter counter{&chip, 0, 2};
+    counter.format();
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; i < INCREMENTS; i++) {
+        counter.increment();
+    }
+    report("counter increment", INCREMENTS, clock_type::now() - begin, sim);
+    std::printf("%-28s %10.3f\n", "counter erases per 1000", sim.stats().erases * 1000.0 / INCREMENTS);
+    if (counter.checkError() != NORCounter::error::OK || counter.value() != INCREMENTS) {
+        std::printf("counter error\n");
+    }
+}
+
+//! Побайтовая запись через эмуляцию EEPROM
+void benchEEPROMEmulator(){
+    constexpr uint32_t WRITES = 20000;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    EEPROMEmulator eeprom{&chip, 0};
+    eeprom.format();
+    std::mt19937 rng{7};
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; i < WRITES; i++) {
+        eeprom.writeByte(static_cast<uint16_t>(rng() % EEPROMEmulator::DEFAULT_CAPACITY), static_cast<uint8_t>(rng()));
+    }
+    report("eeprom emulation writeByte", WRITES, clock_type::now() - begin, sim);
+    std::printf("%-28s %10.3f\n", "eeprom emu erases per 1000", sim.stats().erases * 1000.0 / WRITES);
+    if (eeprom.checkError() != EEPROMEmulator::error::OK) {
+        std::printf("eeprom emulation error\n");
+    }
+}
+void benchRewrite(){
+    constexpr uint32_t UPDATES = 2000;
+    constexpr uint32_t RECORD = 32;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    std::mt19937 rng{11};
+    uint8_t record[RECORD];
+    //! Совместимые изменения: биты только сбрасываются, стирание не нужно
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; i < UPDATES; i++) {
+        uint32_t address = (rng() % 64) * RECORD;
+        chip.read(address, RECORD, record);
+        record[rng() % RECORD] &= static_cast<uint8_t>(rng());
+        rewrite(chip, address, RECORD, record);
+    }
+    report("rewrite (bit clear)", UPDATES, clock_type::now() - begin, sim);
+    //! Произвольные изменения: стирание и запись непустых страниц сектора
+    sim.resetStats();
+    begin = startCase();
+    for (uint32_t i{0}; i < UPDATES / 10; i++) {
+        uint32_t address = (rng() % 64) * RECORD;
+        for (auto& b : record) { b = static_cast<uint8_t>(rng()); }
+        if (rewrite(chip, address, RECORD, record) != storageError::OK) {
+            std::printf("rewrite error\n");
+        }
+    }
+    report("rewrite (erase)", UPDATES / 10, clock_type::now() - begin, sim);
+}
+void benchSharedBus(){
+    constexpr uint32_t SECTORS = 64;
+
+    SimW25Q128 sim0;
+    SimW25Q128 sim1;
+    SimSpiBus physical{{&sim0, &sim1}};
+    SharedSpiBus bus{&physical};
+    SpiDevice device0{&bus, 0};
+    SpiDevice device1{&bus, 1};
+    NORW25Q128 writer{&device0};
+    NORW25Q128 reader{&device1};
+
+    //! Один поток стирает и пишет первую микросхему, второй в это время читает другую
+    uint8_t page[NORW25Q128::PAGE_SIZE];
+    for (auto& b : page) { b = 0x3C; }
+    uint32_t reads{0};
+    bool done{false};
+    std::mutex doneMutex;
+    auto begin = startCase();
+    std::thread readerThread{[&](){
+        uint8_t sector[NORW25Q128::SECTOR_SIZE];
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock{doneMutex};
+                if (done) { break; }
+            }
+            reader.readArray((reads % SECTORS) * NORW25Q128::SECTOR_SIZE, NORW25Q128::SECTOR_SIZE, sector);
+            reads++;
+        }
+    }};
+    for (uint32_t s{0}; s < SECTORS; s++) {
+        writer.eraseSector(s * NORW25Q128::SECTOR_SIZE);
+        for (uint32_t p{0}; p < NORW25Q128::SECTOR_SIZE; p += NORW25Q128::PAGE_SIZE) {
+            writer.pageProgram(s * NORW25Q128::SECTOR_SIZE + p, page, NORW25Q128::PAGE_SIZE);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock{doneMutex};
+        done = true;
+    }
+    readerThread.join();
+    auto elapsed = clock_type::now() - begin;
+    SharedSpiBus::statistics stats = bus.stats();
+    std::printf("%-28s %10u sectors written, %u sectors read concurrently, %.1f ms\n", "shared bus",
+        SECTORS, reads, std::chrono::duration<double, std::milli>(elapsed).count());
+    std::printf("%-28s %10llu transactions, %llu contended\n", "shared bus arbitration",
+        static_cast<unsigned long long>(stats.transactions), static_cast<unsigned long long>(stats.contended));
+    if (writer.checkError() != NORW25Q128::error::OK || reader.checkError() != NORW25Q128::error::OK) {
+        std::printf("shared bus error\n");
+    }
+}
+void benchStripedVolume(){
+    constexpr uint32_t CHIPS = 4;
+    constexpr uint32_t LENGTH = 1024u * 1024u;
+
+    std::vector<uint8_t> data(LENGTH);
+    std::mt19937 rng{5};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng()); }
+    //! Микросхемы на отдельных шинах работают параллельно: время тома - наибольшее время микросхемы
+    for (uint32_t count : {1u, CHIPS}) {
+        std::vector<SimW25Q128> sims(count);
+        std::vector<NORW25Q128> chips;
+        for (auto& sim : sims) { chips.emplace_back(&sim); }
+        std::vector<NORW25Q128*> pointers;
+        for (auto& chip : chips) { pointers.push_back(&chip); }
+        StripedVolume volume{pointers};
+        auto begin = startCase();
+        bool ok = volume.erase(0, LENGTH) == storageError::OK && volume.program(0, LENGTH, data.data()) == storageError::OK;
+        double host = std::chrono::duration<double, std::milli>(clock_type::now() - begin).count();
+        uint64_t slowest{0};
+        for (auto& sim : sims) { slowest = std::max(slowest, sim.stats().deviceNs); }
+        std::printf("%-28s %10u chips, erase+program 1 MB: %.1f ms device, %.1f ms host\n", "striped volume",
+            count, slowest / 1e6, host);
+        std::vector<uint8_t> back(LENGTH);
+        if (!ok || volume.read(0, LENGTH, back.data()) != storageError::OK || back != data) {
+            std::printf("striped volume error\n");
+        }
+    }
+}
+//! Чтение с зеркального тома во время фоновой записи другой области
+void benchMirroredVolume(){
+    constexpr uint32_t REPLICAS = 2;
+    constexpr uint32_t PAGES = 1024;
+    constexpr uint32_t READ_BASE = 1024u * 1024u;
+    constexpr uint32_t PAGE = NORW25Q128::PAGE_SIZE;
+
+    std::vector<SimW25Q128> sims(REPLICAS);
+    std::vector<NORW25Q128> chips;
+    for (auto& sim : sims) { chips.emplace_back(&sim); }
+    std::vector<NORW25Q128*> pointers;
+    for (auto& chip : chips) { pointers.push_back(&chip); }
+    MirroredVolume volume{pointers};
+
+    std::vector<uint8_t> page(PAGE, 0x5A);
+    bool ok = volume.program(READ_BASE, PAGE, page.data()) == storageError::OK;
+    ok = ok && volume.erase(0, PAGES * PAGE) == storageError::OK && volume.flush() == storageError::OK;
+    std::vector<uint8_t> back(PAGE);
+    auto begin = startCase();
+    for (uint32_t i{0}; ok && i < PAGES; i++) {
+        ok = volume.program(i * PAGE, PAGE, page.data()) == storageError::OK;
+        ok = ok && volume.read(READ_BASE, PAGE, back.data()) == storageError::OK && back == page;
+    }
+    ok = ok && volume.flush() == storageError::OK;
+    double host = std::chrono::duration<double, std::milli>(clock_type::now() - begin).count();
+    const MirroredVolume::statistics& stats = volume.stats();
+    std::printf("%-28s %10u pages written, %llu reads: %llu idle replica, %llu waited, %.1f ms host\n", "mirrored volume",
+        PAGES, static_cast<unsigned long long>(stats.reads), static_cast<unsigned long long>(stats.idleReads),
+        static_cast<unsigned long long>(stats.busyReads), host);
+
+    //! Запись поверх данных - ошибка вызывающего: NEEDS_ERASE сразу, копии остаются в томе
+    std::vector<uint8_t> other(PAGE, 0xA5);
+    ok = ok && volume.program(0, PAGE, other.data()) == storageError::NEEDS_ERASE && volume.healthyReplicas() == REPLICAS;
+    //! Копия, разошедшаяся с остальными, исключается и восстанавливается resync()
+    std::vector<uint8_t> zeros(PAGE, 0x00);
+    chips[1].pageProgram(PAGES * PAGE, zeros.data(), PAGE);
+    ok = ok && volume.program(PAGES * PAGE, PAGE, page.data()) == storageError::OK;
+    ok = ok && volume.flush() == storageError::NEEDS_ERASE && volume.replicaFailed(1);
+    sims[1].resetStats();
+    begin = startCase();
+    ok = ok && volume.resync(1) == storageError::OK && volume.healthyReplicas() == REPLICAS;
+    report("mirrored volume resync", 1, clock_type::now() - begin, sims[1]);
+    ok = ok && chips[1].checksum(0, 2u * 1024u * 1024u) == chips[0].checksum(0, 2u * 1024u * 1024u);
+    if (!ok) {
+        std::printf("mirrored volume error\n");
+    }
+}
+//! Журнал текстовых записей со сжатием блоков и без него
+void benchCompressedLog(){
+    constexpr uint32_t RECORDS = 20000;
+    constexpr uint32_t REGION = 2u * 1024u * 1024u;
+
+    std::mt19937 rng{11};
+    std::string records;
+    for (uint32_t i{0}; i < RECORDS; i++) {
+        records += "ts=" + std::to_string(1700000000u + i * 7) + " level=INFO sensor=" + std::to_string(rng() % 16) +
+            " value=" + std::to_string(rng() % 4096) + "\n";
+    }
+    for (bool compression : {false, true}) {
+        SimW25Q128 sim;
+        NORW25Q128 chip{&sim};
+        CompressedLog log{&chip, 0, REGION, compression};
+        bool ok = log.format();
+        sim.resetStats();
+        auto begin = startCase();
+        for (size_t at{0}; ok && at < records.size(); at += 64) {
+            uint32_t length = static_cast<uint32_t>(std::min<size_t>(64, records.size() - at));
+            ok = log.append(reinterpret_cast<const uint8_t*>(records.data() + at), length);
+        }
+        ok = ok && log.flush();
+        report(compression ? "compressed log (lz)" : "compressed log (raw)", RECORDS, clock_type::now() - begin, sim);
+        //! Случайное чтение распаковывает только блок с запрошенными данными
+        sim.resetStats();
+        char record[64];
+        begin = startCase();
+        for (uint32_t i{0}; ok && i < 1000; i++) {
+            ok = log.read(rng() % (log.size() - sizeof(record)), reinterpret_cast<uint8_t*>(record), sizeof(record));
+        }
+        report(compression ? "compressed log read (lz)" : "compressed log read (raw)", 1000, clock_type::now() - begin, sim);
+        std::printf("%-28s %10u bytes -> %u bytes stored in %u frames\n", "compressed log size",
+            log.stats().rawBytes, log.stats().storedBytes, log.stats().blocks);
+        if (!ok) {
+            std::printf("compressed log error\n");
+        }
+    }
+
+    //! Оборванный кадр (мусор без заголовка): кадры, записанные после него, должны найтись при повторном монтировании
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    CompressedLog log{&chip, 0, 64u * 1024u};
+    const uint8_t* text = reinterpret_cast<const uint8_t*>(records.data());
+    bool ok = log.format() && log.append(text, 1000) && log.flush();
+    std::vector<uint8_t> garbage(100);
+    for (auto& b : garbage) { b = static_cast<uint8_t>(rng()); }
+    uint32_t slot = (log.stats().storedBytes + NORW25Q128::PAGE_SIZE - 1) / NORW25Q128::PAGE_SIZE * NORW25Q128::PAGE_SIZE;
+    ok = ok && chip.program(slot, static_cast<uint32_t>(garbage.size()), garbage.data()) == storageError::OK;
+    ok = ok && log.mount() && log.size() == 1000 && log.append(text + 1000, 500) && log.flush();
+    sim.resetStats();
+    auto begin = startCase();
+    ok = ok && log.mount();
+    report("compressed log remount (torn)", 1, clock_type::now() - begin, sim);
+    std::vector<uint8_t> back(1500);
+    ok = ok && log.size() == 1500 && log.read(0, back.data(), 1500) && std::equal(back.begin(), back.end(), text);
+    if (!ok) {
+        std::printf("compressed log torn frame error\n");
+    }
+}
+//! Запись с проверкой чтением и CRC32 большой области
+void benchVerifiedWrites(){
+    constexpr uint32_t LENGTH = 256u * 1024u;
+
+    std::vector<uint8_t> data(LENGTH);
+    std::mt19937 rng{13};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng()); }
+    for (bool verify : {false, true}) {
+        SimW25Q128 sim;
+        NORW25Q128 chip{&sim};
+        chip.setVerifyWrites(verify);
+        sim.resetStats();
+        auto begin = startCase();
+        bool ok = chip.program(0, LENGTH, data.data()) == storageError::OK;
+        report(verify ? "program 256 KB (verify)" : "program 256 KB", 1, clock_type::now() - begin, sim);
+        sim.resetStats();
+        begin = startCase();
+        ok = ok && chip.checksum(0, LENGTH) == crc32(0, data.data(), LENGTH);
+        report("checksum 256 KB", 1, clock_type::now() - begin, sim);
+        if (!ok) {
+            std::printf("verified writes error\n");
+        }
+    }
+}
+//! Атомарное обновление конфигурации в 25LC040A: изменение нескольких байт за фиксацию
+void benchABRecordStore(){
+    constexpr uint16_t SIZE = 240;
+    constexpr uint32_t COMMITS = 1000;
+
+    Sim25LC040A sim;
+    EEPROM25LC040A eeprom{&sim};
+    ABRecordStore store{&eeprom, 0, Sim25LC040A::CAPACITY, SIZE};
+    bool ok = store.format();
+    std::mt19937 rng{17};
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; ok && i < COMMITS; i++) {
+        uint8_t value = static_cast<uint8_t>(rng());
+        ok = store.write(static_cast<uint16_t>(rng() % SIZE), &value, 1) && store.commit();
+    }
+    double hostNs = std::chrono::duration<double, std::nano>(clock_type::now() - begin).count() / COMMITS;
+    std::printf("%-28s %8u ops %10.0f ns/op %10.1f us/op (device) %8.2f write cycles/op\n", "ab record commit",
+        COMMITS, hostNs, sim.stats().deviceNs / 1000.0 / COMMITS, double(sim.stats().writeCycles) / COMMITS);
+    if (!ok) {
+        std::printf("ab record error\n");
+    }
+}
+
+//! Файловая система: создание мелких файлов, дозапись в журнал и монтирование
+void benchNORFileSystem(){
+    constexpr uint16_t SECTORS = 512;
+    constexpr uint16_t CHECKPOINT_SECTORS = 32;
+    constexpr uint32_t FILES = 500;
+    constexpr uint32_t FILE_SIZE = 100;
+    constexpr uint32_t RECORDS = 10000;
+    constexpr uint32_t RECORD_SIZE = 48;
+    constexpr uint32_t SYNC_EVERY = 16;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    KVStore store{&chip, 0, SECTORS, CHECKPOINT_SECTORS};
+    NORFileSystem fs{&store};
+    store.setCheckpointInterval(64);
+    bool ok = fs.format() && fs.mkdir("/cfg") && fs.mkdir("/log");
+    uint8_t data[FILE_SIZE];
+    std::mt19937 rng{5};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng()); }
+
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t i{0}; ok && i < FILES; i++) {
+        int32_t file = fs.open("/cfg/f" + std::to_string(i), NORFileSystem::WRITE | NORFileSystem::CREATE);
+        ok = file >= 0 && fs.write(file, data, FILE_SIZE) == FILE_SIZE && fs.close(file);
+    }
+    report("fs create small file", FILES, clock_type::now() - begin, sim);
+
+    sim.resetStats();
+    begin = startCase();
+    int32_t log = fs.open("/log/events", NORFileSystem::WRITE | NORFileSystem::CREATE | NORFileSystem::APPEND);
+    ok = ok && log >= 0;
+    for (uint32_t i{0}; ok && i < RECORDS; i++) {
+        ok = fs.write(log, data, RECORD_SIZE) == RECORD_SIZE && (i % SYNC_EVERY != 0 || fs.sync(log));
+    }
+    ok = ok && fs.close(log);
+    auto elapsed = clock_type::now() - begin;
+    report("fs append (sync every 16)", RECORDS, elapsed, sim);
+    std::printf("%-28s %10.2f MB/s (device)\n", "fs append throughput",
+                double(RECORDS) * RECORD_SIZE / (sim.stats().deviceNs / 1e9) / 1e6);
+
+    sim.resetStats();
+    begin = startCase();
+    KVStore mountedStore{&chip, 0, SECTORS, CHECKPOINT_SECTORS};
+    NORFileSystem mounted{&mountedStore};
+    ok = ok && mounted.mount();
+    report("fs mount", 1, clock_type::now() - begin, sim);
+    NORFileSystem::objectInfo info{};
+    if (!ok || mounted.list("/cfg").size() != FILES || !mounted.stat("/log/events", info) ||
+        info.size != RECORDS * RECORD_SIZE) {
+        std::printf("fs error\n");
+    }
+}
+
+//! Поиск и чтение через итераторы и std::istream: побайтные транзакции против чтения блоками
+void benchStorageStream(){
+    constexpr uint32_t REGION = 256u * 1024u;
+    constexpr uint32_t PATTERN_ADDRESS = REGION - 100;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    std::vector<uint8_t> data(REGION);
+    std::mt19937 rng{9};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng() % 16); }
+    const uint8_t pattern[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x42};
+    std::copy(std::begin(pattern), std::end(pattern), data.begin() + PATTERN_ADDRESS);
+    chip.program(0, REGION, data.data());
+
+    uint32_t found[2];
+    const char* names[2] = {"view search (1 B blocks)", "view search (256 B blocks)"};
+    const uint32_t blocks[2] = {1, 256};
+    for (uint8_t i{0}; i < 2; i++) {
+        StorageView view{&chip, blocks[i]};
+        sim.resetStats();
+        auto begin = startCase();
+        auto it = std::search(view.begin(), view.begin() + REGION, std::begin(pattern), std::end(pattern));
+        report(names[i], 1, clock_type::now() - begin, sim);
+        found[i] = it.address();
+    }
+
+    StorageStreamBuf buffer{&chip, 4096};
+    std::istream stream{&buffer};
+    std::vector<char> chunk(100);
+    uint64_t sum{0};
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t address{0}; address < REGION; address += chunk.size()) {
+        stream.read(chunk.data(), static_cast<std::streamsize>(std::min<size_t>(chunk.size(), REGION - address)));
+        for (std::streamsize k{0}; k < stream.gcount(); k++) { sum += static_cast<uint8_t>(chunk[k]); }
+    }
+    report("istream read (100 B)", REGION / 100, clock_type::now() - begin, sim);
+    uint64_t expected{0};
+    for (uint8_t b : data) { expected += b; }
+    if (found[0] != PATTERN_ADDRESS || found[1] != PATTERN_ADDRESS || !stream || sum != expected) {
+        std::printf("storage stream error\n");
+    }
+}
+
+//! Чтение разнесенных записей: отдельные транзакции против readv() с объединением
+void benchScatterRead(){
+    constexpr uint32_t REGION = 64u * 1024u;
+    constexpr uint32_t SEGMENTS = 64;
+    constexpr uint32_t ROUNDS = 200;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    std::vector<uint8_t> data(REGION);
+    std::mt19937 rng{13};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng()); }
+    chip.program(0, REGION, data.data());
+
+    //! Записи разбора: поля по 4-32 байта, идущие подряд или через небольшие промежутки
+    std::vector<std::vector<uint8_t>> buffers(SEGMENTS);
+    std::vector<NORW25Q128::readSegment> segments(SEGMENTS);
+    uint32_t address = 1024;
+    for (uint32_t i{0}; i < SEGMENTS; i++) {
+        uint32_t length = 4 + rng() % 29;
+        buffers[i].resize(length);
+        segments[i] = {address, length, buffers[i].data()};
+        address += length + (rng() % 4 == 0 ? rng() % 256 : rng() % 4);
+    }
+    std::shuffle(segments.begin(), segments.end(), rng);
+
+    sim.resetStats();
+    auto begin = startCase();
+    for (uint32_t r{0}; r < ROUNDS; r++) {
+        for (const auto& segment : segments) {
+            chip.read(segment.address, segment.length, segment.out);
+        }
+    }
+    report("scatter read (separate)", ROUNDS, clock_type::now() - begin, sim);
+    uint64_t separate = sim.stats().transactions;
+
+    uint32_t transactions{0};
+    sim.resetStats();
+    begin = startCase();
+    for (uint32_t r{0}; r < ROUNDS; r++) {
+        transactions = chip.readv(segments.data(), segments.size());
+    }
+    report("scatter read (readv)", ROUNDS, clock_type::now() - begin, sim);
+    std::printf("%-28s %10llu -> %llu transactions/op\n", "scatter read transactions",
+                static_cast<unsigned long long>(separate / ROUNDS), static_cast<unsigned long long>(sim.stats().transactions / ROUNDS));
+    bool ok = chip.checkError() == NORW25Q128::error::OK && transactions != 0;
+    for (const auto& segment : segments) {
+        ok = ok && std::equal(segment.out, segment.out + segment.length, data.begin() + segment.address);
+    }
+    if (!ok) {
+        std::printf("scatter read error\n");
+    }
+}
+
+//! Смешанная нагрузка: выполнение в порядке поступления против планировщика
+void benchScheduler(){
+    constexpr uint32_t BURSTS = 50;
+    constexpr uint32_t READS = 8;
+    constexpr uint32_t PROGRAMS = 8;
+    constexpr uint32_t RECORD = 32;
+
+    const char* classNames[NORScheduler::CLASS_COUNT] = {"read", "program", "erase"};
+    for (uint8_t scheduled{0}; scheduled < 2; scheduled++) {
+        SimW25Q128 sim;
+        NORW25Q128 chip{&sim};
+        auto clock = [&sim](){ return sim.stats().deviceNs; };
+        NORScheduler scheduler{&chip, 200000000, clock};
+        std::mt19937 rng{21};
+        std::vector<NORScheduler::request> requests(BURSTS * (READS + PROGRAMS + 1));
+        std::vector<std::vector<uint8_t>> buffers(requests.size(), std::vector<uint8_t>(RECORD));
+        NORScheduler::latency direct[NORScheduler::CLASS_COUNT];
+        uint32_t logAddress{0};
+        size_t n{0};
+        auto begin = startCase();
+        for (uint32_t burst{0}; burst < BURSTS; burst++) {
+            //! Клиенты: журнал дописывает записи, фоновая задача стирает сектор впереди, читатели - случайные записи
+            size_t first = n;
+            requests[n++] = {NORScheduler::operationType::ERASE, (burst + 1) * NORW25Q128::SECTOR_SIZE, NORW25Q128::SECTOR_SIZE};
+            for (uint32_t i{0}; i < PROGRAMS + READS; i++) {
+                NORScheduler::request& r = requests[n];
+                if (i % 2 == 0) {
+                    r = {NORScheduler::operationType::PROGRAM, logAddress, RECORD, buffers[n].data()};
+                    logAddress += RECORD;
+                } else {
+                    r = {NORScheduler::operationType::READ, static_cast<uint32_t>(rng() % (BURSTS * 1024u)), RECORD, nullptr, buffers[n].data()};
+                }
+                n++;
+            }
+            if (scheduled) {
+                for (size_t i{first}; i < n; i++) { scheduler.submit(&requests[i]); }
+                scheduler.run();
+                continue;
+            }
+            uint64_t submitted = clock();
+            for (size_t i{first}; i < n; i++) {
+                NORScheduler::request& r = requests[i];
+                if (r.type == NORScheduler::operationType::READ) { chip.read(r.address, r.length, r.out); }
+                if (r.type == NORScheduler::operationType::PROGRAM) { chip.program(r.address, r.length, r.data); }
+                if (r.type == NORScheduler::operationType::ERASE) { chip.erase(r.address, r.length); }
+                NORScheduler::latency& l = direct[static_cast<uint8_t>(r.type)];
+                uint64_t ns = clock() - submitted;
+                l.count++;
+                l.totalNs += ns;
+                l.maxNs = std::max(l.maxNs, ns);
+            }
+        }
+        double hostNs = std::chrono::duration<double, std::nano>(clock_type::now() - begin).count() / n;
+        const NORScheduler::latency* classes = scheduled ? scheduler.stats().classes : direct;
+        for (uint8_t c{0}; c < NORScheduler::CLASS_COUNT; c++) {
+            std::printf("%-28s %8llu ops %10.0f ns/op %10.1f us avg %10.1f us max (device latency)\n",
+                (std::string(scheduled ? "sched " : "fifo ") + classNames[c]).c_str(),
+                static_cast<unsigned long long>(classes[c].count), hostNs,
+                classes[c].totalNs / 1000.0 / std::max<uint64_t>(classes[c].count, 1), classes[c].maxNs / 1000.0);
+        }
+        if (scheduled) {
+            std::printf("%-28s %8llu programs %8llu merged programs %8llu merged reads\n", "sched merges",
+                static_cast<unsigned long long>(sim.stats().programs),
+                static_cast<unsigned long long>(scheduler.stats().mergedPrograms),
+                static_cast<unsigned long long>(scheduler.stats().mergedReads));
+        } else {
+            std::printf("%-28s %8llu programs\n", "fifo page programs", static_cast<unsigned long long>(sim.stats().programs));
+        }
+    }
+}
+
+//! Разбор по указателю: чтение всей области против загрузки затронутых страниц
+void benchFlashMapping(){
+    constexpr uint32_t REGION = 1024u * 1024u;
+    constexpr uint32_t LOOKUPS = 64;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    std::vector<uint8_t> data(REGION);
+    std::mt19937 rng{33};
+    for (auto& b : data) { b = static_cast<uint8_t>(rng()); }
+    chip.program(0, REGION, data.data());
+    std::vector<uint32_t> offsets(LOOKUPS);
+    for (auto& offset : offsets) { offset = rng() % (REGION - 4); }
+
+    //! Разбор обращается к 32-битным полям по смещениям, как к структурам в памяти
+    auto parse = [&offsets](const uint8_t* base){
+        uint64_t sum{0};
+        for (uint32_t offset : offsets) {
+            uint32_t value;
+            std::memcpy(&value, base + offset, sizeof(value));
+            sum += value;
+        }
+        return sum;
+    };
+    uint64_t expected = parse(data.data());
+
+    sim.resetStats();
+    auto begin = startCase();
+    std::vector<uint8_t> copy(REGION);
+    chip.read(0, REGION, copy.data());
+    bool ok = parse(copy.data()) == expected;
+    report("map: read whole region", 1, clock_type::now() - begin, sim);
+
+    for (uint8_t userfault{0}; userfault < 2; userfault++) {
+        FlashMapping mapping{&chip, 0, REGION};
+        sim.resetStats();
+        begin = startCase();
+        if (!mapping.map(userfault != 0)) {
+            ok = false;
+            continue;
+        }
+        uint64_t sum{0};
+        if (mapping.lazy()) {
+            sum = parse(mapping.data());
+        } else {
+            for (uint32_t offset : offsets) {
+                uint32_t value;
+                //! Поле может пересекать границу страницы - читается по байтам через page()
+                uint8_t raw[4];
+                for (uint32_t k{0}; k < 4; k++) { raw[k] = *mapping.page(offset + k); }
+                std::memcpy(&value, raw, sizeof(value));
+                sum += value;
+            }
+        }
+        ok = ok && sum == expected;
+        report(mapping.lazy() ? "map: userfaultfd" : "map: page cache", 1, clock_type::now() - begin, sim);
+        std::printf("%-28s %10llu of %u pages loaded\n", mapping.lazy() ? "map: userfaultfd pages" : "map: page cache pages",
+                    static_cast<unsigned long long>(mapping.stats().pagesLoaded), REGION / mapping.pageSize());
+    }
+    if (!ok) {
+        std::printf("flash mapping error\n");
+    }
+}
+//! Несколько потоков приложения: общий вызов под мьютексом против потока микросхемы
+void benchChipWorker(){
+    constexpr uint32_t THREADS = 4;
+    constexpr uint32_t READS = 256;
+    constexpr uint32_t LENGTH = 1024;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    std::vector<std::vector<uint8_t>> buffers(THREADS, std::vector<uint8_t>(READS * LENGTH));
+    bool ok{true};
+    for (uint8_t worker{0}; worker < 2; worker++) {
+        std::atomic<uint64_t> inCallNs{0};
+        std::atomic<uint32_t> failed{0};
+        std::mutex chipMutex;
+        sim.resetStats();
+        auto begin = startCase();
+        {
+            ChipWorker front{&chip, 1024};
+            std::vector<std::thread> threads;
+            for (uint32_t t{0}; t < THREADS; t++) {
+                threads.emplace_back([&, t](){
+                    uint64_t ns{0};
+                    for (uint32_t i{0}; i < READS; i++) {
+                        uint32_t address = (t * READS + i) * LENGTH;
+                        uint8_t* out = buffers[t].data() + i * LENGTH;
+                        auto callBegin = clock_type::now();
+                        if (worker != 0) {
+                            front.read(address, LENGTH, out, [&failed](storageError result){
+                                if (result != storageError::OK) { failed++; }
+                            });
+                        } else {
+                            std::lock_guard<std::mutex> lock{chipMutex};
+                            if (chip.read(address, LENGTH, out) != storageError::OK) { failed++; }
+                        }
+                        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - callBegin).count();
+                    }
+                    inCallNs += ns;
+                });
+            }
+            for (auto& thread : threads) { thread.join(); }
+            //! Деструктор потока микросхемы дожидается оставшихся запросов
+        }
+        const char* name = worker != 0 ? "worker: callback reads" : "worker: direct mutex reads";
+        report(name, THREADS * READS, clock_type::now() - begin, sim);
+        std::printf("%-28s %10.0f ns/op blocked in caller\n", name, double(inCallNs.load()) / (THREADS * READS));
+        ok = ok && failed == 0;
+    }
+    if (!ok) {
+        std::printf("chip worker error\n");
+    }
+}
+//! Драйвер без передачи блоками: каждый байт - отдельное сообщение серверу
+class ByteDriver : public IDriver{
+    IDriver* _driver;
+
+    public:
+    explicit ByteDriver(IDriver* driver) : _driver(driver) {}
+    void select() override { _driver->select(); }
+    void deselect() override { _driver->deselect(); }
+    uint8_t transfer(uint8_t byte) override { return _driver->transfer(byte); }
+    void idle() override { _driver->idle(); }
+};
+
+//! Микросхема на сервере шины: сообщения по байту против транзакций целиком, затем несколько клиентов
+void benchSocketBus(){
+    constexpr uint32_t CLIENTS = 4;
+    constexpr uint32_t READS = 64;
+    constexpr uint32_t LENGTH = 4096;
+
+    SimW25Q128 sim;
+    SocketSpiServer server{{&sim}};
+    std::string path = "/tmp/chip_bench_" + std::to_string(static_cast<unsigned long>(clock_type::now().time_since_epoch().count())) + ".sock";
+    if (!server.start(path)) {
+        std::printf("%-28s %10s\n", "socket bus", "unavailable");
+        return;
+    }
+    std::vector<uint8_t> page(NORW25Q128::PAGE_SIZE);
+    for (auto& b : page) { b = 0x5A; }
+    std::vector<uint8_t> out(LENGTH);
+    bool ok{true};
+    for (uint8_t batched{0}; batched < 2; batched++) {
+        SocketSpiDriver client;
+        ByteDriver bytes{&client};
+        ok = ok && client.connect(path);
+        NORW25Q128 chip{batched != 0 ? static_cast<IDriver*>(&client) : static_cast<IDriver*>(&bytes)};
+        sim.resetStats();
+        auto begin = startCase();
+        chip.eraseSector(0);
+        for (uint32_t p{0}; p < NORW25Q128::SECTOR_SIZE; p += NORW25Q128::PAGE_SIZE) {
+            chip.pageProgram(p, page.data(), NORW25Q128::PAGE_SIZE);
+        }
+        for (uint32_t i{0}; i < READS; i++) {
+            chip.readArray(0, LENGTH, out.data());
+        }
+        const char* name = batched != 0 ? "socket: transaction batches" : "socket: byte messages";
+        report(name, READS, clock_type::now() - begin, sim);
+        std::printf("%-28s %10llu messages, %llu round trips\n", name,
+            static_cast<unsigned long long>(client.stats().messages), static_cast<unsigned long long>(client.stats().roundTrips));
+        ok = ok && chip.checkError() == NORW25Q128::error::OK && out[0] == 0x5A;
+    }
+
+    //! Клиенты с отдельными соединениями соревнуются за шину, как отдельные процессы
+    SocketSpiServer::statistics before = server.stats();
+    std::atomic<uint32_t> failed{0};
+    sim.resetStats();
+    auto begin = startCase();
+    std::vector<std::thread> threads;
+    for (uint32_t c{0}; c < CLIENTS; c++) {
+        threads.emplace_back([&](){
+            SocketSpiDriver client;
+            if (!client.connect(path)) {
+                failed++;
+                return;
+            }
+            NORW25Q128 chip{&client};
+            std::vector<uint8_t> buffer(LENGTH);
+            for (uint32_t i{0}; i < READS; i++) {
+                chip.readArray(0, LENGTH, buffer.data());
+                if (chip.checkError() != NORW25Q128::error::OK || buffer[LENGTH - 1] != 0x5A) {
+                    failed++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    report("socket: concurrent clients", CLIENTS * READS, clock_type::now() - begin, sim);
+    SocketSpiServer::statistics after = server.stats();
+    std::printf("%-28s %10llu transactions, %llu contended\n", "socket: bus arbitration",
+        static_cast<unsigned long long>(after.transactions - before.transactions),
+        static_cast<unsigned long long>(after.contended - before.contended));
+    server.stop();
+    if (!ok || failed != 0) {
+        std::printf("socket bus error\n");
+    }
+}
+//! Стоимость трассировки и выгрузка последовательности стирания и записи
+void benchTrace(){
+    constexpr uint32_t READS = 20000;
+    constexpr uint32_t PAGES = 16;
+
+    SimW25Q128 sim;
+    NORW25Q128 chip{&sim};
+    TraceRing ring;
+    uint8_t sink{0};
+    for (uint8_t traced{0}; traced < 2; traced++) {
+        chip.setTracer(traced != 0 ? &ring : nullptr);
+        sim.resetStats();
+        auto begin = startCase();
+        for (uint32_t i{0}; i < READS; i++) {
+            sink ^= chip.readByte(i);
+        }
+        report(traced != 0 ? "trace: readByte traced" : "trace: readByte untraced", READS, clock_type::now() - begin, sim);
+    }
+
+    //! Сектор стирается и записывается постранично, EEPROM пишется массивом - интервалы с вложенными wait()
+    ring.clear();
+    Sim25LC040A eepromSim;
+    EEPROM25LC040A eeprom{&eepromSim};
+    eeprom.setTracer(&ring);
+    uint8_t page[NORW25Q128::PAGE_SIZE];
+    for (auto& b : page) { b = static_cast<uint8_t>(sink + 1); }
+    chip.eraseSector(0);
+    for (uint32_t p{0}; p < PAGES; p++) {
+        chip.pageProgram(p * NORW25Q128::PAGE_SIZE, page, NORW25Q128::PAGE_SIZE);
+    }
+    eeprom.writeArray(0, 64, page);
+    chip.setTracer(nullptr);
+    std::ostringstream json;
+    bool ok = ring.exportChromeTrace(json);
+    std::printf("%-28s %10zu events, %zu bytes of JSON\n", "trace: erase/program export", ring.size(), json.str().size());
+    if (!ok || chip.checkError() != NORW25Q128::error::OK || eeprom.checkError() != EEPROM25LC040A::error::OK) {
+        std::printf("trace error\n");
+    }
+}
+}
+
+int main(int argc, char** argv){
+    for (int i{1}; i < argc; i++) {
+        if (std::strcmp(argv[i], "--perf") == 0 && !perf.open()) {
+            std::printf("perf counters unavailable, reporting wall-clock time only\n");
+        }
+    }
+    benchDetect();
+    benchKVStore();
+    benchAppendPoint();
+    benchCounter();
+    benchEEPROMEmulator();
+    benchRewrite();
+    benchSharedBus();
+    benchStripedVolume();
+    benchMirroredVolume();
+    benchCompressedLog();
+    benchVerifiedWrites();
+    benchABRecordStore();
+    benchNORFileSystem();
+    benchStorageStream();
+    benchScatterRead();
+    benchScheduler();
+    benchFlashMapping();
+    benchChipWorker();
+    benchSocketBus();
+    benchTrace();
+    return 0;
+}
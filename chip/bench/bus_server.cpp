@@ -0,0 +1,55 @@
+#include "SimW25Q128.h"
+#include "SocketSpi.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/*!
+    Сервер шины с программными моделями W25Q128
+
+    Запуск: chip_bus_server <путь сокета> [количество микросхем]
+    Процессы подключаются драйвером SocketSpiDriver с номером микросхемы.
+    Работает до SIGINT/SIGTERM, при остановке выводит статистику шины.
+*/
+int main(int argc, char** argv){
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <socket path> [chips]\n", argv[0]);
+        return 2;
+    }
+    int count = argc > 2 ? std::atoi(argv[2]) : 1;
+    if (count < 1 || count > 255) {
+        std::fprintf(stderr, "chips must be 1..255\n");
+        return 2;
+    }
+    //! Сигналы блокируются до запуска потоков сервера и принимаются sigwait()
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::vector<std::unique_ptr<SimW25Q128>> sims;
+    std::vector<IDriver*> devices;
+    for (int i{0}; i < count; i++) {
+        sims.emplace_back(new SimW25Q128{});
+        devices.push_back(sims.back().get());
+    }
+    SocketSpiServer server{devices};
+    if (!server.start(argv[1])) {
+        std::fprintf(stderr, "cannot listen on %s\n", argv[1]);
+        return 1;
+    }
+    std::printf("serving %d chip(s) on %s\n", count, argv[1]);
+    std::fflush(stdout);
+    int signal{0};
+    sigwait(&signals, &signal);
+    server.stop();
+    SocketSpiServer::statistics stats = server.stats();
+    std::printf("%llu clients, %llu messages, %llu transactions, %llu contended, %llu bytes\n",
+        static_cast<unsigned long long>(stats.clients), static_cast<unsigned long long>(stats.messages),
+        static_cast<unsigned long long>(stats.transactions), static_cast<unsigned long long>(stats.contended),
+        static_cast<unsigned long long>(stats.bytes));
+    return 0;
+}
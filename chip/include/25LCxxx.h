@@ -0,0 +1,282 @@
+/*!
+    \file 25LCxxx.h
+    \brief Обертка для работы с EEPROM семейства 25LCxxx через SPI драйвер
+*/
+#pragma once
+#include "Driver.h"
+#include "Storage.h"
+#include <cstdint>
+#include <type_traits>
+
+class TraceRing;
+
+/*!
+    \defgroup traits25LC Параметры микросхем 25LCxxx
+
+    Каждая структура описывает одну микросхему: объем, размер страницы,
+    разрядность адреса (8, 9, 16 или 24 бита; 9-й бит передается в инструкции)
+    и максимальное время цикла записи.
+    @{
+*/
+struct traits25LC010A{ static constexpr uint32_t CAPACITY = 128;    static constexpr uint16_t PAGE_SIZE = 16;  static constexpr uint8_t ADDRESS_BITS = 8;  static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC020A{ static constexpr uint32_t CAPACITY = 256;    static constexpr uint16_t PAGE_SIZE = 16;  static constexpr uint8_t ADDRESS_BITS = 8;  static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC040A{ static constexpr uint32_t CAPACITY = 512;    static constexpr uint16_t PAGE_SIZE = 16;  static constexpr uint8_t ADDRESS_BITS = 9;  static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC080A{ static constexpr uint32_t CAPACITY = 1024;   static constexpr uint16_t PAGE_SIZE = 16;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC080B{ static constexpr uint32_t CAPACITY = 1024;   static constexpr uint16_t PAGE_SIZE = 32;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC160A{ static constexpr uint32_t CAPACITY = 2048;   static constexpr uint16_t PAGE_SIZE = 16;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC160B{ static constexpr uint32_t CAPACITY = 2048;   static constexpr uint16_t PAGE_SIZE = 32;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC320A{ static constexpr uint32_t CAPACITY = 4096;   static constexpr uint16_t PAGE_SIZE = 32;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC640A{ static constexpr uint32_t CAPACITY = 8192;   static constexpr uint16_t PAGE_SIZE = 32;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC128 { static constexpr uint32_t CAPACITY = 16384;  static constexpr uint16_t PAGE_SIZE = 64;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC256 { static constexpr uint32_t CAPACITY = 32768;  static constexpr uint16_t PAGE_SIZE = 64;  static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC512 { static constexpr uint32_t CAPACITY = 65536;  static constexpr uint16_t PAGE_SIZE = 128; static constexpr uint8_t ADDRESS_BITS = 16; static constexpr uint32_t WRITE_CYCLE_US = 5000; };
+struct traits25LC1024{ static constexpr uint32_t CAPACITY = 131072; static constexpr uint16_t PAGE_SIZE = 256; static constexpr uint8_t ADDRESS_BITS = 24; static constexpr uint32_t WRITE_CYCLE_US = 6000; };
+/*! @} */
+
+/*!
+    \class EEPROM25LCxxx
+    \brief Обертка для работы с EEPROM семейства 25LCxxx через SPI драйвер
+
+    Параметры микросхемы задаются на этапе компиляции структурой Traits, поэтому
+    разбиение записи по страницам и передача адреса не содержат ветвлений по типу
+    микросхемы. Реализация инстанцируется явно для всех структур traits25LC*.
+
+    \tparam Traits Параметры микросхемы (см. traits25LC)
+*/
+template<class Traits>
+class EEPROM25LCxxx : public IStorage{
+    static_assert(Traits::PAGE_SIZE >= 16 && (Traits::PAGE_SIZE & (Traits::PAGE_SIZE - 1)) == 0,
+        "Page size must be a power of two");
+    static_assert(Traits::CAPACITY % Traits::PAGE_SIZE == 0, "Capacity must be a multiple of the page size");
+    static_assert(Traits::ADDRESS_BITS == 8 || Traits::ADDRESS_BITS == 9 || Traits::ADDRESS_BITS == 16 || Traits::ADDRESS_BITS == 24,
+        "Address width must be 8, 9, 16 or 24 bits");
+    static_assert(Traits::CAPACITY <= (uint32_t(1) << Traits::ADDRESS_BITS), "Capacity does not fit the address width");
+
+    //! Набор инструкций для работы с EEPROM
+    enum instruction : uint8_t{
+        READ = 0x03,                ///<Read data from memory array beginning at selected address
+        WRITE = 0x02,               ///<Write data to memory array beginning at selected address
+        WRDI = 0x04,                ///<Reset the write enable latch (disable write operations)
+        WREN = 0x06,                ///<Set the write enable latch (enable write operations)
+        RDSR = 0x05,                ///<Read STATUS register
+        WRSR = 0x01                 ///<Write STATUS register
+    };
+    //! Биты регистра состояния
+    enum class status:uint8_t{
+        WIP = 0x01,                 ///<Write in progress
+        WEL = 0x02,                 ///<Write enable latch
+        BP0 = 0x04,                 ///<Block protect bit 0
+        BP1 = 0x08,                 ///<Block protect bit 1
+    };
+
+    public:
+    //! Тип адреса и длины: 16 бит, если их хватает для всего объема
+    using address_type = std::conditional_t<(Traits::CAPACITY < 0x10000), uint16_t, uint32_t>;
+    //! Максимальный адрес памяти
+    static constexpr address_type MAX_ADDR = Traits::CAPACITY - 1;
+    //! Размер страницы (байты)
+    static constexpr uint16_t PAGE_SIZE = Traits::PAGE_SIZE;
+    //! Максимальное время цикла записи (мкс)
+    static constexpr uint32_t WRITE_CYCLE_US = Traits::WRITE_CYCLE_US;
+    //! Геометрия для общего интерфейса памяти (стирания нет, запись побайтовая)
+    static constexpr StorageGeometry GEOMETRY {Traits::CAPACITY, PAGE_SIZE, {0, 0, 0}, 0xFF, false, false};
+    //! Список ошибок
+     enum class error{
+        OK,                         ///<Нет ошибки
+        ADDRESS_OUT_OF_RANGE,       ///<Адрес выходит за пределы памяти
+        INDEX_BIT_OUT_OF_RANGE,     ///<Индекс бита выходит за пределы байта
+        WRITE_NOT_ENABLED,          ///<Попытка записи при отключенной возможности записи
+        NULL_POINTER,               ///<Передан нулевой указатель
+        VERIFY_FAILED               ///<Прочитанные после записи данные не совпали с записанными
+    };
+
+    private:
+    //! Экземпляр драйвера
+    IDriver* _driver;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Количество пропущенных циклов записи (данные уже совпадали)
+    uint32_t _skippedWrites {0};
+    //! Проверять записанные данные чтением
+    bool _verifyWrites {false};
+    //! Журнал трассировки (nullptr - выключена)
+    TraceRing* _tracer {nullptr};
+    //! Ожидание окончания записи
+    void wait();
+    /*!
+        Записать данные в пределах одной страницы (один цикл записи)
+        \param[in] address Адрес начала записи
+        \param[in] data Указатель на данные
+        \param[in] length Длина данных (не выходит за границу страницы)
+        \return true - запись выполнена, false - запись не разрешена
+    */
+    bool programPage(address_type address, const uint8_t* data, uint16_t length);
+    /*!
+        Рассчитать CRC32 области, прочитав ее одной транзакцией
+        \param[in] address Адрес начала (область проверена вызывающим)
+        \param[in] length Длина области
+    */
+    uint32_t readCRC(address_type address, address_type length);
+    /*!
+        Проверить запись, если она включена
+        \param[in] address Адрес начала записанной области
+        \param[in] length Длина области
+        \param[in] expected CRC32 записанных данных
+        \return true - проверка выключена или CRC совпадает, иначе error::VERIFY_FAILED
+    */
+    bool verifyRange(address_type address, address_type length, uint32_t expected);
+    //! Преобразовать код ошибки в общий код памяти
+    static storageError toStorageError(error code);
+
+    /*!
+        Отправить инструкцию и адрес
+
+        Адрес передается ADDRESS_BITS / 8 байтами; при 9-битной адресации
+        старший бит встраивается в инструкцию
+        \param[in] instr Инструкция
+        \param[in] address Адрес
+    */
+    void sendCommand(instruction instr, address_type address);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] driver Указатель на экземпляр драйвера
+    */
+    EEPROM25LCxxx(IDriver* driver);
+    /*! Функция проверки состояния ошибки
+
+        Все функции кроме readStatus() и checkError() в случае успеха устанавливают error::OK
+        Рекомендуется вызывать эту функцию после каждой операции чтения/записи для проверки успешности операции
+
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Запросить данные регистра состояния
+        \return Байт данных регистра
+    */
+    uint8_t readStatus();
+    /*!
+        Количество пропущенных циклов записи
+
+        writeByte(), writeBit() и writeArray() перед записью читают страницу и не выполняют
+        цикл записи (до WRITE_CYCLE_US), если данные в памяти уже совпадают с записываемыми
+        \return Число пропущенных циклов записи с момента создания или последнего сброса
+    */
+    uint32_t skippedWrites() const;
+    //! Сбросить счетчик пропущенных циклов записи
+    void resetSkippedWrites();
+    /*!
+        Включить проверку записи
+
+        writeByte(), writeBit() и writeArray() после записи читают область одной
+        транзакцией и сравнивают ее CRC32 с CRC32 данных, при несовпадении -
+        error::VERIFY_FAILED. writeArray() проверяет весь диапазон одним чтением
+        \param[in] enable true - проверять
+    */
+    void setVerifyWrites(bool enable);
+    //! Включена ли проверка записи
+    bool verifyWrites() const;
+    /*!
+        Включить трассировку
+
+        Методы, обращающиеся к микросхеме, циклы записи и ожидание их окончания
+        записывают интервалы с адресом и длиной в журнал
+        \param[in] tracer Журнал (nullptr - выключить)
+    */
+    void setTracer(TraceRing* tracer);
+    /*!
+        Рассчитать CRC32 области, прочитав ее одной транзакцией
+        \param[in] address Адрес начала
+        \param[in] length Длина области
+        \return CRC32 содержимого (0 при ошибке)
+    */
+    uint32_t checksum(address_type address, address_type length);
+    /*!
+        Прочитать байт
+        \param[in] address Адрес байта
+        \return Запрошнный байт
+    */
+    uint8_t readByte(address_type address);
+    /*!
+        Записать байт по адресу
+
+        Если байт в памяти уже совпадает с записываемым, цикл записи не выполняется
+        \param[in] address Адрес байта для записи
+        \param[in] byte Байт данных
+    */
+    void writeByte(address_type address, uint8_t byte);
+    /*!
+        Прочитать бит
+        \param[in] address Адрес байта
+        \param[in] index Индекс бита (0-7)
+        \return Значение бита (0 или 1)
+    */
+    bool readBit(address_type address, uint8_t index);
+    /*!
+        Записать бит
+
+        Дорогая операция: чтение -> модификация -> запись байта
+
+        \param[in] address Адрес байта
+        \param[in] index Индекс бита (0-7)
+        \param[in] value Значение бита (0 или 1)
+    */
+    void writeBit(address_type address, uint8_t index, bool value);
+    /*!
+        Прочитать массив байт
+        \param[in] address Адрес начала чтения
+        \param[in] length Длина массива в байтах
+        \param[out] out Указатель на массив для записи данных
+    */
+    void readArray(address_type address, address_type length, uint8_t* out);
+    /*!
+        Записать массив байт
+
+        Каждая страница предварительно читается одной транзакцией: страницы без изменений
+        пропускаются, для остальных записывается только диапазон от первого до последнего
+        измененного байта
+        \param[in] address Адрес начала записи
+        \param[in] length Длина массива в байтах
+        \param[in] data Указатель на массив с данными для записи
+    */
+    void writeArray(address_type address, address_type length, const uint8_t* data);
+
+    //! Геометрия памяти (IStorage)
+    const StorageGeometry& geometry() const override;
+    //! Прочитать данные (IStorage), см. readArray()
+    storageError read(uint32_t address, uint32_t length, uint8_t* out) override;
+    //! Записать данные (IStorage), см. writeArray()
+    storageError program(uint32_t address, uint32_t length, const uint8_t* data) override;
+    //! Стирание не поддерживается EEPROM (IStorage), всегда NOT_SUPPORTED
+    storageError erase(uint32_t address, uint32_t length) override;
+};
+
+extern template class EEPROM25LCxxx<traits25LC010A>;
+extern template class EEPROM25LCxxx<traits25LC020A>;
+extern template class EEPROM25LCxxx<traits25LC040A>;
+extern template class EEPROM25LCxxx<traits25LC080A>;
+extern template class EEPROM25LCxxx<traits25LC080B>;
+extern template class EEPROM25LCxxx<traits25LC160A>;
+extern template class EEPROM25LCxxx<traits25LC160B>;
+extern template class EEPROM25LCxxx<traits25LC320A>;
+extern template class EEPROM25LCxxx<traits25LC640A>;
+extern template class EEPROM25LCxxx<traits25LC128>;
+extern template class EEPROM25LCxxx<traits25LC256>;
+extern template class EEPROM25LCxxx<traits25LC512>;
+extern template class EEPROM25LCxxx<traits25LC1024>;
+
+using EEPROM25LC010A = EEPROM25LCxxx<traits25LC010A>;
+using EEPROM25LC020A = EEPROM25LCxxx<traits25LC020A>;
+using EEPROM25LC040A = EEPROM25LCxxx<traits25LC040A>;
+using EEPROM25LC080A = EEPROM25LCxxx<traits25LC080A>;
+using EEPROM25LC080B = EEPROM25LCxxx<traits25LC080B>;
+using EEPROM25LC160A = EEPROM25LCxxx<traits25LC160A>;
+using EEPROM25LC160B = EEPROM25LCxxx<traits25LC160B>;
+using EEPROM25LC320A = EEPROM25LCxxx<traits25LC320A>;
+using EEPROM25LC640A = EEPROM25LCxxx<traits25LC640A>;
+using EEPROM25LC128 = EEPROM25LCxxx<traits25LC128>;
+using EEPROM25LC256 = EEPROM25LCxxx<traits25LC256>;
+using EEPROM25LC512 = EEPROM25LCxxx<traits25LC512>;
+using EEPROM25LC1024 = EEPROM25LCxxx<traits25LC1024>;
@@ -0,0 +1,153 @@
+/*!
+    \file ABRecordStore.h
+    \brief Атомарно обновляемая запись с двумя копиями в EEPROM
+*/
+#pragma once
+#include "Storage.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class ABRecordStore
+    \brief Атомарно обновляемая запись с двумя копиями в EEPROM
+
+    Область делится на две копии A и B. Копия - страница заголовка и страницы
+    данных. Заголовок: сигнатура, длина записи, порядковый номер, CRC32 данных
+    и CRC32 самого заголовка; он целиком лежит в одной странице и пишется
+    одним циклом записи. Действующая копия - целая (оба CRC совпадают) с
+    большим порядковым номером.
+
+    Изменения накапливаются в RAM. commit() записывает в недействующую копию
+    только страницы, отличающиеся от ее содержимого, затем ее заголовок со
+    следующим порядковым номером. Пока заголовок не записан, действующей
+    остается старая копия, поэтому отключение питания в любой момент оставляет
+    либо старую, либо новую запись целиком.
+
+    Содержимое обеих копий хранится в RAM, поэтому для выбора изменившихся
+    страниц память не читается. Для 25LC040A (512 байт, страница 16 байт)
+    запись может занимать до 240 байт.
+*/
+class ABRecordStore{
+    //! Сигнатура заголовка
+    static constexpr uint16_t HEADER_MAGIC = 0x4241;
+    //! Размер заголовка (байты)
+    static constexpr uint16_t HEADER_SIZE = 16;
+
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MOUNTED,                ///<Запись не смонтирована
+        INVALID_REGION,             ///<Область не помещает две копии, выходит за пределы памяти или память требует стирания
+        NO_VALID_COPY,              ///<Нет ни одной целой копии (нужен format())
+        OUT_OF_RANGE,               ///<Смещение и длина выходят за пределы записи
+        NULL_POINTER,               ///<Передан нулевой указатель
+        STORAGE_ERROR               ///<Ошибка операции с памятью
+    };
+    //! Статистика
+    struct statistics{
+        uint32_t commits {0};           ///<Выполнено фиксаций
+        uint32_t pagesWritten {0};      ///<Записано страниц (включая заголовки)
+        uint32_t pagesSkipped {0};      ///<Пропущено неизменных страниц данных
+    };
+
+    private:
+    //! Память
+    IStorage* _storage;
+    //! Адрес начала области
+    uint32_t _start;
+    //! Длина области (байты)
+    uint32_t _length;
+    //! Длина записи (байты)
+    uint16_t _size;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Рабочая копия записи (с незафиксированными изменениями)
+    std::vector<uint8_t> _data;
+    //! Содержимое данных каждой копии в памяти
+    std::vector<uint8_t> _copies[2];
+    //! Содержимое копии в RAM совпадает с памятью
+    bool _known[2] {false, false};
+    //! Действующая копия
+    uint8_t _active {0};
+    //! Порядковый номер действующей копии
+    uint32_t _sequence {0};
+    //! Статистика
+    statistics _stats;
+
+    //! Размер страницы памяти
+    uint16_t pageSize() const;
+    //! Размер копии с заголовком (байты)
+    uint32_t copySize() const;
+    //! Адрес заголовка копии
+    uint32_t copyAddress(uint8_t copy) const;
+    //! Проверить границы области
+    bool validRegion() const;
+    /*!
+        Прочитать копию и проверить ее
+        \param[in] copy Номер копии
+        \param[out] sequence Порядковый номер
+        \return true - копия цела, false - нет (или ошибка памяти в _errorCode)
+    */
+    bool loadCopy(uint8_t copy, uint32_t& sequence);
+    /*!
+        Записать рабочую копию в копию copy с порядковым номером sequence
+        Пишутся только страницы, отличающиеся от известного содержимого копии
+    */
+    bool writeCopy(uint8_t copy, uint32_t sequence);
+    //! Записать заголовок копии
+    bool writeHeader(uint8_t copy, uint32_t sequence, uint32_t crc);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] storage Указатель на память без стирания (EEPROM)
+        \param[in] start Адрес начала области (выровнен по странице)
+        \param[in] length Длина области (не меньше двух копий)
+        \param[in] size Длина записи (байты)
+    */
+    ABRecordStore(IStorage* storage, uint32_t start, uint32_t length, uint16_t size);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Смонтировать: прочитать обе копии и выбрать действующую
+        \return false - ошибка памяти или error::NO_VALID_COPY
+    */
+    bool mount();
+    /*!
+        Записать запись из нулей в копию A и сделать ее действующей
+
+        Заголовок копии B предварительно затирается, чтобы старая копия не
+        оказалась новее
+    */
+    bool format();
+    /*!
+        Прочитать данные рабочей копии
+        \param[in] offset Смещение в записи
+        \param[out] out Буфер
+        \param[in] length Длина данных
+    */
+    bool read(uint16_t offset, uint8_t* out, uint16_t length);
+    /*!
+        Изменить данные рабочей копии (в память попадут при commit())
+        \param[in] offset Смещение в записи
+        \param[in] data Данные
+        \param[in] length Длина данных
+    */
+    bool write(uint16_t offset, const uint8_t* data, uint16_t length);
+    //! Атомарно записать рабочую копию в память
+    bool commit();
+    //! Отменить незафиксированные изменения
+    void rollback();
+    //! Есть ли незафиксированные изменения
+    bool dirty() const;
+    //! Длина записи (байты)
+    uint16_t size() const;
+    //! Порядковый номер действующей копии
+    uint32_t sequence() const;
+    //! Статистика
+    const statistics& stats() const;
+};
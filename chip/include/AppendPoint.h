@@ -0,0 +1,75 @@
+/*!
+    \file AppendPoint.h
+    \brief Поиск точки дописывания в журнале на NOR Flash W25Q128
+*/
+#pragma once
+#include "W25Q128.h"
+#include <cstdint>
+/*!
+    \class AppendPointFinder
+    \brief Поиск точки дописывания в журнале на NOR Flash W25Q128 двоичным поиском
+
+    Область должна заполняться только последовательно от начала к концу: все
+    страницы до первой пустой записаны, все после нее стерты (0xFF). Тогда
+    пустоту достаточно проверять в O(log n) страницах: сначала двоичный поиск
+    по первым страницам секторов, затем по страницам внутри сектора.
+    Каждая проверяемая страница читается целиком одной транзакцией, поэтому
+    данные, начинающиеся с 0xFF, не принимаются за пустоту.
+*/
+class AppendPointFinder{
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        INVALID_REGION,             ///<Область пустая, не выровнена по странице или выходит за пределы памяти
+        CHIP_ERROR                  ///<Ошибка чтения (подробности в NORW25Q128::checkError())
+    };
+
+    private:
+    //! Экземпляр микросхемы
+    NORW25Q128* _chip;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Количество прочитанных страниц при последнем поиске
+    uint32_t _probes {0};
+    /*!
+        Проверить, что страница стерта
+        \param[in] address Адрес начала страницы
+        \param[out] page Содержимое страницы (может быть nullptr)
+        \return true - все байты 0xFF
+    */
+    bool isPageBlank(uint32_t address, uint8_t* page = nullptr);
+    //! Проверить область и сбросить счетчики
+    bool begin(uint32_t start, uint32_t length);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на экземпляр микросхемы
+    */
+    AppendPointFinder(NORW25Q128* chip);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Найти первую пустую страницу
+        \param[in] start Адрес начала области (выровнен по странице)
+        \param[in] length Длина области в байтах (кратна размеру страницы)
+        \return Адрес первой пустой страницы или start + length, если область заполнена
+    */
+    uint32_t findFirstBlankPage(uint32_t start, uint32_t length);
+    /*!
+        Найти точку дописывания с точностью до байта
+
+        После поиска первой пустой страницы в предыдущей странице отбрасываются
+        завершающие байты 0xFF. Записанные данные, оканчивающиеся на 0xFF,
+        неотличимы от стертых, формат журнала должен это учитывать.
+        \param[in] start Адрес начала области (выровнен по странице)
+        \param[in] length Длина области в байтах (кратна размеру страницы)
+        \return Адрес первого незаписанного байта или start + length, если область заполнена
+    */
+    uint32_t findAppendPoint(uint32_t start, uint32_t length);
+    //! Количество страниц, прочитанных при последнем поиске
+    uint32_t probes() const;
+};
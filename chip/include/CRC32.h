@@ -0,0 +1,18 @@
+/*!
+    \file CRC32.h
+    \brief CRC-32 (полином 0x04C11DB7, как в Ethernet и zlib) методом slice-by-8
+*/
+#pragma once
+#include <cstdint>
+/*!
+    Рассчитать CRC32, продолжая предыдущее значение
+
+    Восемь таблиц по 256 значений строятся на этапе компиляции; основной цикл
+    обрабатывает 8 байт за шаг, остаток - по байту. Результат совпадает с
+    побитовым расчетом, поэтому данные, записанные раньше, проверяются так же.
+    \param[in] crc Предыдущее значение (0 для начала)
+    \param[in] data Данные
+    \param[in] length Длина данных
+    \return CRC32 всех данных с начала расчета
+*/
+uint32_t crc32(uint32_t crc, const uint8_t* data, uint32_t length);
@@ -0,0 +1,150 @@
+/*!
+    \file ChipWorker.h
+    \brief Поток ввода-вывода микросхемы с неблокирующей очередью запросов
+*/
+#pragma once
+#include "Storage.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+/*!
+    \class ChipWorker
+    \brief Поток ввода-вывода микросхемы с неблокирующей очередью запросов
+
+    У каждой микросхемы свой поток, который выполняет запросы по очереди,
+    включая ожидание окончания записи и стирания. Потоки приложения только
+    ставят запрос в кольцевую очередь и получают std::future или функцию
+    обратного вызова, поэтому не ждут шину SPI.
+
+    Очередь - ограниченное кольцо для многих производителей и одного
+    потребителя без блокировок: у каждой ячейки атомарный номер, производители
+    занимают ячейку сравнением с обменом. Пустой очередью поток засыпает на
+    условной переменной; производитель обращается к ней, только если поток
+    спит. При заполненном кольце постановка уступает процессор, пока не
+    освободится место.
+
+    Буферы данных и результатов не копируются и должны существовать до
+    завершения запроса. Функция обратного вызова выполняется в потоке
+    микросхемы. Пока существует ChipWorker, микросхемой нельзя пользоваться
+    напрямую из других потоков.
+*/
+class ChipWorker{
+    public:
+    //! Функция обратного вызова (вызывается в потоке микросхемы)
+    using callback = std::function<void(storageError)>;
+    //! Статистика
+    struct statistics{
+        uint64_t completed {0};     ///<Выполнено запросов
+        uint64_t wakeups {0};       ///<Пробуждений спящего потока
+        uint64_t fullWaits {0};     ///<Постановок, ждавших места в кольце
+    };
+
+    private:
+    //! Тип запроса
+    enum class operation : uint8_t{
+        READ,                       ///<Чтение
+        PROGRAM,                    ///<Запись
+        ERASE                       ///<Стирание
+    };
+    //! Запрос
+    struct job{
+        operation type {operation::READ};           ///<Тип
+        uint32_t address {0};                       ///<Адрес
+        uint32_t length {0};                        ///<Длина
+        const uint8_t* data {nullptr};              ///<Данные записи
+        uint8_t* out {nullptr};                     ///<Буфер чтения
+        std::promise<storageError> promise;         ///<Результат для future (если нет callback)
+        callback done;                              ///<Функция обратного вызова
+    };
+    //! Ячейка кольца
+    struct slot{
+        std::atomic<size_t> sequence;               ///<Номер: позиция - свободна, позиция + 1 - занята
+        job value;                                  ///<Запрос
+    };
+    //! Память
+    IStorage* _storage;
+    //! Кольцо
+    std::unique_ptr<slot[]> _slots;
+    //! Маска индекса кольца (емкость - 1)
+    size_t _mask;
+    //! Позиция записи (производители)
+    alignas(64) std::atomic<size_t> _tail {0};
+    //! Позиция чтения (только поток микросхемы)
+    alignas(64) size_t _head {0};
+    //! Поток спит или собирается заснуть
+    std::atomic<bool> _sleeping {false};
+    //! Запрошена остановка
+    std::atomic<bool> _stop {false};
+    //! Мьютекс условной переменной (только для сна)
+    std::mutex _mutex;
+    //! Пробуждение потока
+    std::condition_variable _wake;
+    //! Счетчики
+    std::atomic<uint64_t> _completed {0};
+    std::atomic<uint64_t> _wakeups {0};
+    std::atomic<uint64_t> _fullWaits {0};
+    //! Поток микросхемы
+    std::thread _thread;
+
+    //! Поставить запрос (false - кольцо заполнено, запрос не тронут)
+    bool tryPush(job& j);
+    //! Поставить запрос, ожидая места
+    void push(job& j);
+    //! Есть ли запрос в голове кольца
+    bool ready() const;
+    //! Цикл потока микросхемы
+    void run();
+    //! Выполнить запрос
+    void execute(job& j);
+    //! Поставить запрос и вернуть future
+    std::future<storageError> submit(job& j);
+
+    public:
+    /*!
+        Конструктор, запускает поток микросхемы
+        \param[in] storage Указатель на память (микросхема или том)
+        \param[in] capacity Емкость кольца (степень двойки)
+    */
+    ChipWorker(IStorage* storage, size_t capacity = 256);
+    //! Выполняет оставшиеся запросы и останавливает поток
+    ~ChipWorker();
+    ChipWorker(const ChipWorker&) = delete;
+    ChipWorker& operator=(const ChipWorker&) = delete;
+    /*!
+        Прочитать данные
+        \param[in] address Адрес
+        \param[in] length Длина
+        \param[out] out Буфер (существует до завершения)
+        \return Результат операции
+    */
+    std::future<storageError> read(uint32_t address, uint32_t length, uint8_t* out);
+    //! Прочитать данные с функцией обратного вызова
+    void read(uint32_t address, uint32_t length, uint8_t* out, callback done);
+    /*!
+        Записать данные
+        \param[in] address Адрес
+        \param[in] length Длина
+        \param[in] data Данные (существуют до завершения)
+        \return Результат операции
+    */
+    std::future<storageError> program(uint32_t address, uint32_t length, const uint8_t* data);
+    //! Записать данные с функцией обратного вызова
+    void program(uint32_t address, uint32_t length, const uint8_t* data, callback done);
+    /*!
+        Стереть область
+        \param[in] address Адрес
+        \param[in] length Длина
+        \return Результат операции
+    */
+    std::future<storageError> erase(uint32_t address, uint32_t length);
+    //! Стереть область с функцией обратного вызова
+    void erase(uint32_t address, uint32_t length, callback done);
+    //! Статистика
+    statistics stats() const;
+};
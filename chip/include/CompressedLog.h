@@ -0,0 +1,170 @@
+/*!
+    \file CompressedLog.h
+    \brief Журнал со сжатием блоков поверх памяти IStorage
+*/
+#pragma once
+#include "LZCodec.h"
+#include "Storage.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class CompressedLog
+    \brief Журнал со сжатием блоков поверх памяти IStorage
+
+    Записи дописываются в буфер блока в RAM. Заполненный блок (BLOCK_SIZE байт
+    данных) или блок, сброшенный flush(), сжимается LZCodec и записывается
+    кадром с начала следующей страницы. Если сжатие не уменьшает блок, он
+    записывается без сжатия.
+
+    Формат кадра: заголовок (сигнатура, тип, длина данных, длина кадра,
+    логическое смещение блока, CRC32 данных), затем сжатые данные. Заголовок
+    программируется последним, поэтому кадр с целым заголовком записан полностью.
+
+    Индекс логическое смещение -> адрес кадра хранится в RAM и восстанавливается
+    mount() чтением одних заголовков. Чтение по произвольному смещению
+    распаковывает только блоки, содержащие запрошенные данные; последний
+    распакованный блок кэшируется.
+*/
+class CompressedLog{
+    //! Сигнатура заголовка кадра
+    static constexpr uint16_t FRAME_MAGIC = 0x5A4C;
+    //! Размер заголовка кадра (байты)
+    static constexpr uint32_t FRAME_HEADER_SIZE = 16;
+    //! Тип кадра
+    enum frameType : uint8_t{
+        RAW = 0x00,                 ///<Данные без сжатия
+        LZ = 0x01                   ///<Данные сжаты LZCodec
+    };
+
+    public:
+    //! Размер блока данных до сжатия (байты)
+    static constexpr uint32_t BLOCK_SIZE = 4096;
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MOUNTED,                ///<Журнал не смонтирован
+        INVALID_REGION,             ///<Область не выровнена по стиранию или выходит за пределы памяти
+        NULL_POINTER,               ///<Передан нулевой указатель
+        LOG_FULL,                   ///<Кадр не помещается в остаток области
+        OUT_OF_RANGE,               ///<Чтение за концом журнала
+        CORRUPTED,                  ///<Кадр не распаковывается или не совпадает CRC
+        STORAGE_ERROR               ///<Ошибка операции с памятью
+    };
+    //! Статистика
+    struct statistics{
+        uint32_t blocks {0};            ///<Записано кадров
+        uint32_t rawBytes {0};          ///<Байт данных в записанных кадрах
+        uint32_t storedBytes {0};       ///<Байт записано в память (с заголовками)
+        uint32_t decompressed {0};      ///<Распаковано блоков при чтении
+    };
+
+    private:
+    //! Элемент индекса
+    struct block{
+        uint32_t offset;            ///<Логическое смещение первого байта блока
+        uint32_t address;           ///<Адрес кадра
+        uint16_t rawLength;         ///<Длина данных блока
+    };
+    //! Память
+    IStorage* _storage;
+    //! Адрес начала области
+    uint32_t _start;
+    //! Длина области (байты)
+    uint32_t _length;
+    //! Сжимать блоки
+    bool _compression;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Индекс записанных блоков по возрастанию смещения
+    std::vector<block> _index;
+    //! Адрес следующего кадра
+    uint32_t _next {0};
+    //! Данные еще не записанного блока
+    std::vector<uint8_t> _buffer;
+    //! Номер блока в кэше (SIZE_MAX - кэш пуст)
+    size_t _cached {SIZE_MAX};
+    //! Распакованный блок
+    std::vector<uint8_t> _cache;
+    //! Кодек
+    LZCodec _codec;
+    //! Статистика
+    statistics _stats;
+
+    //! Логическое смещение начала буфера
+    uint32_t bufferOffset() const;
+    //! Адрес начала страницы, округленный вверх
+    uint32_t alignPage(uint32_t address) const;
+    //! Проверить границы и выравнивание области
+    bool validRegion() const;
+    //! Сбросить индекс, буфер и кэш
+    void reset();
+    //! Прочитать данные из памяти, false - ошибка памяти
+    bool readStorage(uint32_t address, uint8_t* out, uint32_t length);
+    /*!
+        Проверить, что страница стерта
+        \param[in] address Адрес начала страницы
+        \param[out] blank true - все байты равны значению стертой памяти
+        \return false - ошибка памяти
+    */
+    bool isPageBlank(uint32_t address, bool& blank);
+    /*!
+        Прочитать и распаковать кадр
+        \param[in] address Адрес кадра
+        \param[out] out Буфер BLOCK_SIZE байт
+        \param[out] item Заголовок кадра (смещение и длина данных)
+        \return true - кадр цел, false - ошибка в _errorCode
+    */
+    bool loadFrame(uint32_t address, uint8_t* out, block& item);
+    //! Записать буфер кадром
+    bool writeBlock();
+
+    public:
+    /*!
+        Конструктор
+        \param[in] storage Указатель на память
+        \param[in] start Адрес начала области (выровнен по стиранию)
+        \param[in] length Длина области (кратна размеру стирания)
+        \param[in] compression true - сжимать блоки, false - писать кадры без сжатия
+    */
+    CompressedLog(IStorage* storage, uint32_t start, uint32_t length, bool compression = true);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    //! Стереть область и смонтировать пустой журнал
+    bool format();
+    /*!
+        Смонтировать журнал: восстановить индекс по заголовкам кадров
+
+        Страницы оборванного кадра (данные записаны, заголовок нет) пропускаются:
+        следующий кадр ищется на границах страниц до первой стертой страницы,
+        найденный после повреждения принимается, только если совпадает CRC.
+        Новый кадр записывается с первой стертой страницы
+    */
+    bool mount();
+    /*!
+        Дописать данные
+        \param[in] data Данные
+        \param[in] length Длина данных
+    */
+    bool append(const uint8_t* data, uint32_t length);
+    /*!
+        Записать неполный блок из буфера
+
+        Следующие данные начнут новый блок, поэтому частый flush() ухудшает сжатие
+    */
+    bool flush();
+    /*!
+        Прочитать данные по логическому смещению (включая еще не записанные)
+        \param[in] offset Логическое смещение
+        \param[out] out Буфер
+        \param[in] length Длина данных
+    */
+    bool read(uint32_t offset, uint8_t* out, uint32_t length);
+    //! Логический размер журнала (байты)
+    uint32_t size() const;
+    //! Статистика
+    const statistics& stats() const;
+};
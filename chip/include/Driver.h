@@ -16,4 +16,29 @@ class IDriver{
         \return Принятый байт
     */
     virtual uint8_t transfer(uint8_t byte) = 0;
+    /*! \brief Передать и получить блок байтов
+
+        По умолчанию вызывает transfer() для каждого байта. Драйвер может
+        передать блок целиком (DMA, одно сообщение), а если ответ не нужен -
+        отложить передачу до следующего байта, ответ которого нужен, или до
+        снятия выбора.
+        \param[in] tx Байты для передачи (nullptr - передаются 0xFF)
+        \param[out] rx Принятые байты (nullptr - ответ не нужен)
+        \param[in] length Количество байтов
+    */
+    virtual void transferBlock(const uint8_t* tx, uint8_t* rx, uint32_t length) {
+        for (uint32_t i{0}; i < length; i++) {
+            uint8_t byte = transfer(tx != nullptr ? tx[i] : 0xFF);
+            if (rx != nullptr) {
+                rx[i] = byte;
+            }
+        }
+    }
+    /*! \brief Пауза между опросами занятой микросхемы
+
+        Вызывается оберткой, пока микросхема выполняет запись или стирание,
+        вне транзакции. По умолчанию ничего не делает; драйвер общей шины
+        может уступить шину и процессор другим устройствам.
+    */
+    virtual void idle() {}
 };
\ No newline at end of file
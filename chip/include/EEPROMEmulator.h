@@ -0,0 +1,180 @@
+/*!
+    \file EEPROMEmulator.h
+    \brief Эмуляция побайтовой EEPROM поверх NOR Flash W25Q128
+*/
+#pragma once
+#include "W25Q128.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class EEPROMEmulator
+    \brief Эмуляция побайтовой EEPROM поверх NOR Flash W25Q128
+
+    Повторяет интерфейс EEPROM25LC040A, чтобы код с побайтовой записью работал
+    на NOR без стирания сектора на каждый байт.
+
+    Используются два сектора - наименьшие единицы стирания микросхемы
+    (geometry().minEraseSize()). Активный сектор содержит заголовок (сигнатура,
+    порядковый номер), снимок всей памяти и журнал изменений: каждая запись
+    журнала - адрес, значение и контрольный байт (4 байта). Запись байта - это
+    одна короткая страничная запись в журнал. Когда журнал заполнен, текущее
+    содержимое записывается снимком во второй сектор, его заголовок пишется
+    последним, после чего старый сектор стирается.
+
+    Чтение выполняется из копии памяти в RAM и не обращается к микросхеме.
+*/
+class EEPROMEmulator{
+    //! Сигнатура заголовка сектора
+    static constexpr uint32_t SECTOR_MAGIC = 0x4D455045;
+    //! Размер заголовка сектора (байты)
+    static constexpr uint32_t SECTOR_HEADER_SIZE = 8;
+    //! Размер записи журнала (байты)
+    static constexpr uint32_t RECORD_SIZE = 4;
+
+    public:
+    //! Объем памяти по умолчанию (как у 25LC040A)
+    static constexpr uint16_t DEFAULT_CAPACITY = 512;
+    //! Максимальный объем эмулируемой памяти
+    static constexpr uint16_t MAX_CAPACITY = 2048;
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        ADDRESS_OUT_OF_RANGE,       ///<Адрес выходит за пределы памяти
+        INDEX_BIT_OUT_OF_RANGE,     ///<Индекс бита выходит за пределы байта
+        NULL_POINTER,               ///<Передан нулевой указатель
+        NOT_MOUNTED,                ///<Эмулятор не смонтирован
+        INVALID_REGION,             ///<Сектора не выровнены, выходят за пределы памяти, объем больше MAX_CAPACITY или снимок не помещается в сектор
+        CHIP_ERROR                  ///<Ошибка операции с микросхемой (подробности в NORW25Q128::checkError())
+    };
+
+    private:
+    //! Экземпляр микросхемы
+    NORW25Q128* _chip;
+    //! Адрес первого из двух секторов
+    uint32_t _start;
+    //! Объем эмулируемой памяти
+    uint16_t _capacity;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Копия содержимого памяти
+    std::vector<uint8_t> _image;
+    //! Активный сектор (0 или 1)
+    uint8_t _active {0};
+    //! Порядковый номер активного сектора
+    uint32_t _sequence {0};
+    //! Смещение следующей записи журнала в активном секторе
+    uint32_t _journalOffset {0};
+    //! Количество выполненных уплотнений
+    uint32_t _consolidations {0};
+
+    //! Размер сектора микросхемы
+    uint32_t sectorSize() const;
+    //! Адрес сектора
+    uint32_t sectorAddress(uint8_t sector) const;
+    //! Проверить область и объем (при ошибке устанавливает INVALID_REGION)
+    bool checkRegion();
+    //! Смещение начала журнала в секторе
+    uint32_t journalStart() const;
+    //! Контрольный байт записи журнала
+    static uint8_t recordCheck(uint16_t address, uint8_t value);
+    /*!
+        Записать данные, разбивая их по границам страниц
+        \return true - успешно, false - ошибка микросхемы
+    */
+    bool program(uint32_t address, const uint8_t* data, uint32_t length);
+    /*!
+        Записать снимок во второй сектор и стереть активный
+
+        Копия памяти заменяется снимком, как только записан заголовок
+        второго сектора: с этого момента монтирование выберет его
+        \param[in] image Новое содержимое памяти
+        \return true - успешно, false - ошибка микросхемы
+    */
+    bool consolidate(const std::vector<uint8_t>& image);
+    /*!
+        Дописать изменения в журнал и применить их к копии
+
+        Копия меняется только после успешной записи. При ошибке записи
+        журнала место попытки пропускается, а уплотнение отменяет
+        частично записанные записи
+        \param[in] address Адрес начала
+        \param[in] length Длина
+        \param[in] data Новые данные
+    */
+    void store(uint16_t address, uint16_t length, const uint8_t* data);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на экземпляр микросхемы
+        \param[in] startAddress Адрес первого из двух секторов (выровнен по сектору)
+        \param[in] capacity Объем эмулируемой памяти в байтах
+    */
+    EEPROMEmulator(NORW25Q128* chip, uint32_t startAddress, uint16_t capacity = DEFAULT_CAPACITY);
+    /*! Функция проверки состояния ошибки
+
+        Все функции кроме checkError() в случае успеха устанавливают error::OK
+
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Смонтировать эмулятор
+
+        Выбирает целый сектор с большим порядковым номером, загружает снимок
+        и применяет журнал. Если целого сектора нет, память форматируется (0xFF).
+        Второй сектор не трогается: уплотнение стирает его перед записью.
+    */
+    void mount();
+    //! Стереть оба сектора и заполнить память значением 0xFF
+    void format();
+    /*!
+        Прочитать байт
+        \param[in] address Адрес байта
+        \return Запрошнный байт
+    */
+    uint8_t readByte(uint16_t address);
+    /*!
+        Записать байт по адресу
+
+        Если байт уже совпадает с записываемым, запись не выполняется
+        \param[in] address Адрес байта для записи
+        \param[in] byte Байт данных
+    */
+    void writeByte(uint16_t address, uint8_t byte);
+    /*!
+        Прочитать бит
+        \param[in] address Адрес байта
+        \param[in] index Индекс бита (0-7)
+        \return Значение бита (0 или 1)
+    */
+    bool readBit(uint16_t address, uint8_t index);
+    /*!
+        Записать бит
+        \param[in] address Адрес байта
+        \param[in] index Индекс бита (0-7)
+        \param[in] value Значение бита (0 или 1)
+    */
+    void writeBit(uint16_t address, uint8_t index, bool value);
+    /*!
+        Прочитать массив байт
+        \param[in] address Адрес начала чтения
+        \param[in] length Длина массива в байтах
+        \param[out] out Указатель на массив для записи данных
+    */
+    void readArray(uint16_t address, uint16_t length, uint8_t* out);
+    /*!
+        Записать массив байт
+
+        В журнал попадают только измененные байты, записи идут подряд и
+        пишутся одной страничной записью на страницу
+        \param[in] address Адрес начала записи
+        \param[in] length Длина массива в байтах
+        \param[in] data Указатель на массив с данными для записи
+    */
+    void writeArray(uint16_t address, uint16_t length, const uint8_t* data);
+    //! Количество уплотнений журнала (каждое - одно стирание сектора)
+    uint32_t consolidations() const;
+};
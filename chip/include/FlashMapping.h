@@ -0,0 +1,127 @@
+/*!
+    \file FlashMapping.h
+    \brief Отображение содержимого NOR Flash в память процесса с чтением по требованию
+*/
+#pragma once
+#include "W25Q128.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+/*!
+    \class FlashMapping
+    \brief Отображение содержимого NOR Flash в память процесса с чтением по требованию
+
+    Область памяти микросхемы доступна только для чтения по указателю data(),
+    без предварительного копирования. На Linux с userfaultfd регион
+    резервируется mmap() без данных; первое обращение к странице вызывает
+    ошибку страницы, которую обрабатывает отдельный поток: страница читается
+    одной транзакцией FAST READ и подставляется в регион (UFFDIO_COPY).
+    Читаются только затронутые страницы. Если ядро не смогло подставить
+    страницу, подставляется нулевая страница и учитывается ошибка чтения,
+    чтобы обратившийся поток не остался заблокированным.
+
+    Если userfaultfd недоступен (другая ОС, запрет ядра, нет прав), работает
+    явный кэш страниц: data() возвращает nullptr, доступ - через page(),
+    который загружает страницу при первом обращении. page() работает в обоих
+    режимах, поэтому код разбора может не зависеть от режима.
+
+    Пока отображение существует, микросхемой нельзя пользоваться из других
+    потоков в обход него: страницы читает поток обработчика. Изменения
+    памяти после загрузки страницы не видны.
+*/
+class FlashMapping{
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MAPPED,                 ///<Отображение не создано
+        ADDRESS_OUT_OF_RANGE,       ///<Область выходит за пределы памяти или пуста
+        ALLOCATION_FAILED,          ///<Не удалось выделить память кэша
+        CHIP_ERROR                  ///<Ошибка чтения (страница заполнена стертым значением)
+    };
+    //! Статистика
+    struct statistics{
+        uint64_t pagesLoaded {0};   ///<Загружено страниц
+        uint64_t readErrors {0};    ///<Ошибок чтения страниц
+    };
+
+    private:
+    //! Микросхема
+    NORW25Q128* _chip;
+    //! Адрес начала области
+    uint32_t _address;
+    //! Длина области
+    uint32_t _length;
+    //! Размер страницы
+    uint32_t _pageSize {4096};
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Регион userfaultfd (nullptr - не создан)
+    uint8_t* _region {nullptr};
+    //! Размер региона (кратен странице)
+    size_t _regionSize {0};
+    //! Дескриптор userfaultfd
+    int _uffd {-1};
+    //! Дескриптор для остановки обработчика
+    int _stopFd {-1};
+    //! Поток обработчика ошибок страниц
+    std::thread _handler;
+    //! Кэш страниц (режим без userfaultfd)
+    std::unique_ptr<uint8_t[]> _cache;
+    //! Загружена ли страница кэша
+    std::vector<bool> _loaded;
+    //! Загружено страниц
+    std::atomic<uint64_t> _pagesLoaded {0};
+    //! Ошибок чтения
+    std::atomic<uint64_t> _readErrors {0};
+
+    //! Прочитать страницу index в буфер (при ошибке - стертое значение)
+    void loadPage(uint32_t index, uint8_t* out);
+    //! Создать регион userfaultfd
+    bool mapLazy();
+    //! Цикл обработчика ошибок страниц
+    void serveFaults();
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на микросхему
+        \param[in] address Адрес начала области
+        \param[in] length Длина области (байты)
+    */
+    FlashMapping(NORW25Q128* chip, uint32_t address, uint32_t length);
+    //! Снимает отображение
+    ~FlashMapping();
+    FlashMapping(const FlashMapping&) = delete;
+    FlashMapping& operator=(const FlashMapping&) = delete;
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Создать отображение
+        \param[in] allowUserfault true - использовать userfaultfd, если доступен
+        \return true - отображение создано (в одном из режимов)
+    */
+    bool map(bool allowUserfault = true);
+    //! Снять отображение
+    void unmap();
+    //! Работает ли отображение через userfaultfd
+    bool lazy() const;
+    //! Указатель на начало области (nullptr в режиме кэша страниц)
+    const uint8_t* data() const;
+    /*!
+        Указатель на байт области, действительный до конца его страницы
+        \param[in] offset Смещение от начала области
+        \return nullptr - смещение вне области или отображение не создано
+    */
+    const uint8_t* page(uint32_t offset);
+    //! Размер страницы (байты)
+    uint32_t pageSize() const;
+    //! Длина области (байты)
+    uint32_t size() const;
+    //! Статистика
+    statistics stats() const;
+};
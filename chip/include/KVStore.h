@@ -0,0 +1,280 @@
+/*!
+    \file KVStore.h
+    \brief Журналируемое хранилище ключ-значение поверх NOR Flash W25Q128
+*/
+#pragma once
+#include "W25Q128.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+/*!
+    \class KVStore
+    \brief Журналируемое хранилище ключ-значение поверх NOR Flash W25Q128
+
+    Область памяти из нескольких секторов используется как кольцевой журнал.
+    Каждая запись (и удаление) дописывается в конец активного сектора, поэтому
+    изменение значения не требует стирания сектора. Индекс ключ -> адрес записи
+    хранится в RAM и восстанавливается функцией mount().
+
+    Формат сектора: заголовок (сигнатура, порядковый номер), затем записи подряд.
+    Формат записи: длина ключа, тип, длина значения, CRC32, ключ, значение.
+
+    Сектор хранилища - SECTOR_SIZE байт независимо от микросхемы; он стирается
+    через erase() и должен быть кратен наименьшему стиранию микросхемы, а
+    страница записи микросхемы - кратна 256 байтам.
+
+    Освобождение места выполняется по принципу FIFO: актуальные записи самого
+    старого сектора переносятся в активный, после чего сектор стирается.
+    Один сектор всегда остается стертым в резерве для переноса.
+
+    Если задана область контрольных точек, индекс периодически сохраняется в нее
+    целиком. При монтировании загружается последняя целая контрольная точка и
+    читаются только записи, сделанные после нее, а не весь журнал. Область делится
+    на две половины: точки дописываются в текущую, при ее заполнении стирается
+    и используется другая, поэтому целая точка есть всегда.
+*/
+class KVStore{
+    //! Тип записи
+    enum recordType : uint8_t{
+        VALUE = 0x01,               ///<Запись со значением
+        TOMBSTONE = 0x02            ///<Отметка об удалении ключа
+    };
+    //! Сигнатура заголовка сектора
+    static constexpr uint32_t SECTOR_MAGIC = 0x3153564B;
+    //! Порядковый номер стертого сектора
+    static constexpr uint32_t ERASED_SEQUENCE = 0xFFFFFFFF;
+    //! Размер заголовка сектора (байты)
+    static constexpr uint32_t SECTOR_HEADER_SIZE = 8;
+    //! Размер заголовка записи (байты)
+    static constexpr uint32_t RECORD_HEADER_SIZE = 8;
+    //! Размер сектора хранилища (байты)
+    static constexpr uint32_t SECTOR_SIZE = 4u * 1024u;
+    //! Сигнатура заголовка контрольной точки
+    static constexpr uint32_t CHECKPOINT_MAGIC = 0x5043564B;
+    //! Размер заголовка контрольной точки (байты)
+    static constexpr uint32_t CHECKPOINT_HEADER_SIZE = 16;
+
+    public:
+    //! Максимальная длина ключа (байты)
+    static constexpr uint16_t MAX_KEY_LENGTH = 64;
+    //! Максимальная длина значения (байты)
+    static constexpr uint16_t MAX_VALUE_LENGTH = SECTOR_SIZE - SECTOR_HEADER_SIZE - RECORD_HEADER_SIZE - MAX_KEY_LENGTH;
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MOUNTED,                ///<Хранилище не смонтировано
+        INVALID_REGION,             ///<Область не выровнена по сектору, выходит за пределы памяти, меньше двух секторов или геометрия микросхемы не подходит
+        KEY_TOO_LONG,               ///<Ключ пустой или длиннее MAX_KEY_LENGTH
+        VALUE_TOO_LONG,             ///<Значение длиннее MAX_VALUE_LENGTH
+        NOT_FOUND,                  ///<Ключ не найден
+        BUFFER_TOO_SMALL,           ///<Буфер меньше значения
+        STORE_FULL,                 ///<Нет места даже после сборки мусора
+        NULL_POINTER,               ///<Передан нулевой указатель
+        NO_CHECKPOINT_AREA,         ///<Область контрольных точек не задана
+        CHECKPOINT_TOO_LARGE,       ///<Контрольная точка не помещается в половину области
+        CHIP_ERROR                  ///<Ошибка операции с микросхемой (подробности в NORW25Q128::checkError())
+    };
+    //! Статистика операций
+    struct statistics{
+        uint32_t puts {0};              ///<Количество записей значений
+        uint32_t removes {0};           ///<Количество удалений
+        uint32_t gets {0};              ///<Количество чтений
+        uint32_t erases {0};            ///<Количество стертых секторов
+        uint32_t programmedBytes {0};   ///<Всего записано байт (включая перенос)
+        uint32_t relocatedBytes {0};    ///<Байт перенесено при сборке мусора
+        uint32_t checkpoints {0};       ///<Количество записанных контрольных точек
+        uint32_t mountReadBytes {0};    ///<Байт прочитано при последнем монтировании
+    };
+
+    private:
+    //! Положение записи в памяти
+    struct entry{
+        uint32_t address;           ///<Адрес заголовка записи
+        uint16_t valueLength;       ///<Длина значения
+    };
+    //! Экземпляр микросхемы
+    NORW25Q128* _chip;
+    //! Адрес начала области
+    uint32_t _start;
+    //! Количество секторов в области
+    uint16_t _sectorCount;
+    //! Количество секторов области контрольных точек (сразу за журналом)
+    uint16_t _checkpointSectors;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Индекс ключ -> положение актуальной записи
+    std::unordered_map<std::string, entry> _index;
+    //! Порядковые номера секторов (ERASED_SEQUENCE для стертых)
+    std::vector<uint32_t> _sequence;
+    //! Количество байт актуальных записей в каждом секторе
+    std::vector<uint32_t> _liveBytes;
+    //! Количество занятых байт в каждом секторе (включая заголовок)
+    std::vector<uint32_t> _usedBytes;
+    //! Активный сектор
+    uint16_t _active {0};
+    //! Следующий порядковый номер сектора
+    uint32_t _nextSequence {0};
+    //! Порядковый номер следующей контрольной точки
+    uint32_t _checkpointSequence {0};
+    //! Текущая половина области контрольных точек
+    uint8_t _checkpointHalf {0};
+    //! Смещение следующей контрольной точки в текущей половине
+    uint32_t _checkpointOffset {0};
+    //! Период контрольных точек (в открытых секторах журнала)
+    uint16_t _checkpointInterval {8};
+    //! Секторов журнала открыто после последней контрольной точки
+    uint16_t _sectorsSinceCheckpoint {0};
+    //! Статистика
+    statistics _stats;
+
+    //! Проверить границы и выравнивание области
+    bool validRegion() const;
+    //! Адрес начала сектора
+    uint32_t sectorAddress(uint16_t sector) const;
+    //! Размер половины области контрольных точек (байты)
+    uint32_t checkpointHalfSize() const;
+    //! Адрес начала половины области контрольных точек
+    uint32_t checkpointAddress(uint8_t half) const;
+    //! Номер сектора по адресу
+    uint16_t sectorOf(uint32_t address) const;
+    //! Размер записи в памяти
+    static uint32_t recordSize(uint16_t keyLength, uint16_t valueLength);
+    //! Количество стертых секторов
+    uint16_t freeSectors() const;
+    //! Самый старый занятый сектор кроме активного (_sectorCount если такого нет)
+    uint16_t oldestSector() const;
+    //! Первый стертый сектор после активного (_sectorCount если такого нет)
+    uint16_t nextErasedSector() const;
+    /*!
+        Записать данные, разбивая их по границам страниц
+        \return true - успешно, false - ошибка микросхемы
+    */
+    bool program(uint32_t address, const uint8_t* data, uint32_t length);
+    //! Прочитать данные, false - ошибка микросхемы
+    bool read(uint32_t address, uint8_t* out, uint16_t length);
+    //! Стереть сектор и сбросить его учет
+    bool eraseSector(uint16_t sector);
+    //! Записать заголовок в стертый сектор и сделать его активным
+    bool openSector(uint16_t sector);
+    /*!
+        Обеспечить место под запись в активном секторе
+        При необходимости открывает следующий сектор и переносит самый старый
+        \param[in] size Размер записи
+    */
+    bool makeRoom(uint32_t size);
+    /*!
+        Перенести актуальные записи сектора в активный и стереть его
+        Отметки об удалении отбрасываются: сектор самый старый, более ранних значений нет
+    */
+    bool collectSector(uint16_t sector);
+    //! Дописать запись в активный сектор и обновить индекс
+    bool appendRecord(recordType type, const std::string& key, const uint8_t* data, uint16_t length);
+    /*!
+        Прочитать записи сектора и применить их к индексу
+        \param[in] sector Номер сектора
+        \param[in] offset Смещение первой непрочитанной записи
+        \return Смещение первого незаписанного байта в секторе или SECTOR_SIZE, если
+        сектор заканчивается поврежденной записью и дописывать в него нельзя
+    */
+    uint32_t scanSector(uint16_t sector, uint32_t offset = SECTOR_HEADER_SIZE);
+    /*!
+        Найти и загрузить последнюю целую контрольную точку
+
+        Восстанавливает индекс и учет секторов, чьи порядковые номера не изменились.
+        Записи из сектора, стертого после контрольной точки, не восстанавливаются:
+        актуальные из них были перенесены и будут прочитаны из хвоста журнала.
+        \param[out] activeSequence Порядковый номер активного сектора на момент точки
+        \param[out] activeUsed Заполнение активного сектора на момент точки
+        \return true - контрольная точка загружена
+    */
+    bool loadCheckpoint(uint32_t& activeSequence, uint32_t& activeUsed);
+    //! Записать контрольную точку, если открыто достаточно новых секторов
+    void checkpointIfDue();
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на экземпляр микросхемы
+        \param[in] startAddress Адрес начала области (выровнен по сектору)
+        \param[in] sectorCount Количество секторов в области (не меньше 2)
+        \param[in] checkpointSectors Количество секторов для контрольных точек сразу за журналом
+        (0 - без контрольных точек, иначе четное число)
+    */
+    KVStore(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount, uint16_t checkpointSectors = 0);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Смонтировать хранилище
+
+        Читает заголовки секторов и записи в порядке их создания, восстанавливая индекс.
+        При наличии контрольной точки читаются только записи, сделанные после нее.
+        Поврежденные сектора стираются, пустая область форматируется.
+    */
+    void mount();
+    /*!
+        Стереть область и смонтировать пустое хранилище
+    */
+    void format();
+    /*!
+        Записать значение
+        \param[in] key Ключ
+        \param[in] data Указатель на данные
+        \param[in] length Длина данных в байтах
+    */
+    void put(const std::string& key, const uint8_t* data, uint16_t length);
+    /*!
+        Прочитать значение
+        \param[in] key Ключ
+        \param[out] out Буфер для значения
+        \param[in] capacity Размер буфера
+        \return Длина значения
+    */
+    uint16_t get(const std::string& key, uint8_t* out, uint16_t capacity);
+    /*!
+        Удалить ключ
+        \param[in] key Ключ
+    */
+    void remove(const std::string& key);
+    /*!
+        Проверить наличие ключа (без обращения к памяти)
+        \param[in] key Ключ
+        \return true - ключ есть
+    */
+    bool contains(const std::string& key) const;
+    //! Количество ключей
+    size_t size() const;
+    /*!
+        Список ключей с заданным префиксом (без обращения к памяти)
+        \param[in] prefix Префикс (пустой - все ключи)
+        \return Ключи по возрастанию
+    */
+    std::vector<std::string> keys(const std::string& prefix) const;
+    /*!
+        Шаг фоновой сборки мусора
+
+        Переносит актуальные записи самого старого сектора и стирает его, если мусора
+        в нем не меньше minGarbage байт. Предназначена для вызова в простое, чтобы
+        put() реже выполнял сборку сам.
+        \param[in] minGarbage Минимальный объем мусора в секторе (байты)
+        \return true - сектор освобожден
+    */
+    bool compactStep(uint32_t minGarbage = SECTOR_SIZE / 4);
+    /*!
+        Записать контрольную точку индекса
+
+        Вызывается автоматически после открытия setCheckpointInterval() новых секторов журнала
+    */
+    void checkpoint();
+    /*!
+        Задать период автоматических контрольных точек
+        \param[in] sectors Количество открытых секторов журнала между точками (0 - только вручную)
+    */
+    void setCheckpointInterval(uint16_t sectors);
+    //! Статистика операций
+    const statistics& stats() const;
+};
@@ -0,0 +1,58 @@
+/*!
+    \file LZCodec.h
+    \brief Блочный LZ-кодек без внешних зависимостей
+*/
+#pragma once
+#include <cstdint>
+/*!
+    \class LZCodec
+    \brief Блочный LZ-кодек без внешних зависимостей
+
+    Формат блока совпадает по устройству с блоком LZ4: последовательности
+    "токен, литералы, смещение, продолжение длины совпадения". Старшие 4 бита
+    токена - число литералов, младшие - длина совпадения минус MIN_MATCH;
+    значение 15 продолжается байтами до первого байта меньше 255. Смещение -
+    2 байта (младший первым), поэтому окно - 64 КБ. Последняя
+    последовательность содержит только литералы.
+
+    Сжатие - один проход с хеш-таблицей последних позиций четырехбайтовых
+    префиксов, таблица хранится в экземпляре (16 КБ), а не на стеке.
+    Распаковка проверяет все границы и не выходит за буферы на поврежденных данных.
+*/
+class LZCodec{
+    //! Минимальная длина совпадения
+    static constexpr uint32_t MIN_MATCH = 4;
+    //! Последние байты блока всегда кодируются литералами
+    static constexpr uint32_t LAST_LITERALS = 5;
+    //! Наибольшее смещение совпадения
+    static constexpr uint32_t MAX_OFFSET = 0xFFFF;
+    //! Разрядность хеша
+    static constexpr uint32_t HASH_BITS = 12;
+    //! Позиция + 1 последнего вхождения префикса (0 - нет)
+    uint32_t _table[1u << HASH_BITS];
+
+    public:
+    /*!
+        Наибольший размер сжатого блока для несжимаемых данных
+        \param[in] length Длина исходных данных
+    */
+    static constexpr uint32_t bound(uint32_t length){ return length + length / 255 + 16; }
+    /*!
+        Сжать блок
+        \param[in] src Исходные данные
+        \param[in] length Длина исходных данных
+        \param[out] dst Буфер сжатых данных
+        \param[in] capacity Размер буфера
+        \return Длина сжатых данных или 0, если они не помещаются в буфер
+    */
+    uint32_t compress(const uint8_t* src, uint32_t length, uint8_t* dst, uint32_t capacity);
+    /*!
+        Распаковать блок
+        \param[in] src Сжатые данные
+        \param[in] length Длина сжатых данных
+        \param[out] dst Буфер исходных данных
+        \param[in] rawLength Ожидаемая длина исходных данных
+        \return true - блок распакован и дал ровно rawLength байт
+    */
+    static bool decompress(const uint8_t* src, uint32_t length, uint8_t* dst, uint32_t rawLength);
+};
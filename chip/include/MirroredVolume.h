@@ -0,0 +1,119 @@
+/*!
+    \file MirroredVolume.h
+    \brief Зеркальный том на нескольких микросхемах NOR Flash с балансировкой чтения
+*/
+#pragma once
+#include "W25Q128.h"
+#include "Storage.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+/*!
+    \class MirroredVolume
+    \brief Зеркальный том на нескольких микросхемах NOR Flash с балансировкой чтения
+
+    Запись и стирание ставятся в очередь каждой копии и выполняются в фоне:
+    у каждой микросхемы в работе не больше одной операции (страница или блок
+    стирания), следующая запускается из service(), когда микросхема освободилась.
+    program() и erase() возвращают управление сразу, flush() дожидается
+    окончания всех операций.
+
+    Чтение каждой страницы направляется в копию, в очереди которой нет
+    операций над этой областью (данные в ней актуальны). Из таких копий
+    выбирается свободная: сначала с пустой очередью, затем не занятая по
+    регистру состояния, затем с самой короткой очередью.
+
+    program() до постановки в очередь проверяет, что запись не требует
+    стирания (по копии, в которой область уже не изменяется очередью), и
+    возвращает NEEDS_ERASE сразу. Копия, на которой операция завершилась
+    ошибкой микросхемы, исключается из тома, ошибка возвращается следующим
+    flush(); resync() копирует в нее данные рабочей копии и возвращает в том.
+*/
+class MirroredVolume : public IStorage{
+    public:
+    //! Статистика чтения
+    struct statistics{
+        uint64_t reads {0};             ///<Прочитано страниц
+        uint64_t idleReads {0};         ///<Из них прочитано из копии без операций в очереди
+        uint64_t busyReads {0};         ///<Из них пришлось ждать занятую копию
+    };
+
+    private:
+    //! Отложенная операция
+    struct operation{
+        bool erase;                     ///<true - стирание, false - запись
+        uint32_t address;               ///<Адрес
+        uint32_t length;                ///<Длина (для стирания - размер блока)
+        std::vector<uint8_t> data;      ///<Данные записи
+    };
+    //! Копия тома
+    struct replica{
+        NORW25Q128* chip;               ///<Микросхема
+        std::deque<operation> queue;    ///<Очередь операций, первая может выполняться
+        bool started {false};           ///<Первая операция очереди запущена
+        bool failed {false};            ///<Копия исключена из-за ошибки
+    };
+    //! Копии тома
+    std::vector<replica> _replicas;
+    //! Геометрия тома
+    StorageGeometry _geometry;
+    //! Первая ошибка фоновой операции
+    storageError _asyncError {storageError::OK};
+    //! Статистика
+    statistics _stats;
+
+    //! Продвинуть очередь копии
+    void service(replica& r);
+    //! Есть ли в очереди копии операции над областью
+    static bool overlaps(const replica& r, uint32_t address, uint32_t length);
+    //! Добавить операцию во все копии
+    void enqueue(const operation& op);
+    //! Выполнить операции очереди копии над областью, false - копия исключена
+    bool settle(replica& r, uint32_t address, uint32_t length);
+    //! Проверить, что запись не требует стирания (по наименее занятой рабочей копии)
+    storageError checkProgram(uint32_t address, uint32_t length, const uint8_t* data);
+
+    public:
+    //! Возможности тома (как у NOR Flash), размеры - в geometry()
+    static constexpr StorageGeometry GEOMETRY = NORW25Q128::GEOMETRY;
+    /*!
+        Конструктор
+        \param[in] chips Микросхемы-копии (не пустой список, без нулевых указателей)
+    */
+    explicit MirroredVolume(std::vector<NORW25Q128*> chips);
+    //! Запустить следующие операции на освободившихся микросхемах
+    void service();
+    /*!
+        Дождаться окончания всех операций
+        \return Первая ошибка фоновых операций с прошлого flush()
+    */
+    storageError flush();
+    //! Количество операций в очередях всех копий
+    uint32_t pending() const;
+    //! Количество рабочих копий
+    uint8_t healthyReplicas() const;
+    //! Исключена ли копия index из-за ошибки
+    bool replicaFailed(size_t index) const;
+    /*!
+        Восстановить копию по рабочей копии и вернуть ее в том
+
+        Дожидается всех операций, затем перезаписывает блоки стирания копии,
+        отличающиеся от рабочей копии. Ошибка фоновых операций сохраняется
+        для следующего flush()
+        \param[in] index Номер копии (порядок конструктора)
+        \return OK - копия рабочая; ADDRESS_OUT_OF_RANGE - нет такой копии;
+                DEVICE_ERROR - нет рабочей копии-источника или ошибка микросхемы
+    */
+    storageError resync(size_t index);
+    //! Статистика чтения
+    const statistics& stats() const;
+
+    //! Геометрия тома: наименьший объем копии, страница и стирание микросхемы
+    const StorageGeometry& geometry() const override;
+    //! Прочитать данные из наименее занятых копий с актуальными данными
+    storageError read(uint32_t address, uint32_t length, uint8_t* out) override;
+    //! Поставить запись во все копии (выполняется в фоне, см. flush())
+    storageError program(uint32_t address, uint32_t length, const uint8_t* data) override;
+    //! Поставить стирание во все копии (выполняется в фоне, см. flush())
+    storageError erase(uint32_t address, uint32_t length) override;
+};
@@ -0,0 +1,119 @@
+/*!
+    \file NORCounter.h
+    \brief Монотонный счетчик на NOR Flash W25Q128 без стирания при инкременте
+*/
+#pragma once
+#include "W25Q128.h"
+#include <cstdint>
+/*!
+    \class NORCounter
+    \brief Монотонный счетчик на NOR Flash W25Q128 без стирания при инкременте
+
+    NOR позволяет без стирания переводить биты из 1 в 0, поэтому счетчик хранится
+    в термометрическом коде: каждый инкремент сбрасывает очередной бит и записывает
+    один байт командой page program.
+
+    Формат страницы: база (значение счетчика на момент открытия страницы), ее
+    инверсия для проверки целостности, затем биты термометра. Значение счетчика -
+    база плюс количество сброшенных битов текущей страницы. Заполненная страница
+    закрывается, база переносится в следующую. Сектора области используются по
+    кругу: после открытия нового сектора предыдущий стирается, поэтому одно
+    стирание приходится на (размер сектора / PAGE_SIZE) * INCREMENTS_PER_PAGE инкрементов.
+
+    Сектор - наименьшая единица стирания микросхемы (geometry().minEraseSize()),
+    страница счетчика - PAGE_SIZE байт; страница записи микросхемы должна быть
+    ей кратна, чтобы запись страницы счетчика не пересекала ее границу.
+*/
+class NORCounter{
+    //! Размер заголовка страницы (база и ее инверсия)
+    static constexpr uint32_t PAGE_HEADER_SIZE = 8;
+
+    public:
+    //! Размер страницы счетчика (байты)
+    static constexpr uint32_t PAGE_SIZE = NORW25Q128::PAGE_SIZE;
+    //! Количество инкрементов на одну страницу
+    static constexpr uint32_t INCREMENTS_PER_PAGE = (PAGE_SIZE - PAGE_HEADER_SIZE) * 8;
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MOUNTED,                ///<Счетчик не смонтирован
+        INVALID_REGION,             ///<Область не выровнена по сектору, выходит за пределы памяти, меньше двух секторов или геометрия микросхемы не подходит
+        CHIP_ERROR                  ///<Ошибка операции с микросхемой (подробности в NORW25Q128::checkError())
+    };
+
+    private:
+    //! Экземпляр микросхемы
+    NORW25Q128* _chip;
+    //! Адрес начала области
+    uint32_t _start;
+    //! Количество секторов в области
+    uint16_t _sectorCount;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Адрес текущей страницы
+    uint32_t _page {0};
+    //! База текущей страницы
+    uint32_t _base {0};
+    //! Количество сброшенных битов в текущей странице
+    uint32_t _count {0};
+    //! Количество выполненных стираний
+    uint32_t _erases {0};
+
+    //! Размер сектора микросхемы
+    uint32_t sectorSize() const;
+    //! Адрес начала сектора
+    uint32_t sectorAddress(uint16_t sector) const;
+    //! Проверить область и геометрию (при ошибке устанавливает INVALID_REGION)
+    bool checkRegion();
+    /*!
+        Прочитать базу страницы
+        \param[in] page Адрес страницы
+        \param[out] base База
+        \return true - заголовок целый
+    */
+    bool readBase(uint32_t page, uint32_t& base);
+    //! Записать заголовок новой страницы и сделать ее текущей
+    bool openPage(uint32_t page, uint32_t base);
+    //! Стереть сектор
+    bool eraseSector(uint16_t sector);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на экземпляр микросхемы
+        \param[in] startAddress Адрес начала области (выровнен по сектору)
+        \param[in] sectorCount Количество секторов в области (не меньше 2)
+    */
+    NORCounter(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Смонтировать счетчик
+
+        Текущий сектор определяется по наибольшей целой базе первых страниц секторов,
+        текущая страница - двоичным поиском первой пустой страницы в нем.
+        Остальные сектора, если они не пусты, стираются. Пустая область
+        форматируется со значением 0.
+    */
+    void mount();
+    /*!
+        Стереть область и начать счет заново
+        \param[in] initial Начальное значение
+    */
+    void format(uint32_t initial = 0);
+    //! Текущее значение счетчика (без обращения к памяти)
+    uint32_t value() const;
+    /*!
+        Увеличить счетчик на 1
+
+        Записывает один байт; при заполнении страницы записывает заголовок следующей,
+        при заполнении сектора переходит в следующий и стирает предыдущий
+    */
+    void increment();
+    //! Количество стираний с момента создания объекта
+    uint32_t erases() const;
+};
@@ -0,0 +1,222 @@
+/*!
+    \file NORFileSystem.h
+    \brief Файловая система с каталогами поверх журнала KVStore на NOR Flash
+*/
+#pragma once
+#include "KVStore.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+/*!
+    \class NORFileSystem
+    \brief Файловая система с каталогами поверх журнала KVStore на NOR Flash
+
+    Хранение журналируемое: каждое изменение - новая запись KVStore, старая
+    становится мусором и освобождается сборкой мусора хранилища. Поэтому
+    перезапись данных не требует стирания сектора (копирование при записи),
+    а износ распределяется по всей области.
+
+    Метаданные файла или каталога (тип, номер, размер) - одна запись с ключом
+    "m" + полный путь и обновляются атомарно. Данные файла хранятся блоками по
+    CHUNK_SIZE байт с ключами "d" + номер файла + номер блока; блок тоже
+    заменяется атомарно. Список каталога - ключи с префиксом пути, без чтения памяти.
+
+    Открытый файл буферизует текущий блок в RAM. sync() и close() записывают
+    сначала блок данных, затем метаданные с новым размером: после сбоя
+    дописанные данные либо видны целиком до последнего sync(), либо не видны.
+    Новый файл появляется в каталоге при первом sync() или close().
+
+    Номера файлов выдаются из запаса, сохраненного в хранилище (ключ "n"),
+    запас пополняется раз в ID_BATCH созданий. Удаление файла сначала
+    записывает отметку "r" + номер, затем удаляет метаданные и блоки; mount()
+    завершает удаление по оставшимся отметкам, поэтому блоки не теряются.
+*/
+class NORFileSystem{
+    //! Тип объекта
+    enum objectType : uint8_t{
+        FILE = 0x01,                ///<Файл
+        DIRECTORY = 0x02            ///<Каталог
+    };
+    //! Размер записи метаданных (байты)
+    static constexpr uint16_t META_SIZE = 9;
+    //! Сколько номеров файлов резервируется одной записью
+    static constexpr uint32_t ID_BATCH = 64;
+
+    public:
+    //! Размер блока данных (байты)
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+    //! Наибольшее количество одновременно открытых файлов
+    static constexpr uint8_t MAX_OPEN_FILES = 4;
+    //! Наибольшая длина пути (байты)
+    static constexpr uint16_t MAX_PATH_LENGTH = KVStore::MAX_KEY_LENGTH - 1;
+    //! Режимы открытия (битовая маска)
+    enum openMode : uint8_t{
+        READ = 0x01,                ///<Чтение
+        WRITE = 0x02,               ///<Запись
+        CREATE = 0x04,              ///<Создать, если файла нет
+        TRUNCATE = 0x08,            ///<Обрезать до нуля при открытии
+        APPEND = 0x10               ///<Каждая запись - в конец файла
+    };
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        NOT_MOUNTED,                ///<Файловая система не смонтирована
+        BAD_PATH,                   ///<Путь не абсолютный, содержит пустые имена или слишком длинный
+        NOT_FOUND,                  ///<Файл или каталог не найден
+        EXISTS,                     ///<Объект с таким путем уже есть
+        NOT_A_DIRECTORY,            ///<Родитель или объект - не каталог
+        IS_A_DIRECTORY,             ///<Объект - каталог, а нужен файл
+        NOT_EMPTY,                  ///<Каталог не пуст
+        BAD_HANDLE,                 ///<Неверный дескриптор или режим не допускает операцию
+        TOO_MANY_OPEN,              ///<Открыто MAX_OPEN_FILES файлов
+        BUSY,                       ///<Файл открыт
+        OUT_OF_RANGE,               ///<Позиция за концом файла
+        FILE_TOO_LARGE,             ///<Размер превысил бы 4 Гбайт
+        STORE_ERROR                 ///<Ошибка хранилища (подробности в KVStore::checkError())
+    };
+    //! Сведения об объекте
+    struct objectInfo{
+        bool directory;             ///<true - каталог
+        uint32_t size;              ///<Размер файла (байты)
+    };
+
+    private:
+    //! Открытый файл
+    struct handle{
+        bool used {false};                  ///<Дескриптор занят
+        std::string path;                   ///<Путь
+        uint32_t id {0};                    ///<Номер файла
+        uint32_t size {0};                  ///<Размер с учетом незаписанного блока
+        uint32_t position {0};              ///<Текущая позиция
+        uint8_t mode {0};                   ///<Режим открытия
+        std::vector<uint8_t> chunk;         ///<Буфер текущего блока
+        uint32_t chunkIndex {0};            ///<Номер блока в буфере
+        bool chunkLoaded {false};           ///<Буфер содержит блок chunkIndex
+        bool chunkDirty {false};            ///<Буфер изменен
+        bool metaDirty {false};             ///<Метаданные нужно записать
+    };
+    //! Хранилище
+    KVStore* _store;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Признак успешного монтирования
+    bool _mounted {false};
+    //! Следующий свободный номер файла
+    uint32_t _nextId {0};
+    //! Номера до этого значения зарезервированы в хранилище
+    uint32_t _reservedId {0};
+    //! Открытые файлы
+    handle _handles[MAX_OPEN_FILES];
+
+    //! Проверить путь: абсолютный, без пустых имен, не длиннее MAX_PATH_LENGTH
+    static bool validPath(const std::string& path);
+    //! Путь родительского каталога
+    static std::string parentOf(const std::string& path);
+    //! Ключ метаданных
+    static std::string metaKey(const std::string& path);
+    //! Ключ блока данных
+    static std::string chunkKey(uint32_t id, uint32_t index);
+    //! Ключ отметки о незавершенном удалении файла
+    static std::string removalKey(uint32_t id);
+    /*!
+        Прочитать метаданные (корень существует всегда)
+        \param[out] found Объект найден
+        \return false - ошибка хранилища
+    */
+    bool loadMeta(const std::string& path, bool& found, objectType& type, uint32_t& id, uint32_t& size);
+    //! Записать метаданные
+    bool storeMeta(const std::string& path, objectType type, uint32_t id, uint32_t size);
+    //! Проверить, что родитель существует и является каталогом
+    bool checkParent(const std::string& path);
+    //! Открытый файл с путем path (nullptr - не открыт)
+    handle* findOpen(const std::string& path);
+    //! Удалить данные файла по отметке о незавершенном удалении
+    bool finishRemoval(uint32_t id);
+    //! Выдать номер нового файла
+    bool allocateId(uint32_t& id);
+    //! Удалить блоки данных файла начиная с first
+    bool removeChunks(uint32_t id, uint32_t first);
+    //! Проверить дескриптор и режим
+    handle* getHandle(int32_t file, uint8_t mode);
+    //! Записать буфер блока, если он изменен
+    bool flushChunk(handle& h);
+    //! Загрузить блок index в буфер
+    bool loadChunk(handle& h, uint32_t index);
+    //! Ошибка хранилища
+    bool storeFailed();
+
+    public:
+    /*!
+        Конструктор
+        \param[in] store Указатель на хранилище (монтируется mount() или format())
+    */
+    NORFileSystem(KVStore* store);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    //! Смонтировать хранилище и файловую систему
+    bool mount();
+    //! Отформатировать хранилище и создать пустую файловую систему
+    bool format();
+    /*!
+        Создать каталог
+        \param[in] path Абсолютный путь
+    */
+    bool mkdir(const std::string& path);
+    /*!
+        Удалить файл или пустой каталог
+        \param[in] path Абсолютный путь
+    */
+    bool remove(const std::string& path);
+    /*!
+        Сведения об объекте
+        \param[in] path Абсолютный путь
+        \param[out] info Сведения
+    */
+    bool stat(const std::string& path, objectInfo& info);
+    /*!
+        Список имен в каталоге
+        \param[in] path Абсолютный путь каталога
+        \return Имена по возрастанию (пусто при ошибке)
+    */
+    std::vector<std::string> list(const std::string& path);
+    /*!
+        Открыть файл
+        \param[in] path Абсолютный путь
+        \param[in] mode Режимы openMode
+        \return Дескриптор (>= 0) или -1 при ошибке
+    */
+    int32_t open(const std::string& path, uint8_t mode);
+    /*!
+        Прочитать данные с текущей позиции
+        \param[in] file Дескриптор
+        \param[out] out Буфер
+        \param[in] length Длина
+        \return Количество прочитанных байт (меньше length в конце файла)
+    */
+    uint32_t read(int32_t file, uint8_t* out, uint32_t length);
+    /*!
+        Записать данные с текущей позиции (в режиме APPEND - в конец)
+        \param[in] file Дескриптор
+        \param[in] data Данные
+        \param[in] length Длина
+        \return Количество записанных байт
+    */
+    uint32_t write(int32_t file, const uint8_t* data, uint32_t length);
+    /*!
+        Установить позицию (не дальше конца файла)
+        \param[in] file Дескриптор
+        \param[in] position Позиция
+    */
+    bool seek(int32_t file, uint32_t position);
+    //! Текущая позиция
+    uint32_t tell(int32_t file);
+    //! Записать буфер и метаданные файла
+    bool sync(int32_t file);
+    /*!
+        Записать изменения и закрыть файл
+        \return false - ошибка записи, файл остается открытым
+    */
+    bool close(int32_t file);
+};
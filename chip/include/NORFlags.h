@@ -0,0 +1,68 @@
+/*!
+    \file NORFlags.h
+    \brief Набор однократно устанавливаемых флагов на NOR Flash W25Q128
+*/
+#pragma once
+#include "W25Q128.h"
+#include <cstdint>
+/*!
+    \class NORFlags
+    \brief Набор однократно устанавливаемых флагов на NOR Flash W25Q128
+
+    Каждый флаг - один бит области: стертый бит (1) означает "не установлен".
+    Установка сбрасывает бит в 0 записью одного байта без стирания, сброс
+    всех флагов стирает сектора области. Сектор - наименьшая единица
+    стирания микросхемы (geometry().minEraseSize()).
+*/
+class NORFlags{
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        INVALID_REGION,             ///<Область не выровнена по сектору, выходит за пределы памяти или микросхема не стирает секторами
+        INDEX_OUT_OF_RANGE,         ///<Номер флага вне области
+        CHIP_ERROR                  ///<Ошибка операции с микросхемой (подробности в NORW25Q128::checkError())
+    };
+
+    private:
+    //! Экземпляр микросхемы
+    NORW25Q128* _chip;
+    //! Адрес начала области
+    uint32_t _start;
+    //! Количество секторов в области
+    uint16_t _sectorCount;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+
+    //! Проверить область (при ошибке устанавливает INVALID_REGION)
+    bool checkRegion();
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на экземпляр микросхемы
+        \param[in] startAddress Адрес начала области (выровнен по сектору)
+        \param[in] sectorCount Количество секторов в области
+    */
+    NORFlags(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount);
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    //! Количество флагов в области (зависит от размера сектора микросхемы)
+    uint32_t capacity() const;
+    /*!
+        Установить флаг (один байт page program, без стирания; уже
+        установленный флаг не записывается повторно)
+        \param[in] index Номер флага
+    */
+    void set(uint32_t index);
+    /*!
+        Проверить флаг
+        \param[in] index Номер флага
+        \return true - флаг установлен
+    */
+    bool test(uint32_t index);
+    //! Сбросить все флаги (стирание секторов области)
+    void reset();
+};
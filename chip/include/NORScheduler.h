@@ -0,0 +1,131 @@
+/*!
+    \file NORScheduler.h
+    \brief Планировщик операций чтения, записи и стирания NOR Flash
+*/
+#pragma once
+#include "W25Q128.h"
+#include "Storage.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+/*!
+    \class NORScheduler
+    \brief Планировщик операций чтения, записи и стирания NOR Flash
+
+    Клиенты ставят запросы в очередь submit(), step() выполняет следующую
+    операцию. Порядок выбора:
+    - запрос, ожидающий дольше окна deadline, - в первую очередь (защита от голодания);
+    - иначе чтения, затем записи, затем стирания: стирание блокирует
+      микросхему на десятки миллисекунд и не должно задерживать чтение;
+    - внутри класса - по возрастанию адреса от последней позиции (лифт с
+      возвратом к началу).
+
+    Все готовые чтения выполняются одним readv(): соседние и близкие области
+    читаются общей транзакцией. Записи, продолжающие друг друга, объединяются
+    в одну program(), поэтому мелкие записи в одну страницу тратят один цикл;
+    ошибка объединенной записи возвращается всем ее запросам.
+
+    Порядок не меняется для пересекающихся запросов, если один из них -
+    запись или стирание: запрос ждет все более ранние конфликтующие.
+
+    Запрос - структура вызывающего, она должна существовать до выполнения
+    (done). Время берется из функции clock (нс), по умолчанию - steady_clock;
+    для программной модели можно передать модельное время микросхемы.
+*/
+class NORScheduler{
+    public:
+    //! Класс операции
+    enum class operationType : uint8_t{
+        READ,                       ///<Чтение (чувствительно к задержке)
+        PROGRAM,                    ///<Запись
+        ERASE                       ///<Стирание (фоновое)
+    };
+    //! Количество классов операций
+    static constexpr uint8_t CLASS_COUNT = 3;
+    //! Запрос
+    struct request{
+        operationType type;                         ///<Класс операции
+        uint32_t address;                           ///<Адрес начала
+        uint32_t length;                            ///<Длина (для стирания - кратна сектору)
+        const uint8_t* data {nullptr};              ///<Данные записи
+        uint8_t* out {nullptr};                     ///<Буфер чтения
+        bool done {false};                          ///<Запрос выполнен
+        storageError result {storageError::OK};     ///<Результат
+        uint64_t submitted {0};                     ///<Время постановки в очередь (нс)
+        uint64_t completed {0};                     ///<Время выполнения (нс)
+    };
+    //! Задержка одного класса
+    struct latency{
+        uint64_t count {0};         ///<Выполнено запросов
+        uint64_t totalNs {0};       ///<Суммарная задержка (нс)
+        uint64_t maxNs {0};         ///<Наибольшая задержка (нс)
+    };
+    //! Статистика
+    struct statistics{
+        latency classes[CLASS_COUNT];   ///<Задержка по классам (индекс - operationType)
+        uint64_t dispatches {0};        ///<Выполнено операций с микросхемой
+        uint64_t mergedReads {0};       ///<Чтений выполнено вместе с другими
+        uint64_t mergedPrograms {0};    ///<Записей присоединено к другим
+        uint64_t deadlineDispatches {0};///<Выбрано по истечении окна
+    };
+
+    private:
+    //! Запрос в очереди
+    struct entry{
+        request* r;                 ///<Запрос
+        uint64_t sequence;          ///<Порядковый номер постановки
+    };
+    //! Микросхема
+    NORW25Q128* _chip;
+    //! Источник времени (нс)
+    std::function<uint64_t()> _clock;
+    //! Окно, после которого запрос выполняется вне очереди (нс)
+    uint64_t _deadlineNs;
+    //! Очередь
+    std::vector<entry> _queue;
+    //! Следующий порядковый номер
+    uint64_t _nextSequence {0};
+    //! Позиция лифта
+    uint32_t _head {0};
+    //! Статистика
+    statistics _stats;
+
+    //! Есть ли более ранний конфликтующий запрос
+    bool blocked(size_t index) const;
+    //! Выбрать запрос для выполнения (индекс в очереди)
+    size_t pick() const;
+    //! Завершить запрос и учесть задержку
+    void complete(request* r, storageError result);
+    //! Выполнить все готовые чтения
+    void dispatchReads();
+    //! Выполнить запись, присоединив продолжающие ее
+    void dispatchProgram(size_t index);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] chip Указатель на микросхему
+        \param[in] deadlineNs Окно ожидания, после которого запрос выполняется вне очереди (нс)
+        \param[in] clock Источник времени в нс (пусто - steady_clock)
+    */
+    NORScheduler(NORW25Q128* chip, uint64_t deadlineNs = 100000000, std::function<uint64_t()> clock = {});
+    /*!
+        Поставить запрос в очередь
+        \param[in] r Запрос (существует до выполнения)
+        \return false - запрос неверен, результат в r->result, r->done = true
+    */
+    bool submit(request* r);
+    /*!
+        Выполнить следующую операцию
+        \return false - очередь пуста
+    */
+    bool step();
+    //! Выполнить все запросы
+    void run();
+    //! Количество запросов в очереди
+    size_t pending() const;
+    //! Статистика
+    const statistics& stats() const;
+    //! Сбросить статистику
+    void resetStats();
+};
@@ -0,0 +1,109 @@
+/*!
+    \file SharedSpiBus.h
+    \brief Общая шина SPI для нескольких микросхем с арбитражем между потоками
+*/
+#pragma once
+#include "Driver.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/*!
+    \class ISpiBus
+    \brief Интерфейс физической шины SPI с несколькими линиями выбора устройства
+*/
+class ISpiBus{
+    public:
+    virtual ~ISpiBus() = default;
+    /*!
+        Установить состояние линии выбора устройства
+        \param[in] line Номер линии CS
+        \param[in] active true - CS в низкий уровень, false - в высокий
+    */
+    virtual void setChipSelect(uint8_t line, bool active) = 0;
+    /*! \brief Передать и получить байт
+        \param[in] byte Байт для передачи
+        \return Принятый байт
+    */
+    virtual uint8_t transfer(uint8_t byte) = 0;
+};
+
+/*!
+    \class SharedSpiBus
+    \brief Арбитр общей шины SPI
+
+    Шина захватывается на одну транзакцию (от выбора устройства до снятия выбора),
+    поэтому транзакции разных потоков не перемешиваются. Между транзакциями шина
+    свободна: пока одна микросхема стирает сектор, другие могут читаться.
+*/
+class SharedSpiBus{
+    public:
+    //! Статистика шины
+    struct statistics{
+        uint64_t transactions {0};  ///<Количество транзакций
+        uint64_t contended {0};     ///<Транзакций, ожидавших освобождения шины
+    };
+
+    private:
+    //! Физическая шина
+    ISpiBus* _bus;
+    //! Захват шины на время транзакции
+    std::mutex _mutex;
+    //! Статистика (изменяется под захватом шины)
+    statistics _stats;
+
+    public:
+    /*!
+        Конструктор
+        \param[in] bus Указатель на физическую шину
+    */
+    SharedSpiBus(ISpiBus* bus);
+    /*!
+        Захватить шину и выбрать устройство
+        \param[in] line Номер линии CS
+    */
+    void acquire(uint8_t line);
+    /*!
+        Снять выбор устройства и освободить шину
+        \param[in] line Номер линии CS
+    */
+    void release(uint8_t line);
+    /*! \brief Передать и получить байт (только внутри acquire()..release())
+        \param[in] byte Байт для передачи
+        \return Принятый байт
+    */
+    uint8_t transfer(uint8_t byte);
+    //! Статистика шины (нельзя вызывать внутри транзакции)
+    statistics stats();
+};
+
+/*!
+    \class SpiDevice
+    \brief Драйвер одной микросхемы на общей шине
+
+    Подключается к оберткам вместо IDriver. select() ждет и захватывает шину,
+    deselect() освобождает ее. Пока микросхема занята записью или стиранием,
+    обертка вызывает idle(): поток уступает процессор или засыпает на интервал
+    опроса, не удерживая шину.
+*/
+class SpiDevice : public IDriver{
+    //! Общая шина
+    SharedSpiBus* _bus;
+    //! Линия выбора устройства
+    uint8_t _line;
+    //! Интервал опроса занятой микросхемы
+    std::chrono::microseconds _pollInterval;
+
+    public:
+    /*!
+        Конструктор
+        \param[in] bus Указатель на общую шину
+        \param[in] line Номер линии CS
+        \param[in] pollInterval Интервал опроса занятой микросхемы (0 - только уступить процессор)
+    */
+    SpiDevice(SharedSpiBus* bus, uint8_t line, std::chrono::microseconds pollInterval = std::chrono::microseconds{0});
+    void select() override;
+    void deselect() override;
+    uint8_t transfer(uint8_t byte) override;
+    void idle() override;
+};
@@ -0,0 +1,203 @@
+/*!
+    \file SocketSpi.h
+    \brief Шина SPI через локальный сокет: сервер с моделями микросхем и драйвер клиента
+*/
+#pragma once
+#include "Driver.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+/*!
+    Протокол (сокет домена Unix, поток байтов)
+
+    Сообщение клиента: заголовок socketSpiHeader и length байтов MOSI.
+    Сервер выполняет байты на устройстве line и, если replyLength != 0,
+    отвечает последними replyLength байтами MISO. Сообщение с неверным
+    номером устройства, ответом длиннее length или length больше
+    SOCKET_SPI_MAX_MESSAGE разрывает соединение. Сообщения без ответа
+    клиент не ждет, поэтому транзакция записи - одно сообщение без ответа,
+    транзакция чтения - одно сообщение с ответом.
+*/
+//! Наибольшее количество байтов MOSI в сообщении (длинные блоки клиент делит)
+constexpr uint32_t SOCKET_SPI_MAX_MESSAGE = 65536;
+//! Флаги сообщения
+enum socketSpiFlags : uint8_t{
+    SOCKET_SPI_SELECT = 1,          ///<Выбрать устройство перед байтами
+    SOCKET_SPI_DESELECT = 2         ///<Снять выбор после байтов
+};
+//! Заголовок сообщения
+struct socketSpiHeader{
+    uint8_t flags;                  ///<Флаги socketSpiFlags
+    uint8_t line;                   ///<Номер устройства
+    uint16_t reserved;              ///<Не используется (0)
+    uint32_t length;                ///<Количество байтов MOSI
+    uint32_t replyLength;           ///<Количество последних байтов MISO в ответе
+};
+
+/*!
+    \class SocketSpiServer
+    \brief Сервер шины: модели микросхем, доступные нескольким процессам
+
+    Каждый клиент обслуживается своим потоком; потоки отключившихся
+    клиентов присоединяются при следующем подключении. Шина захватывается сообщением
+    с выбором устройства и освобождается сообщением со снятием выбора,
+    поэтому транзакции клиентов не перемешиваются, а между транзакциями
+    шина свободна. Сервер работает только на Linux.
+*/
+class SocketSpiServer{
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        SOCKET_ERROR,               ///<Не удалось создать сокет
+        PATH_TOO_LONG               ///<Путь сокета длиннее sun_path
+    };
+    //! Статистика
+    struct statistics{
+        uint64_t clients {0};       ///<Подключено клиентов
+        uint64_t messages {0};      ///<Получено сообщений
+        uint64_t transactions {0};  ///<Выполнено транзакций
+        uint64_t contended {0};     ///<Транзакций, ожидавших освобождения шины
+        uint64_t bytes {0};         ///<Передано байтов по шине
+    };
+
+    private:
+    //! Модели микросхем по номерам линий
+    std::vector<IDriver*> _devices;
+    //! Путь сокета
+    std::string _path;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Слушающий сокет
+    int _listenFd {-1};
+    //! Дескриптор для остановки
+    int _stopFd {-1};
+    //! Поток приема подключений
+    std::thread _acceptor;
+    //! Подключенный клиент
+    struct client{
+        int fd;                     ///<Сокет (-1 - закрыт)
+        std::thread thread;         ///<Поток обслуживания
+        std::atomic<bool> done {false}; ///<Поток завершился, его можно присоединить
+    };
+    //! Клиенты (адреса элементов не меняются, завершившиеся удаляются потоком приема)
+    std::list<client> _clients;
+    //! Защита списка клиентов
+    std::mutex _clientsMutex;
+    //! Захват шины на время транзакции
+    std::mutex _bus;
+    //! Счетчики
+    std::atomic<uint64_t> _clientCount {0};
+    std::atomic<uint64_t> _messages {0};
+    std::atomic<uint64_t> _transactions {0};
+    std::atomic<uint64_t> _contended {0};
+    std::atomic<uint64_t> _bytes {0};
+
+    //! Цикл приема подключений
+    void acceptClients();
+    //! Присоединить потоки завершившихся клиентов и удалить их из списка
+    void reapClients();
+    //! Обслуживание одного клиента
+    void serve(client* owner);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] devices Модели микросхем по номерам линий
+    */
+    explicit SocketSpiServer(std::vector<IDriver*> devices);
+    //! Останавливает сервер
+    ~SocketSpiServer();
+    SocketSpiServer(const SocketSpiServer&) = delete;
+    SocketSpiServer& operator=(const SocketSpiServer&) = delete;
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Начать прием подключений
+        \param[in] path Путь сокета (существующий файл заменяется)
+        \return Результат операции
+    */
+    bool start(const std::string& path);
+    //! Отключить клиентов и остановить сервер
+    void stop();
+    //! Статистика
+    statistics stats() const;
+};
+
+/*!
+    \class SocketSpiDriver
+    \brief Драйвер устройства на шине сервера SocketSpiServer
+
+    Подключается к оберткам вместо IDriver. Байты, ответ которых не нужен
+    (transferBlock() с rx == nullptr), копятся в буфере; выбор устройства
+    отправляется вместе с ними. Сообщение уходит, когда нужен ответ
+    (transfer() или transferBlock() с rx), и при снятии выбора - без
+    ожидания ответа. После разрыва соединения transfer() возвращает 0xFF.
+*/
+class SocketSpiDriver : public IDriver{
+    public:
+    //! Список ошибок
+    enum class error{
+        OK,                         ///<Нет ошибки
+        CONNECT_FAILED,             ///<Не удалось подключиться к серверу
+        IO_ERROR                    ///<Ошибка передачи, соединение закрыто
+    };
+    //! Статистика
+    struct statistics{
+        uint64_t messages {0};      ///<Отправлено сообщений
+        uint64_t roundTrips {0};    ///<Сообщений с ожиданием ответа
+    };
+
+    private:
+    //! Сокет
+    int _fd {-1};
+    //! Номер устройства
+    uint8_t _line;
+    //! Текущая ошибка
+    error _errorCode {error::OK};
+    //! Выбор устройства еще не отправлен
+    bool _selectPending {false};
+    //! Сообщение: заголовок и байты MOSI
+    std::vector<uint8_t> _message;
+    //! Статистика
+    statistics _stats;
+
+    //! Отправить накопленное сообщение и получить replyLength байтов ответа
+    bool flush(uint8_t flags, uint8_t* reply, uint32_t replyLength);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] line Номер устройства на сервере
+    */
+    explicit SocketSpiDriver(uint8_t line = 0);
+    //! Закрывает соединение
+    ~SocketSpiDriver();
+    SocketSpiDriver(const SocketSpiDriver&) = delete;
+    SocketSpiDriver& operator=(const SocketSpiDriver&) = delete;
+    /*! Функция проверки состояния ошибки
+        \return Код ошибки error
+    */
+    error checkError();
+    /*!
+        Подключиться к серверу
+        \param[in] path Путь сокета
+        \return Результат операции
+    */
+    bool connect(const std::string& path);
+    //! Закрыть соединение
+    void disconnect();
+    void select() override;
+    void deselect() override;
+    uint8_t transfer(uint8_t byte) override;
+    void transferBlock(const uint8_t* tx, uint8_t* rx, uint32_t length) override;
+    void idle() override;
+    //! Статистика
+    const statistics& stats() const;
+};
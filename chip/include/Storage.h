@@ -0,0 +1,159 @@
+/*!
+    \file Storage.h
+    \brief Общий интерфейс памяти для EEPROM и NOR Flash
+*/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//! Максимальное количество размеров стирания
+constexpr uint8_t STORAGE_ERASE_TYPES = 4;
+
+/*!
+    \struct StorageGeometry
+    \brief Геометрия и возможности памяти
+*/
+struct StorageGeometry{
+    uint32_t capacity;                          ///<Объем памяти (байты)
+    uint16_t pageSize;                          ///<Размер страницы записи (байты)
+    uint32_t eraseSizes[STORAGE_ERASE_TYPES];   ///<Размеры стирания по возрастанию (0 - нет)
+    uint8_t eraseValue;                         ///<Значение байта после стирания
+    bool needsErase;                            ///<Запись возможна только в стертую область
+    bool bitClearOnly;                          ///<Запись может только сбрасывать биты (1 -> 0)
+
+    //! Минимальный размер стирания (0 - стирание не поддерживается)
+    constexpr uint32_t minEraseSize() const { return eraseSizes[0]; }
+};
+
+//! Общий список ошибок памяти
+enum class storageError{
+    OK,                         ///<Нет ошибки
+    ADDRESS_OUT_OF_RANGE,       ///<Адрес выходит за пределы памяти
+    BAD_ADDRESS_ALIGNMENT,      ///<Адрес или длина не выровнены по размеру стирания
+    NULL_POINTER,               ///<Передан нулевой указатель
+    WRITE_NOT_ENABLED,          ///<Попытка записи при отключенной возможности записи
+    NEEDS_ERASE,                ///<Данные невозможно записать без стирания
+    NOT_SUPPORTED,              ///<Операция не поддерживается памятью
+    DEVICE_ERROR                ///<Прочая ошибка устройства (подробности в checkError() устройства)
+};
+
+/*!
+    \class IStorage
+    \brief Общий интерфейс памяти: чтение, запись, стирание
+
+    В отличие от функций самих оберток, длины не ограничены страницей:
+    программа разбивается по границам страниц, чтение - на транзакции
+    допустимой длины. Возможности памяти описывает geometry(), для
+    специализации на этапе компиляции у каждой обертки есть
+    static constexpr GEOMETRY.
+*/
+class IStorage{
+    public:
+    virtual ~IStorage() = default;
+    //! Геометрия и возможности памяти
+    virtual const StorageGeometry& geometry() const = 0;
+    /*!
+        Прочитать данные
+        \param[in] address Адрес начала
+        \param[in] length Длина в байтах
+        \param[out] out Буфер для данных
+        \return Код ошибки
+    */
+    virtual storageError read(uint32_t address, uint32_t length, uint8_t* out) = 0;
+    /*!
+        Записать данные
+        \param[in] address Адрес начала
+        \param[in] length Длина в байтах
+        \param[in] data Данные
+        \return Код ошибки (NEEDS_ERASE, если память требует стирания)
+    */
+    virtual storageError program(uint32_t address, uint32_t length, const uint8_t* data) = 0;
+    /*!
+        Стереть область
+        \param[in] address Адрес начала (выровнен по minEraseSize())
+        \param[in] length Длина (кратна minEraseSize())
+        \return Код ошибки (NOT_SUPPORTED, если память не стирается)
+    */
+    virtual storageError erase(uint32_t address, uint32_t length) = 0;
+};
+
+/*!
+    Перезаписать произвольную область памяти
+
+    Для памяти без стирания - просто запись. Для памяти со стиранием каждый
+    затронутый блок минимального размера стирания читается; если новые данные
+    совместимы со старыми (биты только сбрасываются), пишется лишь измененный
+    диапазон, иначе блок стирается и записывается целиком.
+    Ветвь выбирается на этапе компиляции по Storage::GEOMETRY, размеры
+    блоков и страниц берутся из storage.geometry().
+
+    \param[in] storage Память (NORW25Q128, EEPROM25LCxxx или другая реализация IStorage с GEOMETRY)
+    \param[in] address Адрес начала
+    \param[in] length Длина в байтах
+    \param[in] data Данные
+    \return Код ошибки
+*/
+template<class Storage>
+storageError rewrite(Storage& storage, uint32_t address, uint32_t length, const uint8_t* data){
+    if constexpr (!Storage::GEOMETRY.needsErase) {
+        return storage.program(address, length, data);
+    } else {
+        if (length == 0) {
+            return storageError::OK;
+        }
+        if (data == nullptr) {
+            return storageError::NULL_POINTER;
+        }
+        const StorageGeometry& geometry = storage.geometry();
+        if (uint64_t(address) + length > geometry.capacity) {
+            return storageError::ADDRESS_OUT_OF_RANGE;
+        }
+        uint32_t unit = geometry.minEraseSize();
+        if (unit == 0) {
+            return storageError::NOT_SUPPORTED;
+        }
+        std::vector<uint8_t> block(unit);
+        while (length > 0) {
+            uint32_t base = address - address % unit;
+            uint32_t offset = address - base;
+            uint32_t chunk = std::min(unit - offset, length);
+            storageError result = storage.read(base, unit, block.data());
+            if (result != storageError::OK) {
+                return result;
+            }
+            uint32_t first{0};
+            while (first < chunk && block[offset + first] == data[first]) {
+                first++;
+            }
+            if (first < chunk) {
+                uint32_t last = chunk - 1;
+                while (block[offset + last] == data[last]) {
+                    last--;
+                }
+                bool compatible = std::equal(data + first, data + last + 1, block.begin() + offset + first,
+                    [](uint8_t wanted, uint8_t old){
+                        return Storage::GEOMETRY.bitClearOnly ? (old & wanted) == wanted : old == Storage::GEOMETRY.eraseValue;
+                    });
+                if (compatible) {
+                    result = storage.program(address + first, last - first + 1, data + first);
+                } else {
+                    std::copy(data, data + chunk, block.begin() + offset);
+                    result = storage.erase(base, unit);
+                    //! После стирания пишутся только страницы, отличные от стертого состояния
+                    for (uint32_t page{0}; page < unit && result == storageError::OK; page += geometry.pageSize) {
+                        auto begin = block.begin() + page;
+                        if (std::any_of(begin, begin + geometry.pageSize, [](uint8_t b){ return b != Storage::GEOMETRY.eraseValue; })) {
+                            result = storage.program(base + page, geometry.pageSize, block.data() + page);
+                        }
+                    }
+                }
+                if (result != storageError::OK) {
+                    return result;
+                }
+            }
+            address += chunk; data += chunk; length -= chunk;
+        }
+        return storageError::OK;
+    }
+}
@@ -0,0 +1,183 @@
+/*!
+    \file StorageStream.h
+    \brief Буферизованный std::streambuf и итераторы произвольного доступа поверх памяти
+*/
+#pragma once
+#include "Storage.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <streambuf>
+#include <unordered_map>
+#include <vector>
+/*!
+    \class StorageStreamBuf
+    \brief Буферизованный std::streambuf поверх IStorage
+
+    Позволяет работать с памятью через std::istream/std::ostream. Позиция в
+    потоке - адрес в памяти. Чтение выполняется блоками размера буфера, чтение
+    и запись длиной не меньше буфера идут напрямую одной операцией памяти.
+    Запись накапливается в том же буфере и выполняется program() при sync(),
+    смене направления, перемещении и в деструкторе; для NOR Flash
+    записываемая область должна быть стерта.
+
+    Ошибка памяти завершает операцию потока как конец файла (поток получает
+    failbit/eofbit), код ошибки доступен через checkError().
+*/
+class StorageStreamBuf : public std::streambuf{
+    //! Память
+    IStorage* _storage;
+    //! Буфер чтения или записи
+    std::vector<char> _buffer;
+    //! Адрес начала буфера (если буфер пуст - текущая позиция)
+    uint32_t _base {0};
+    //! Последняя ошибка памяти
+    storageError _errorCode {storageError::OK};
+
+    //! Текущая позиция с учетом буфера
+    uint32_t position() const;
+    //! Сбросить буфер чтения, сохранив позицию
+    void dropGetArea();
+    //! Записать накопленные данные
+    bool flushPutArea();
+
+    protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char_type* s, std::streamsize count) override;
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char_type* s, std::streamsize count) override;
+    int sync() override;
+    std::streamsize showmanyc() override;
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+
+    public:
+    /*!
+        Конструктор
+        \param[in] storage Указатель на память
+        \param[in] bufferSize Размер буфера (байты, не меньше 1)
+    */
+    StorageStreamBuf(IStorage* storage, size_t bufferSize = 256);
+    //! Записывает накопленные данные
+    ~StorageStreamBuf() override;
+    /*! Функция проверки состояния ошибки
+        \return Код последней ошибки памяти
+    */
+    storageError checkError() const;
+};
+
+/*!
+    \class StorageView
+    \brief Байтовое представление памяти с итераторами произвольного доступа
+
+    Итераторы позволяют применять к содержимому памяти алгоритмы
+    стандартной библиотеки (std::copy, std::search, std::find...). Байты
+    читаются блоками: промах читает целый блок одной операцией памяти,
+    остальные обращения выполняются из RAM.
+
+    Прочитанные блоки хранятся до invalidate() или уничтожения
+    представления, поэтому разыменование возвращает ссылку на байт в RAM,
+    которая остается действительной, пока живы итераторы. Объем кэша растет
+    с объемом прочитанных данных. При ошибке памяти разыменование возвращает
+    ссылку на стертое значение, блок не кэшируется, код ошибки доступен
+    через checkError().
+*/
+class StorageView{
+    //! Память
+    IStorage* _storage;
+    //! Размер блока
+    uint32_t _blockSize;
+    //! Прочитанные блоки по адресу начала
+    std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]>> _blocks;
+    //! Последний использованный блок
+    const uint8_t* _block {nullptr};
+    //! Адрес начала последнего блока
+    uint32_t _blockStart {0};
+    //! Количество действительных байт в последнем блоке
+    uint32_t _blockLength {0};
+    //! Стертое значение (результат чтения при ошибке)
+    uint8_t _erased;
+    //! Последняя ошибка памяти
+    storageError _errorCode {storageError::OK};
+    //! Количество прочитанных блоков
+    uint32_t _blockReads {0};
+
+    //! Найти или прочитать блок, содержащий address, и вернуть ссылку на байт
+    const uint8_t& load(uint32_t address);
+
+    public:
+    class iterator;
+    /*!
+        Конструктор
+        \param[in] storage Указатель на память
+        \param[in] blockSize Размер блока чтения (байты, не меньше 1)
+    */
+    StorageView(IStorage* storage, uint32_t blockSize = 256);
+    StorageView(const StorageView&) = delete;
+    StorageView& operator=(const StorageView&) = delete;
+    /*!
+        Байт по адресу
+        \param[in] address Адрес (меньше size())
+        \return Ссылка, действительная до invalidate()
+    */
+    const uint8_t& at(uint32_t address){
+        uint32_t offset = address - _blockStart;
+        return offset < _blockLength ? _block[offset] : load(address);
+    }
+    //! Объем памяти (байты)
+    uint32_t size() const;
+    //! Сбросить кэш (после записи в память в обход представления; ссылки становятся недействительными)
+    void invalidate();
+    //! Итератор на адрес 0
+    iterator begin();
+    //! Итератор за последним байтом памяти
+    iterator end();
+    /*! Функция проверки состояния ошибки
+        \return Код последней ошибки памяти
+    */
+    storageError checkError() const;
+    //! Количество прочитанных блоков
+    uint32_t blockReads() const;
+};
+
+/*!
+    \class StorageView::iterator
+    \brief Итератор произвольного доступа по байтам памяти (только чтение)
+*/
+class StorageView::iterator{
+    StorageView* _view {nullptr};
+    uint32_t _address {0};
+
+    public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = uint8_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const uint8_t*;
+    using reference = const uint8_t&;
+
+    iterator() = default;
+    iterator(StorageView* view, uint32_t address) : _view(view), _address(address) {}
+    //! Адрес в памяти
+    uint32_t address() const { return _address; }
+
+    reference operator*() const { return _view->at(_address); }
+    pointer operator->() const { return &_view->at(_address); }
+    reference operator[](difference_type n) const { return _view->at(static_cast<uint32_t>(_address + n)); }
+    iterator& operator++() { _address++; return *this; }
+    iterator operator++(int) { iterator old = *this; _address++; return old; }
+    iterator& operator--() { _address--; return *this; }
+    iterator operator--(int) { iterator old = *this; _address--; return old; }
+    iterator& operator+=(difference_type n) { _address = static_cast<uint32_t>(_address + n); return *this; }
+    iterator& operator-=(difference_type n) { _address = static_cast<uint32_t>(_address - n); return *this; }
+    iterator operator+(difference_type n) const { return iterator(_view, static_cast<uint32_t>(_address + n)); }
+    iterator operator-(difference_type n) const { return iterator(_view, static_cast<uint32_t>(_address - n)); }
+    friend iterator operator+(difference_type n, const iterator& it) { return it + n; }
+    difference_type operator-(const iterator& other) const { return difference_type(_address) - difference_type(other._address); }
+    bool operator==(const iterator& other) const { return _address == other._address; }
+    bool operator!=(const iterator& other) const { return _address != other._address; }
+    bool operator<(const iterator& other) const { return _address < other._address; }
+    bool operator>(const iterator& other) const { return _address > other._address; }
+    bool operator<=(const iterator& other) const { return _address <= other._address; }
+    bool operator>=(const iterator& other) const { return _address >= other._address; }
+};
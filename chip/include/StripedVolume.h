@@ -0,0 +1,65 @@
+/*!
+    \file StripedVolume.h
+    \brief Том с чередованием страниц по нескольким микросхемам NOR Flash
+*/
+#pragma once
+#include "W25Q128.h"
+#include "Storage.h"
+#include <cstdint>
+#include <vector>
+/*!
+    \class StripedVolume
+    \brief Том с чередованием страниц по нескольким микросхемам NOR Flash
+
+    Логическая страница L хранится в микросхеме L % N на физической странице L / N.
+    Запись страниц запускается на всех микросхемах по очереди без ожидания
+    (beginPageProgram()), ожидание нужно, только когда очередь снова доходит до
+    занятой микросхемы. Стирание запускается сразу на всех микросхемах. Поэтому
+    скорость записи и стирания растет с числом микросхем, если они на разных
+    шинах или на общей шине SharedSpiBus.
+
+    Микросхемы должны быть одного типа (одинаковые страница и типы стирания),
+    объем тома - наименьший объем микросхемы, умноженный на N.
+*/
+class StripedVolume : public IStorage{
+    //! Микросхемы тома
+    std::vector<NORW25Q128*> _chips;
+    //! Геометрия тома
+    StorageGeometry _geometry;
+
+    //! Дождаться окончания операций на всех микросхемах
+    void waitAll();
+
+    public:
+    //! Возможности тома (как у NOR Flash), размеры - в geometry()
+    static constexpr StorageGeometry GEOMETRY = NORW25Q128::GEOMETRY;
+    /*!
+        Конструктор
+        \param[in] chips Микросхемы тома (не пустой список, без нулевых указателей)
+    */
+    explicit StripedVolume(std::vector<NORW25Q128*> chips);
+    //! Количество микросхем
+    uint8_t chipCount() const;
+
+    //! Геометрия тома: страница микросхемы, размеры стирания умножены на число микросхем
+    const StorageGeometry& geometry() const override;
+    /*!
+        Прочитать данные
+
+        Каждая логическая страница читается из своей микросхемы
+    */
+    storageError read(uint32_t address, uint32_t length, uint8_t* out) override;
+    /*!
+        Записать данные
+
+        Возвращает управление после окончания записи на всех микросхемах
+    */
+    storageError program(uint32_t address, uint32_t length, const uint8_t* data) override;
+    /*!
+        Стереть область
+
+        Адрес и длина выровнены по geometry().minEraseSize(). Каждый шаг -
+        одновременное стирание одинаковых областей на всех микросхемах
+    */
+    storageError erase(uint32_t address, uint32_t length) override;
+};
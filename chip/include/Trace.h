@@ -0,0 +1,124 @@
+/*!
+    \file Trace.h
+    \brief Журнал интервалов выполнения операций в памяти с выгрузкой в формате Chrome trace
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+/*!
+    \class TraceRing
+    \brief Кольцевой журнал событий начала и конца интервалов
+
+    Событие - имя, категория, время, номер потока и до двух числовых
+    аргументов. Запись - одна атомарная операция и чтение часов, без
+    блокировок и выделения памяти; имена и категории не копируются и должны
+    быть строковыми литералами. При заполнении кольца старые события
+    перезаписываются.
+
+    Выгрузка exportChromeTrace() дает JSON, который открывается в
+    chrome://tracing или Perfetto. Выгружать нужно, когда трассируемые
+    потоки закончили работу: запись, идущая одновременно с выгрузкой,
+    может попасть в нее частично.
+*/
+class TraceRing{
+    public:
+    //! Событие
+    struct event{
+        const char* category;       ///<Категория (класс)
+        const char* name;           ///<Имя интервала (метод)
+        uint64_t timestampNs;       ///<Время от создания журнала (нс)
+        uint32_t thread;            ///<Номер потока
+        char phase;                 ///<'B' - начало, 'E' - конец
+        const char* argNames[2];    ///<Имена аргументов (nullptr - аргумента нет)
+        uint64_t args[2];           ///<Значения аргументов
+    };
+
+    private:
+    //! События
+    std::unique_ptr<event[]> _events;
+    //! Емкость кольца
+    size_t _capacity;
+    //! Номер следующего события
+    std::atomic<uint64_t> _next {0};
+    //! Начало отсчета времени
+    std::chrono::steady_clock::time_point _origin;
+
+    //! Записать событие
+    void record(char phase, const char* category, const char* name,
+                const char* argName0, uint64_t arg0, const char* argName1, uint64_t arg1);
+
+    public:
+    /*!
+        Конструктор
+        \param[in] capacity Емкость кольца (событий)
+    */
+    explicit TraceRing(size_t capacity = 65536);
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+    //! Начало интервала
+    void begin(const char* category, const char* name, const char* argName0 = nullptr, uint64_t arg0 = 0,
+               const char* argName1 = nullptr, uint64_t arg1 = 0);
+    //! Конец интервала
+    void end(const char* category, const char* name);
+    //! Удалить все события
+    void clear();
+    //! Количество событий в кольце
+    size_t size() const;
+    //! Количество перезаписанных событий
+    uint64_t dropped() const;
+    //! События в порядке записи
+    std::vector<event> snapshot() const;
+    /*!
+        Выгрузить события в формате Chrome trace event (JSON)
+
+        Концы интервалов, начало которых перезаписано, пропускаются
+        \param[out] out Поток вывода
+        \return Результат записи в поток
+    */
+    bool exportChromeTrace(std::ostream& out) const;
+    //! Номер текущего потока (последовательный, начиная с 1)
+    static uint32_t threadId();
+};
+
+/*!
+    \class TraceSpan
+    \brief Интервал от создания до разрушения объекта
+
+    Без журнала (nullptr) стоит одну проверку указателя.
+*/
+class TraceSpan{
+    TraceRing* _ring;
+    const char* _category;
+    const char* _name;
+
+    public:
+    /*!
+        Конструктор, записывает начало интервала
+        \param[in] ring Журнал (nullptr - трассировка выключена)
+        \param[in] category Категория (строковый литерал)
+        \param[in] name Имя интервала (строковый литерал)
+        \param[in] argName0 Имя первого аргумента (nullptr - аргумента нет)
+        \param[in] arg0 Значение первого аргумента
+        \param[in] argName1 Имя второго аргумента (nullptr - аргумента нет)
+        \param[in] arg1 Значение второго аргумента
+    */
+    TraceSpan(TraceRing* ring, const char* category, const char* name, const char* argName0 = nullptr, uint64_t arg0 = 0,
+              const char* argName1 = nullptr, uint64_t arg1 = 0) : _ring(ring), _category(category), _name(name) {
+        if (_ring != nullptr) {
+            _ring->begin(category, name, argName0, arg0, argName1, arg1);
+        }
+    }
+    //! Записывает конец интервала
+    ~TraceSpan(){
+        if (_ring != nullptr) {
+            _ring->end(_category, _name);
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
@@ -4,12 +4,20 @@
 */
 #pragma once
 #include "Driver.h"
+#include "Storage.h"
+#include <cstddef>
 #include <cstdint>
+
+class TraceRing;
 /*!
     \class NORW25Q128
     \brief Обертка для работы с NOR Flash памятью W25Q128 через SPI драйвер
+
+    По умолчанию используются параметры W25Q128. detect() читает JEDEC ID и
+    таблицу SFDP и настраивает объем, размер страницы, типы стирания и их
+    времена, поэтому обертка работает и с другими микросхемами SPI NOR.
 */
-class NORW25Q128{
+class NORW25Q128 : public IStorage{
     //! Набор инструкций для работы с EEPROM
     enum instruction : uint8_t{
         READ = 0x03,                ///<Read data from memory array beginning at selected address
@@ -21,7 +29,16 @@ class NORW25Q128{
         CHIP_ERASE = 0xC7,          ///<Sets all memory within the device to the erased state of all 1s (FFh).
         WRITE_ENABLE = 0x06,        ///<Sets the Write Enable Latch (WEL) bit in the Status Register to 1
         WRITE_DISABLE = 0x04,       ///<Sets the Write Enable Latch (WEL) bit in the Status Register to 0
-        READ_STATUS_REG1 = 0x05     ///<Allow the 8-bit Status Registers to be read.
+        READ_STATUS_REG1 = 0x05,    ///<Allow the 8-bit Status Registers to be read.
+        READ_JEDEC_ID = 0x9F,       ///<Manufacturer ID, memory type and capacity
+        READ_SFDP = 0x5A,           ///<Read Serial Flash Discoverable Parameters
+        READ_4B = 0x13,             ///<Read data with 4-byte address
+        FAST_READ_4B = 0x0C,        ///<Fast read data with 4-byte address
+        PAGE_PROGRAM_4B = 0x12,     ///<Page program with 4-byte address
+        SECTOR_ERASE_4B = 0x21,     ///<Sector erase (4K-bytes) with 4-byte address
+        BLOCK_ERASE_32K_4B = 0x5C,  ///<Block erase (32K-bytes) with 4-byte address
+        BLOCK_ERASE_64K_4B = 0xDC,  ///<Block erase (64K-bytes) with 4-byte address
+        ENTER_4B_MODE = 0xB7        ///<Enter 4-byte address mode
     };
     //! Биты регистра состояния
     enum class status:uint8_t{
@@ -34,15 +51,56 @@ class NORW25Q128{
         SEC = 0x40,                 ///<Sector/Block erase bit
         SRP0 = 0x80,                ///<Status register protect bit 0
     };
-    //! Размер сектора (байты)
+    public:
+    //! Размер страницы W25Q128 (байты; после detect() - geometry().pageSize)
+    static constexpr uint32_t PAGE_SIZE = 256u;
+    //! Размер сектора W25Q128 (байты; после detect() - geometry().minEraseSize())
     static constexpr uint32_t SECTOR_SIZE = 4u * 1024u;
     //! Размер блока 32 (байты)
     static constexpr uint32_t BLOCK_32K_SIZE = 32u * 1024u;
     //! Размер блока 64 (байты)
     static constexpr uint32_t BLOCK_64K_SIZE = 64u * 1024u;
-    //! Максимальный адрес памяти
+    //! Максимальный адрес W25Q128 (3 байта адреса; объем после detect() - в info())
     static constexpr uint32_t MAX_ADDR = 0xFFFFFF;
-    public:
+    //! Наибольший поддерживаемый объем (байты)
+    static constexpr uint32_t MAX_CAPACITY = 1u << 31;
+    //! Геометрия W25Q128 (возможности NOR; размеры после detect() - в geometry())
+    static constexpr StorageGeometry GEOMETRY {MAX_ADDR + 1, PAGE_SIZE, {SECTOR_SIZE, BLOCK_32K_SIZE, BLOCK_64K_SIZE}, 0xFF, true, true};
+    //! Тип стирания
+    struct eraseType{
+        uint32_t size;              ///<Размер (байты), 0 - тип отсутствует
+        uint8_t opcode;             ///<Инструкция стирания
+        uint32_t typicalUs;         ///<Типовое время стирания (мкс)
+    };
+    //! Способ адресации
+    enum class addressing : uint8_t{
+        THREE_BYTE,                 ///<Адрес 3 байта (до 16 Мбайт)
+        FOUR_BYTE_OPCODES,          ///<Отдельные инструкции с адресом 4 байта (0x13, 0x0C, 0x12, 0x21, 0x5C, 0xDC)
+        FOUR_BYTE_MODE,             ///<Режим адреса 4 байта (0xB7) для стандартных инструкций
+        FOUR_BYTE_ONLY              ///<Микросхема всегда принимает адрес 4 байта
+    };
+    //! Параметры микросхемы
+    struct deviceInfo{
+        uint8_t manufacturer;       ///<Производитель (JEDEC ID)
+        uint8_t memoryType;         ///<Тип памяти (JEDEC ID)
+        uint8_t capacityId;         ///<Код объема (JEDEC ID)
+        bool sfdp;                  ///<Параметры прочитаны из SFDP
+        uint32_t capacity;          ///<Объем (байты)
+        uint32_t pageSize;          ///<Размер страницы (байты)
+        eraseType erase[STORAGE_ERASE_TYPES]; ///<Типы стирания по возрастанию размера
+        uint32_t pageProgramUs;     ///<Типовое время записи страницы (мкс)
+        uint32_t chipEraseUs;       ///<Типовое время стирания чипа (мкс)
+        uint8_t readOpcode;         ///<Инструкция чтения массива
+        uint8_t readDummy;          ///<Холостых байт после адреса при чтении массива
+        uint8_t byteReadOpcode;     ///<Инструкция чтения без холостых байт (READ)
+        uint8_t programOpcode;      ///<Инструкция записи страницы
+        addressing addressMode;     ///<Способ адресации
+        uint8_t addressBytes;       ///<Количество байт адреса
+    };
+    //! Параметры W25Q128 (используются до detect() и при отсутствии SFDP)
+    static constexpr deviceInfo DEFAULT_INFO {0xEF, 0x40, 0x18, false, MAX_ADDR + 1, PAGE_SIZE,
+        {{SECTOR_SIZE, SECTOR_ERASE, 45000}, {BLOCK_32K_SIZE, BLOCK_ERASE_32K, 120000}, {BLOCK_64K_SIZE, BLOCK_ERASE_64K, 150000}, {0, 0, 0}},
+        700, 40000000, FAST_READ, 1, READ, PAGE_PROGRAM, addressing::THREE_BYTE, 3};
     //! Список ошибок
      enum class error{
         OK,                         ///<Нет ошибки
@@ -52,19 +110,38 @@ class NORW25Q128{
         WRITE_NOT_ENABLED,          ///<Попытка записи при отключенной возможности записи
         NULL_POINTER,               ///<Передан нулевой указатель
         OUT_OF_PAGE,                ///<Данные не помещаются в страницу
-        NEEDS_ERASE                 ///<Данные незвоможно записать (нужна очистка)
+        NEEDS_ERASE,                ///<Данные незвоможно записать (нужна очистка)
+        UNSUPPORTED_ERASE,          ///<Микросхема не поддерживает стирание такого размера
+        NO_SFDP,                    ///<Таблица SFDP не найдена, используются параметры по умолчанию
+        VERIFY_FAILED               ///<Прочитанные после записи данные не совпали с записанными
+    };
+    //! Фрагмент чтения с разнесением (readv())
+    struct readSegment{
+        uint32_t address;           ///<Адрес начала
+        uint32_t length;            ///<Длина (байты)
+        uint8_t* out;               ///<Буфер получателя
     };
     private:
     //! Экземпляр драйвера
     IDriver* _driver;
     //! Текущая ошибка
     error _errorCode {error::OK};
+    //! Параметры микросхемы
+    deviceInfo _info {DEFAULT_INFO};
+    //! Геометрия, соответствующая _info
+    StorageGeometry _geometry {GEOMETRY};
+    //! Запущена запись или стирание, завершение еще не проверено
+    bool _pending {false};
+    //! Проверять записанные данные чтением
+    bool _verifyWrites {false};
+    //! Журнал трассировки (nullptr - выключена)
+    TraceRing* _tracer {nullptr};
     //! Ожидание окончания записи
     void wait();
     ///! Установка разрешения на запись
     bool writeEnable();
     /*!
-        Отправка 24-битного адреса
+        Отправка адреса (3 или 4 байта, см. info().addressBytes)
         \param[in] address Адрес для отправки
     */
     void sendAddress(uint32_t address);
@@ -76,6 +153,45 @@ class NORW25Q128{
         \return true - можно записать, false - нужна очистка
     */
     bool isProgramCompatible(uint32_t address, const uint8_t* data, uint16_t length);
+    /*!
+        Прочитать область одной транзакцией FAST READ, передавая данные частями
+        \param[in] address Адрес начала (область проверена вызывающим)
+        \param[in] length Длина области
+        \param[in] consume Обработчик bool(const uint8_t* chunk, uint32_t length, uint32_t offset),
+        false - прекратить чтение
+    */
+    template<class Consumer>
+    void streamRead(uint32_t address, uint32_t length, Consumer consume);
+    /*!
+        Проверить записанную область по CRC32
+        \param[in] address Адрес начала
+        \param[in] length Длина области
+        \param[in] expected CRC32 записанных данных
+        \return true - CRC прочитанных данных совпадает
+    */
+    bool verifyRange(uint32_t address, uint32_t length, uint32_t expected);
+    /*!
+        Прочитать данные SFDP
+        \param[in] address Адрес в пространстве SFDP
+        \param[in] length Длина
+        \param[out] out Буфер
+    */
+    void readSFDP(uint32_t address, uint16_t length, uint8_t* out);
+    /*!
+        Разобрать основную таблицу параметров (JESD216)
+        \param[in] dwords Двойные слова таблицы
+        \param[in] count Количество двойных слов
+        \param[out] info Параметры
+        \return true - таблица корректна
+    */
+    static bool parseBasicTable(const uint32_t* dwords, uint8_t count, deviceInfo& info);
+    /*!
+        Выбрать способ адресации и инструкции для объема больше 16 Мбайт
+        \param[in,out] info Параметры
+        \param[in] addressField Поле адресации из слова 1 SFDP (0 - 3 байта, 1 - 3 или 4, 2 - только 4)
+        \param[in] enterMethods Способы перехода в адрес 4 байта из слова 16 SFDP (0 - неизвестно)
+    */
+    static void selectAddressing(deviceInfo& info, uint8_t addressField, uint8_t enterMethods);
     public:
     /*!
         Конструктор
@@ -95,6 +211,69 @@ class NORW25Q128{
         \return Байт данных регистра
     */
     uint8_t readStatusReg1();
+    /*!
+        Определить параметры микросхемы
+
+        Читает JEDEC ID (0x9F) и основную таблицу SFDP (0x5A). Если SFDP нет,
+        объем берется из JEDEC ID, остальные параметры - как у W25Q128,
+        и устанавливается error::NO_SFDP. Единственный доступный драйверу
+        режим чтения - однопроводный, поэтому чтение массива всегда FAST READ.
+
+        Для объема больше 16 Мбайт используется адрес 4 байта: отдельные
+        инструкции, если микросхема их поддерживает, иначе режим 0xB7.
+        Режим сбрасывается при отключении питания, после сброса микросхемы
+        detect() нужно вызвать снова.
+    */
+    void detect();
+    //! Текущие параметры микросхемы
+    const deviceInfo& info() const;
+    //! Преобразовать код ошибки в общий код памяти
+    static storageError toStorageError(error code);
+    /*!
+        Включить проверку записи
+
+        pageProgram() и program() после записи читают записанную область одной
+        транзакцией и сравнивают ее CRC32 с CRC32 данных, при несовпадении -
+        error::VERIFY_FAILED. program() проверяет весь диапазон одним чтением
+        после записи всех страниц. beginPageProgram() не проверяет запись:
+        окончание записи видно позже, для проверки - checksum()
+        \param[in] enable true - проверять
+    */
+    void setVerifyWrites(bool enable);
+    //! Включена ли проверка записи
+    bool verifyWrites() const;
+    /*!
+        Включить трассировку
+
+        Методы, обращающиеся к микросхеме, и ожидание окончания записи или
+        стирания записывают интервалы с адресом и длиной в журнал
+        \param[in] tracer Журнал (nullptr - выключить)
+    */
+    void setTracer(TraceRing* tracer);
+    /*!
+        Рассчитать CRC32 области
+
+        Область читается одной транзакцией FAST READ без ограничения длины,
+        поэтому проверка целостности больших областей идет со скоростью шины
+        \param[in] address Адрес начала
+        \param[in] length Длина области
+        \return CRC32 содержимого (0 при ошибке)
+    */
+    uint32_t checksum(uint32_t address, uint32_t length);
+    /*!
+        Проверить, выполняется ли запущенная операция
+
+        Опрашивает регистр состояния, только если операция была запущена
+        beginPageProgram() или beginErase() и ее завершение еще не видно
+        \return true - микросхема занята
+    */
+    bool busy();
+    /*!
+        Дождаться окончания запущенной операции
+
+        Все остальные функции вызывают ее сами перед обращением к микросхеме
+    */
+    void waitReady();
     /*!
         Прочитать байт
         
@@ -122,15 +301,55 @@ class NORW25Q128{
     */
     void readArray(uint32_t address, uint16_t length, uint8_t* out);
     /*!
-        Записать страницу (до 256 байт)
+        Прочитать несколько областей в отдельные буферы (scatter/gather)
+
+        Фрагменты упорядочиваются по адресу (массив вызывающего не меняется),
+        соседние и близкие объединяются в одну транзакцию FAST READ: промежуток
+        не длиннее maxGap байт читается и отбрасывается, если это дешевле новой
+        команды. Данные передаются прямо в буферы фрагментов, перекрывающиеся
+        фрагменты получают общие байты копированием из уже прочитанного.
+        \param[in] segments Фрагменты (нулевая длина допускается)
+        \param[in] count Количество фрагментов
+        \param[in] maxGap Наибольший промежуток внутри транзакции (байты)
+        \return Количество выполненных транзакций
+    */
+    uint32_t readv(const readSegment* segments, size_t count, uint32_t maxGap);
+    /*!
+        Прочитать несколько областей в отдельные буферы
+
+        Промежуток внутри транзакции - не длиннее команды чтения с адресом и
+        холостыми байтами (см. readGapThreshold())
+    */
+    uint32_t readv(const readSegment* segments, size_t count);
+    //! Длина промежутка, который дешевле прочитать, чем начать новую транзакцию (байты)
+    uint32_t readGapThreshold() const;
+    /*!
+        Записать страницу (до 256 байт, после detect() - до info().pageSize)
         \param[in] address Адрес начала записи
         \param[in] data Указатель на данные для записи
-        \param[in] length Длина данных в байтах (макс. 256)
+        \param[in] length Длина данных в байтах (макс. размер страницы)
     */
     void pageProgram(uint32_t address, const uint8_t* data, uint16_t length);
+    /*!
+        Запустить запись страницы без ожидания окончания
+
+        Проверки те же, что у pageProgram(). Пока идет запись, можно работать
+        с другими микросхемами; окончание - busy() или waitReady()
+        \param[in] address Адрес начала записи
+        \param[in] data Указатель на данные для записи
+        \param[in] length Длина данных в байтах (макс. размер страницы)
+    */
+    void beginPageProgram(uint32_t address, const uint8_t* data, uint16_t length);
+    /*!
+        Запустить стирание без ожидания окончания
+        \param[in] address Адрес начала (выровнен по size)
+        \param[in] size Размер стирания (один из info().erase)
+    */
+    void beginErase(uint32_t address, uint32_t size);
 
     /*!
-        Стереть сектор (4Кбайт)
+        Стереть сектор - наименьшую единицу стирания (4Кбайт у W25Q128,
+        после detect() - geometry().minEraseSize())
         \param[in] address Адрес начала сектора
     */
     void eraseSector(uint32_t address);
@@ -148,4 +367,27 @@ class NORW25Q128{
         Очистить чип
     */
     void eraseChip();
+
+    //! Геометрия памяти (IStorage)
+    const StorageGeometry& geometry() const override;
+    /*!
+        Прочитать данные произвольной длины (IStorage)
+
+        Использует быстрое чтение (FAST READ) транзакциями до 65535 байт
+    */
+    storageError read(uint32_t address, uint32_t length, uint8_t* out) override;
+    /*!
+        Записать данные произвольной длины (IStorage)
+
+        Разбивает данные по границам страниц. При включенной проверке весь
+        диапазон после записи читается одной транзакцией (см. setVerifyWrites())
+    */
+    storageError program(uint32_t address, uint32_t length, const uint8_t* data) override;
+    /*!
+        Стереть область (IStorage)
+
+        На каждом шаге используется наибольший из типов стирания микросхемы,
+        выровненный по адресу и помещающийся в оставшуюся длину
+    */
+    storageError erase(uint32_t address, uint32_t length) override;
 };
\ No newline at end of file
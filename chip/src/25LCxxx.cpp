@@ -0,0 +1,322 @@
+#include "25LCxxx.h"
+#include "CRC32.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+//! Категория интервалов трассировки
+constexpr const char* TRACE_CATEGORY = "EEPROM25LCxxx";
+}
+
+template<class Traits>
+EEPROM25LCxxx<Traits>::EEPROM25LCxxx(IDriver* driver){
+    assert(driver != nullptr);
+    _driver = driver;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::wait(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "wait"};
+    while (readStatus() & uint8_t(status::WIP)) {
+        _driver->idle();
+    }
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::sendCommand(instruction instr, address_type address){
+    if constexpr (Traits::ADDRESS_BITS == 9) {
+        uint8_t cmd = instr;
+        //! Если старший бит - 1 вставляем в инструкцию
+        if((address >> 8) & 0x01){
+            cmd |= 0x08;
+        }
+        _driver->transfer(cmd);
+    } else {
+        _driver->transfer(instr);
+    }
+    if constexpr (Traits::ADDRESS_BITS == 24) {
+        _driver->transfer(static_cast<uint8_t>((address >> 16) & 0xFF));
+    }
+    if constexpr (Traits::ADDRESS_BITS >= 16) {
+        _driver->transfer(static_cast<uint8_t>((address >> 8) & 0xFF));
+    }
+    _driver->transfer(static_cast<uint8_t>(address & 0xFF));
+}
+template<class Traits>
+uint8_t EEPROM25LCxxx<Traits>::readStatus(){
+    _driver->select();
+    _driver->transfer(instruction::RDSR);
+    uint8_t status = _driver->transfer(0xFF);
+    _driver->deselect();
+    return status;
+}
+template<class Traits>
+uint8_t EEPROM25LCxxx<Traits>::readByte(address_type address){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readByte", "address", address};
+    if(address > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return 0;
+    }
+    _driver->select();
+    sendCommand(READ,address);
+    uint8_t data = _driver->transfer(0xFF);
+    _driver->deselect();
+    _errorCode = error::OK;
+    return data;
+}
+template<class Traits>
+bool EEPROM25LCxxx<Traits>::programPage(address_type address, const uint8_t* data, uint16_t length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "programPage", "address", address, "length", length};
+    _driver->select();
+    _driver->transfer(instruction::WREN);
+    _driver->deselect();
+    uint8_t state = readStatus();
+    if ((state & static_cast<uint8_t>(status::WEL)) == 0){
+        return false;
+    }
+    _driver->select();
+    sendCommand(WRITE,address);
+    for (uint16_t i{0}; i < length; i++) {
+        _driver->transfer(data[i]);
+    }
+    _driver->deselect();
+    wait();
+    return true;
+}
+template<class Traits>
+uint32_t EEPROM25LCxxx<Traits>::readCRC(address_type address, address_type length){
+    uint8_t chunk[64];
+    uint32_t crc{0};
+    _driver->select();
+    sendCommand(READ,address);
+    for (address_type offset{0}; offset < length;) {
+        uint16_t size = static_cast<uint16_t>(std::min<address_type>(sizeof(chunk), length - offset));
+        for (uint16_t i{0}; i < size; i++) {
+            chunk[i] = _driver->transfer(0xFF);
+        }
+        crc = crc32(crc, chunk, size);
+        offset += size;
+    }
+    _driver->deselect();
+    return crc;
+}
+template<class Traits>
+bool EEPROM25LCxxx<Traits>::verifyRange(address_type address, address_type length, uint32_t expected){
+    if (_verifyWrites && readCRC(address, length) != expected) {
+        _errorCode = error::VERIFY_FAILED;
+        return false;
+    }
+    return true;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::writeByte(address_type address, uint8_t byte){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "writeByte", "address", address, "byte", byte};
+    if(address > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return;
+    }
+    if(readByte(address) == byte){
+        _skippedWrites++;
+        _errorCode = error::OK;
+        return;
+    }
+    if(!programPage(address, &byte, 1)){
+        _errorCode = error::WRITE_NOT_ENABLED;
+        return;
+    }
+    if(!verifyRange(address, 1, crc32(0, &byte, 1))){
+        return;
+    }
+    _errorCode = error::OK;
+}
+
+template<class Traits>
+bool EEPROM25LCxxx<Traits>::readBit(address_type address, uint8_t index){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readBit", "address", address, "index", index};
+    if(address > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return 0;
+    }
+    if(index > 7) {
+        _errorCode = error::INDEX_BIT_OUT_OF_RANGE; 
+        return 0;
+    }
+    return readByte(address) >> index & 0x01;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::writeBit(address_type address, uint8_t index, bool value){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "writeBit", "address", address, "index", index};
+    if(address > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return;
+    }
+    if(index > 7) {
+        _errorCode = error::INDEX_BIT_OUT_OF_RANGE; 
+        return;
+    }
+    uint8_t old = readByte(address);
+    uint8_t byte = old;
+    if(value){
+        byte |= (1 << index);
+    } else {
+        byte &= ~(1 << index);
+    }
+    //! Байт уже прочитан, повторное сравнение в writeByte() не нужно
+    if(byte == old){
+        _skippedWrites++;
+        return;
+    }
+    if(!programPage(address, &byte, 1)){
+        _errorCode = error::WRITE_NOT_ENABLED;
+        return;
+    }
+    if(!verifyRange(address, 1, crc32(0, &byte, 1))){
+        return;
+    }
+    _errorCode = error::OK;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::readArray(address_type address, address_type length, uint8_t* out){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readArray", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return; }
+    if(uint32_t(address) + length - 1 > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return;
+    }
+    if (out == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return;
+    }
+    _driver->select();
+    sendCommand(READ,address);
+    for (address_type i{0}; i<length; i++) {
+        out[i] = _driver->transfer(0xFF);
+    }
+    _driver->deselect();
+    _errorCode = error::OK;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::writeArray(address_type address, address_type length, const uint8_t* data){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "writeArray", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return; }
+    if(uint32_t(address) + length - 1 > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE; 
+        return;
+    }
+    if (data == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return;
+    }
+    address_type start = address;
+    address_type total = length;
+    address_type offset{0};
+    uint8_t current[PAGE_SIZE];
+    //! Запись ведется блоками, максимум в размер страницы (степень двойки - смещение через маску)
+    while(length > 0){
+        uint16_t page_offset = address & (PAGE_SIZE - 1);
+        uint16_t chunk = static_cast<uint16_t>(std::min<address_type>(PAGE_SIZE - page_offset, length));
+        //! Читаем текущее содержимое страницы и ищем диапазон измененных байт
+        readArray(address, chunk, current);
+        uint16_t first{0};
+        while(first < chunk && current[first] == data[offset+first]){
+            first++;
+        }
+        if(first == chunk){
+            _skippedWrites++;
+        } else {
+            uint16_t last = chunk - 1;
+            while(current[last] == data[offset+last]){
+                last--;
+            }
+            if(!programPage(address + first, data + offset + first, last - first + 1)){
+                _errorCode = error::WRITE_NOT_ENABLED;
+                return;
+            }
+        }
+        address += chunk; offset += chunk; length -= chunk;
+    }
+    //! Весь диапазон (включая пропущенные страницы) проверяется одним чтением
+    if(!verifyRange(start, total, crc32(0, data, total))){
+        return;
+    }
+    _errorCode = error::OK;
+}
+template<class Traits>
+typename EEPROM25LCxxx<Traits>::error EEPROM25LCxxx<Traits>::checkError(){
+    return _errorCode;
+}
+template<class Traits>
+uint32_t EEPROM25LCxxx<Traits>::skippedWrites() const{
+    return _skippedWrites;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::resetSkippedWrites(){
+    _skippedWrites = 0;
+}
+template<class Traits>
+void EEPROM25LCxxx<Traits>::setVerifyWrites(bool enable){ _verifyWrites = enable; }
+template<class Traits>
+bool EEPROM25LCxxx<Traits>::verifyWrites() const{ return _verifyWrites; }
+template<class Traits>
+void EEPROM25LCxxx<Traits>::setTracer(TraceRing* tracer){ _tracer = tracer; }
+template<class Traits>
+uint32_t EEPROM25LCxxx<Traits>::checksum(address_type address, address_type length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "checksum", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return 0; }
+    if(uint32_t(address) + length - 1 > MAX_ADDR) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return 0;
+    }
+    uint32_t crc = readCRC(address, length);
+    _errorCode = error::OK;
+    return crc;
+}
+template<class Traits>
+storageError EEPROM25LCxxx<Traits>::toStorageError(error code){
+    switch (code) {
+        case error::OK: return storageError::OK;
+        case error::ADDRESS_OUT_OF_RANGE: return storageError::ADDRESS_OUT_OF_RANGE;
+        case error::WRITE_NOT_ENABLED: return storageError::WRITE_NOT_ENABLED;
+        case error::NULL_POINTER: return storageError::NULL_POINTER;
+        default: return storageError::DEVICE_ERROR;
+    }
+}
+template<class Traits>
+const StorageGeometry& EEPROM25LCxxx<Traits>::geometry() const{ return GEOMETRY; }
+template<class Traits>
+storageError EEPROM25LCxxx<Traits>::read(uint32_t address, uint32_t length, uint8_t* out){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "read", "address", address, "length", length};
+    if (uint64_t(address) + length > GEOMETRY.capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return storageError::ADDRESS_OUT_OF_RANGE;
+    }
+    readArray(static_cast<address_type>(address), static_cast<address_type>(length), out);
+    return toStorageError(_errorCode);
+}
+template<class Traits>
+storageError EEPROM25LCxxx<Traits>::program(uint32_t address, uint32_t length, const uint8_t* data){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "program", "address", address, "length", length};
+    if (uint64_t(address) + length > GEOMETRY.capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return storageError::ADDRESS_OUT_OF_RANGE;
+    }
+    writeArray(static_cast<address_type>(address), static_cast<address_type>(length), data);
+    return toStorageError(_errorCode);
+}
+template<class Traits>
+storageError EEPROM25LCxxx<Traits>::erase(uint32_t, uint32_t){
+    return storageError::NOT_SUPPORTED;
+}
+
+template class EEPROM25LCxxx<traits25LC010A>;
+template class EEPROM25LCxxx<traits25LC020A>;
+template class EEPROM25LCxxx<traits25LC040A>;
+template class EEPROM25LCxxx<traits25LC080A>;
+template class EEPROM25LCxxx<traits25LC080B>;
+template class EEPROM25LCxxx<traits25LC160A>;
+template class EEPROM25LCxxx<traits25LC160B>;
+template class EEPROM25LCxxx<traits25LC320A>;
+template class EEPROM25LCxxx<traits25LC640A>;
+template class EEPROM25LCxxx<traits25LC128>;
+template class EEPROM25LCxxx<traits25LC256>;
+template class EEPROM25LCxxx<traits25LC512>;
+template class EEPROM25LCxxx<traits25LC1024>;
@@ -0,0 +1,220 @@
+#include "ABRecordStore.h"
+#include "CRC32.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+void putU16(uint8_t* out, uint16_t value){
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+void putU32(uint8_t* out, uint32_t value){
+    for (uint8_t i{0}; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+uint16_t getU16(const uint8_t* in){
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+uint32_t getU32(const uint8_t* in){
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+}
+
+ABRecordStore::ABRecordStore(IStorage* storage, uint32_t start, uint32_t length, uint16_t size){
+    assert(storage != nullptr);
+    _storage = storage;
+    _start = start;
+    _length = length;
+    _size = size;
+    _data.resize(size);
+    _copies[0].resize(size);
+    _copies[1].resize(size);
+}
+ABRecordStore::error ABRecordStore::checkError(){ return _errorCode; }
+uint16_t ABRecordStore::size() const{ return _size; }
+uint32_t ABRecordStore::sequence() const{ return _sequence; }
+const ABRecordStore::statistics& ABRecordStore::stats() const{ return _stats; }
+bool ABRecordStore::dirty() const{ return _data != _copies[_active]; }
+uint16_t ABRecordStore::pageSize() const{ return _storage->geometry().pageSize; }
+uint32_t ABRecordStore::copySize() const{
+    uint32_t page = pageSize();
+    return page + (uint32_t(_size) + page - 1) / page * page;
+}
+uint32_t ABRecordStore::copyAddress(uint8_t copy) const{ return _start + copy * copySize(); }
+bool ABRecordStore::validRegion() const{
+    const StorageGeometry& geometry = _storage->geometry();
+    return !geometry.needsErase && geometry.pageSize >= HEADER_SIZE && _size != 0 &&
+        _start % geometry.pageSize == 0 && 2 * copySize() <= _length &&
+        uint64_t(_start) + _length <= geometry.capacity;
+}
+
+bool ABRecordStore::loadCopy(uint8_t copy, uint32_t& sequence){
+    uint8_t header[HEADER_SIZE];
+    uint32_t address = copyAddress(copy);
+    if (_storage->read(address, HEADER_SIZE, header) != storageError::OK ||
+        _storage->read(address + pageSize(), _size, _copies[copy].data()) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    _known[copy] = true;
+    sequence = getU32(header + 4);
+    return getU16(header) == HEADER_MAGIC && getU16(header + 2) == _size &&
+        getU32(header + 12) == crc32(0, header, 12) &&
+        getU32(header + 8) == crc32(0, _copies[copy].data(), _size);
+}
+bool ABRecordStore::writeHeader(uint8_t copy, uint32_t sequence, uint32_t crc){
+    uint8_t header[HEADER_SIZE];
+    putU16(header, HEADER_MAGIC);
+    putU16(header + 2, _size);
+    putU32(header + 4, sequence);
+    putU32(header + 8, crc);
+    putU32(header + 12, crc32(0, header, 12));
+    if (_storage->program(copyAddress(copy), HEADER_SIZE, header) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    _stats.pagesWritten++;
+    return true;
+}
+bool ABRecordStore::writeCopy(uint8_t copy, uint32_t sequence){
+    uint32_t page = pageSize();
+    uint32_t address = copyAddress(copy) + page;
+    //! После ошибки содержимое копии неизвестно, следующая фиксация запишет ее целиком
+    bool known = _known[copy];
+    _known[copy] = false;
+    for (uint32_t offset{0}; offset < _size; offset += page) {
+        uint32_t chunk = std::min<uint32_t>(page, _size - offset);
+        if (known && std::memcmp(_data.data() + offset, _copies[copy].data() + offset, chunk) == 0) {
+            _stats.pagesSkipped++;
+            continue;
+        }
+        if (_storage->program(address + offset, chunk, _data.data() + offset) != storageError::OK) {
+            _errorCode = error::STORAGE_ERROR;
+            return false;
+        }
+        std::memcpy(_copies[copy].data() + offset, _data.data() + offset, chunk);
+        _stats.pagesWritten++;
+    }
+    _known[copy] = true;
+    //! Заголовок - последним: до этого момента действует другая копия
+    return writeHeader(copy, sequence, crc32(0, _data.data(), _size));
+}
+
+bool ABRecordStore::mount(){
+    _mounted = false;
+    _errorCode = error::OK;
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    uint32_t sequence[2];
+    bool valid[2];
+    for (uint8_t copy{0}; copy < 2; copy++) {
+        valid[copy] = loadCopy(copy, sequence[copy]);
+        if (_errorCode == error::STORAGE_ERROR) {
+            return false;
+        }
+    }
+    if (!valid[0] && !valid[1]) {
+        _errorCode = error::NO_VALID_COPY;
+        return false;
+    }
+    //! Сравнение с учетом переполнения порядкового номера
+    if (valid[0] && valid[1]) {
+        _active = static_cast<int32_t>(sequence[1] - sequence[0]) > 0 ? 1 : 0;
+    } else {
+        _active = valid[0] ? 0 : 1;
+    }
+    _sequence = sequence[_active];
+    _data = _copies[_active];
+    _mounted = true;
+    _errorCode = error::OK;
+    return true;
+}
+bool ABRecordStore::format(){
+    _mounted = false;
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    uint8_t blank[HEADER_SIZE] {};
+    if (_storage->program(copyAddress(1), HEADER_SIZE, blank) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    //! Содержимое копии B читается, чтобы первая фиксация записала только отличия
+    if (_storage->read(copyAddress(1) + pageSize(), _size, _copies[1].data()) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    std::fill(_data.begin(), _data.end(), 0);
+    _known[0] = false;
+    _known[1] = true;
+    if (!writeCopy(0, 1)) {
+        return false;
+    }
+    _active = 0;
+    _sequence = 1;
+    _mounted = true;
+    _stats.commits++;
+    _errorCode = error::OK;
+    return true;
+}
+bool ABRecordStore::read(uint16_t offset, uint8_t* out, uint16_t length){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (out == nullptr && length != 0) {
+        _errorCode = error::NULL_POINTER;
+        return false;
+    }
+    if (uint32_t(offset) + length > _size) {
+        _errorCode = error::OUT_OF_RANGE;
+        return false;
+    }
+    std::copy(_data.begin() + offset, _data.begin() + offset + length, out);
+    _errorCode = error::OK;
+    return true;
+}
+bool ABRecordStore::write(uint16_t offset, const uint8_t* data, uint16_t length){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (data == nullptr && length != 0) {
+        _errorCode = error::NULL_POINTER;
+        return false;
+    }
+    if (uint32_t(offset) + length > _size) {
+        _errorCode = error::OUT_OF_RANGE;
+        return false;
+    }
+    std::copy(data, data + length, _data.begin() + offset);
+    _errorCode = error::OK;
+    return true;
+}
+bool ABRecordStore::commit(){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (!dirty()) {
+        _errorCode = error::OK;
+        return true;
+    }
+    uint8_t target = _active ^ 1;
+    if (!writeCopy(target, _sequence + 1)) {
+        return false;
+    }
+    _active = target;
+    _sequence++;
+    _stats.commits++;
+    _errorCode = error::OK;
+    return true;
+}
+void ABRecordStore::rollback(){
+    _data = _copies[_active];
+}
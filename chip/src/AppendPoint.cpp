@@ -0,0 +1,99 @@
+#include "AppendPoint.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+constexpr uint32_t PAGE_SIZE = NORW25Q128::PAGE_SIZE;
+constexpr uint32_t PAGES_PER_SECTOR = NORW25Q128::SECTOR_SIZE / NORW25Q128::PAGE_SIZE;
+}
+
+AppendPointFinder::AppendPointFinder(NORW25Q128* chip){
+    assert(chip != nullptr);
+    _chip = chip;
+}
+AppendPointFinder::error AppendPointFinder::checkError(){ return _errorCode; }
+uint32_t AppendPointFinder::probes() const{ return _probes; }
+
+bool AppendPointFinder::isPageBlank(uint32_t address, uint8_t* page){
+    uint8_t buffer[PAGE_SIZE];
+    if (page == nullptr) {
+        page = buffer;
+    }
+    _chip->readArray(address, PAGE_SIZE, page);
+    _probes++;
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    return std::all_of(page, page + PAGE_SIZE, [](uint8_t b){ return b == 0xFF; });
+}
+bool AppendPointFinder::begin(uint32_t start, uint32_t length){
+    _probes = 0;
+    if (length == 0 || start % PAGE_SIZE != 0 || length % PAGE_SIZE != 0 ||
+        uint64_t(start) + length > _chip->geometry().capacity) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+uint32_t AppendPointFinder::findFirstBlankPage(uint32_t start, uint32_t length){
+    if (!begin(start, length)) {
+        return start + length;
+    }
+    uint32_t pages = length / PAGE_SIZE;
+    uint32_t sectors = (pages + PAGES_PER_SECTOR - 1) / PAGES_PER_SECTOR;
+
+    //! Первый сектор (считая от начала области), первая страница которого пуста
+    uint32_t low{0};
+    uint32_t high = sectors;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        bool blank = isPageBlank(start + middle * PAGES_PER_SECTOR * PAGE_SIZE);
+        if (_errorCode != error::OK) {
+            return start + length;
+        }
+        if (blank) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    if (low == 0) {
+        return start;
+    }
+    //! Граница внутри предыдущего сектора, его первая страница записана
+    uint32_t first = (low - 1) * PAGES_PER_SECTOR + 1;
+    uint32_t last = std::min(low * PAGES_PER_SECTOR, pages);
+    while (first < last) {
+        uint32_t middle = first + (last - first) / 2;
+        bool blank = isPageBlank(start + middle * PAGE_SIZE);
+        if (_errorCode != error::OK) {
+            return start + length;
+        }
+        if (blank) {
+            last = middle;
+        } else {
+            first = middle + 1;
+        }
+    }
+    return start + first * PAGE_SIZE;
+}
+uint32_t AppendPointFinder::findAppendPoint(uint32_t start, uint32_t length){
+    uint32_t page = findFirstBlankPage(start, length);
+    if (_errorCode != error::OK || page == start) {
+        return page;
+    }
+    //! Последняя записанная страница может быть заполнена частично
+    uint8_t content[PAGE_SIZE];
+    uint32_t previous = page - PAGE_SIZE;
+    isPageBlank(previous, content);
+    if (_errorCode != error::OK) {
+        return start + length;
+    }
+    uint32_t end = PAGE_SIZE;
+    while (end > 0 && content[end - 1] == 0xFF) {
+        end--;
+    }
+    return previous + end;
+}
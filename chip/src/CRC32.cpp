@@ -0,0 +1,44 @@
+#include "CRC32.h"
+
+namespace {
+//! Таблицы slice-by-8: tables[k][b] - вклад байта b, за которым следуют k нулевых байт
+struct crcTables{
+    uint32_t values[8][256];
+};
+constexpr crcTables makeTables(){
+    crcTables tables{};
+    for (uint32_t i{0}; i < 256; i++) {
+        uint32_t crc = i;
+        for (uint8_t bit{0}; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+        tables.values[0][i] = crc;
+    }
+    for (uint32_t i{0}; i < 256; i++) {
+        for (uint8_t k{1}; k < 8; k++) {
+            uint32_t previous = tables.values[k - 1][i];
+            tables.values[k][i] = (previous >> 8) ^ tables.values[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+constexpr crcTables TABLES = makeTables();
+uint32_t getU32(const uint8_t* in){
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, uint32_t length){
+    const auto& t = TABLES.values;
+    crc = ~crc;
+    for (; length >= 8; data += 8, length -= 8) {
+        uint32_t low = getU32(data) ^ crc;
+        uint32_t high = getU32(data + 4);
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+    }
+    for (; length > 0; data++, length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+    }
+    return ~crc;
+}
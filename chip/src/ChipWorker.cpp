@@ -0,0 +1,156 @@
+#include "ChipWorker.h"
+#include <cassert>
+#include <utility>
+
+ChipWorker::ChipWorker(IStorage* storage, size_t capacity){
+    assert(storage != nullptr);
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    _storage = storage;
+    _slots.reset(new slot[capacity]);
+    _mask = capacity - 1;
+    for (size_t i{0}; i < capacity; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _thread = std::thread(&ChipWorker::run, this);
+}
+ChipWorker::~ChipWorker(){
+    _stop.store(true);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake.notify_one();
+    }
+    _thread.join();
+}
+ChipWorker::statistics ChipWorker::stats() const{
+    return statistics{_completed.load(), _wakeups.load(), _fullWaits.load()};
+}
+
+bool ChipWorker::tryPush(job& j){
+    size_t position = _tail.load(std::memory_order_relaxed);
+    while (true) {
+        slot& s = _slots[position & _mask];
+        size_t sequence = s.sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            //! Ячейка свободна: занять ее, сдвинув позицию записи
+            if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                s.value = std::move(j);
+                s.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = _tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+void ChipWorker::push(job& j){
+    if (!tryPush(j)) {
+        _fullWaits++;
+        while (!tryPush(j)) {
+            std::this_thread::yield();
+        }
+    }
+    //! Пара барьеров с run(): либо поток увидит запрос, либо производитель увидит, что поток спит
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake.notify_one();
+    }
+}
+bool ChipWorker::ready() const{
+    return _slots[_head & _mask].sequence.load(std::memory_order_acquire) == _head + 1;
+}
+void ChipWorker::run(){
+    while (true) {
+        if (ready()) {
+            slot& s = _slots[_head & _mask];
+            job j = std::move(s.value);
+            s.sequence.store(_head + _mask + 1, std::memory_order_release);
+            _head++;
+            execute(j);
+            continue;
+        }
+        if (_stop.load()) {
+            return;
+        }
+        _sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready()) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this](){ return ready() || _stop.load(); });
+            _wakeups++;
+        }
+        _sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+void ChipWorker::execute(job& j){
+    storageError result = storageError::OK;
+    switch (j.type) {
+        case operation::READ: result = _storage->read(j.address, j.length, j.out); break;
+        case operation::PROGRAM: result = _storage->program(j.address, j.length, j.data); break;
+        case operation::ERASE: result = _storage->erase(j.address, j.length); break;
+    }
+    _completed++;
+    if (j.done) {
+        j.done(result);
+    } else {
+        j.promise.set_value(result);
+    }
+}
+std::future<storageError> ChipWorker::submit(job& j){
+    std::future<storageError> result = j.promise.get_future();
+    push(j);
+    return result;
+}
+
+std::future<storageError> ChipWorker::read(uint32_t address, uint32_t length, uint8_t* out){
+    job j;
+    j.type = operation::READ;
+    j.address = address;
+    j.length = length;
+    j.out = out;
+    return submit(j);
+}
+void ChipWorker::read(uint32_t address, uint32_t length, uint8_t* out, callback done){
+    job j;
+    j.type = operation::READ;
+    j.address = address;
+    j.length = length;
+    j.out = out;
+    j.done = std::move(done);
+    push(j);
+}
+std::future<storageError> ChipWorker::program(uint32_t address, uint32_t length, const uint8_t* data){
+    job j;
+    j.type = operation::PROGRAM;
+    j.address = address;
+    j.length = length;
+    j.data = data;
+    return submit(j);
+}
+void ChipWorker::program(uint32_t address, uint32_t length, const uint8_t* data, callback done){
+    job j;
+    j.type = operation::PROGRAM;
+    j.address = address;
+    j.length = length;
+    j.data = data;
+    j.done = std::move(done);
+    push(j);
+}
+std::future<storageError> ChipWorker::erase(uint32_t address, uint32_t length){
+    job j;
+    j.type = operation::ERASE;
+    j.address = address;
+    j.length = length;
+    return submit(j);
+}
+void ChipWorker::erase(uint32_t address, uint32_t length, callback done){
+    job j;
+    j.type = operation::ERASE;
+    j.address = address;
+    j.length = length;
+    j.done = std::move(done);
+    push(j);
+}
@@ -0,0 +1,302 @@
+#include "CompressedLog.h"
+#include "CRC32.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+void putU16(uint8_t* out, uint16_t value){
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+void putU32(uint8_t* out, uint32_t value){
+    for (uint8_t i{0}; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+uint16_t getU16(const uint8_t* in){
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+uint32_t getU32(const uint8_t* in){
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+}
+
+CompressedLog::CompressedLog(IStorage* storage, uint32_t start, uint32_t length, bool compression){
+    assert(storage != nullptr);
+    _storage = storage;
+    _start = start;
+    _length = length;
+    _compression = compression;
+    _buffer.reserve(BLOCK_SIZE);
+    _cache.resize(BLOCK_SIZE);
+}
+CompressedLog::error CompressedLog::checkError(){ return _errorCode; }
+const CompressedLog::statistics& CompressedLog::stats() const{ return _stats; }
+uint32_t CompressedLog::bufferOffset() const{
+    return _index.empty() ? 0 : _index.back().offset + _index.back().rawLength;
+}
+uint32_t CompressedLog::size() const{
+    return bufferOffset() + static_cast<uint32_t>(_buffer.size());
+}
+uint32_t CompressedLog::alignPage(uint32_t address) const{
+    uint32_t page = _storage->geometry().pageSize;
+    return (address - _start + page - 1) / page * page + _start;
+}
+bool CompressedLog::validRegion() const{
+    const StorageGeometry& geometry = _storage->geometry();
+    uint32_t unit = geometry.needsErase ? geometry.minEraseSize() : geometry.pageSize;
+    return unit != 0 && _length != 0 && _start % unit == 0 && _length % unit == 0 &&
+        uint64_t(_start) + _length <= geometry.capacity;
+}
+void CompressedLog::reset(){
+    _index.clear();
+    _buffer.clear();
+    _cached = SIZE_MAX;
+    _next = _start;
+    _mounted = false;
+}
+bool CompressedLog::readStorage(uint32_t address, uint8_t* out, uint32_t length){
+    if (_storage->read(address, length, out) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    return true;
+}
+bool CompressedLog::isPageBlank(uint32_t address, bool& blank){
+    const StorageGeometry& geometry = _storage->geometry();
+    std::vector<uint8_t> page(geometry.pageSize);
+    if (!readStorage(address, page.data(), geometry.pageSize)) {
+        return false;
+    }
+    blank = std::all_of(page.begin(), page.end(), [&geometry](uint8_t b){ return b == geometry.eraseValue; });
+    return true;
+}
+bool CompressedLog::format(){
+    reset();
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    const StorageGeometry& geometry = _storage->geometry();
+    storageError result;
+    if (geometry.needsErase) {
+        result = _storage->erase(_start, _length);
+    } else {
+        //! Память без стирания заполняется значением стертой памяти, чтобы mount() нашел конец
+        std::vector<uint8_t> blank(geometry.pageSize, geometry.eraseValue);
+        result = storageError::OK;
+        for (uint32_t address = _start; address < _start + _length && result == storageError::OK; address += geometry.pageSize) {
+            result = _storage->program(address, geometry.pageSize, blank.data());
+        }
+    }
+    if (result != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+    return true;
+}
+bool CompressedLog::mount(){
+    reset();
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    uint32_t end = _start + _length;
+    uint32_t page = _storage->geometry().pageSize;
+    uint32_t offset{0};
+    //! После поврежденного кадра следующий ищется на границах страниц и проверяется CRC
+    bool resync{false};
+    std::vector<uint8_t> frame(BLOCK_SIZE);
+    while (_next < end) {
+        uint8_t header[FRAME_HEADER_SIZE];
+        bool valid{false};
+        uint16_t storedLength{0};
+        if (_next + FRAME_HEADER_SIZE <= end) {
+            if (!readStorage(_next, header, FRAME_HEADER_SIZE)) {
+                return false;
+            }
+            uint16_t rawLength = getU16(header + 4);
+            storedLength = getU16(header + 6);
+            valid = getU16(header) == FRAME_MAGIC && (header[2] == RAW || header[2] == LZ) &&
+                rawLength != 0 && rawLength <= BLOCK_SIZE && getU32(header + 8) == offset &&
+                FRAME_HEADER_SIZE + storedLength <= end - _next;
+            block item{};
+            if (valid && resync) {
+                valid = loadFrame(_next, frame.data(), item);
+            }
+            if (valid) {
+                _index.push_back(block{offset, _next, rawLength});
+                offset += rawLength;
+                _next = alignPage(_next + FRAME_HEADER_SIZE + storedLength);
+                resync = false;
+                continue;
+            }
+        }
+        //! Первая стертая страница - конец журнала; иначе страница оборванного кадра пропускается
+        bool blank{false};
+        if (!isPageBlank(_next, blank)) {
+            return false;
+        }
+        if (blank) {
+            break;
+        }
+        resync = true;
+        _next += page;
+    }
+    _next = std::min(_next, end);
+    _mounted = true;
+    _errorCode = error::OK;
+    return true;
+}
+
+bool CompressedLog::writeBlock(){
+    if (_buffer.empty()) {
+        return true;
+    }
+    uint32_t rawLength = static_cast<uint32_t>(_buffer.size());
+    std::vector<uint8_t> frame(FRAME_HEADER_SIZE + LZCodec::bound(BLOCK_SIZE));
+    //! Сжатый блок принимается, только если он короче исходного
+    uint32_t storedLength = _compression ? _codec.compress(_buffer.data(), rawLength, frame.data() + FRAME_HEADER_SIZE, rawLength - 1) : 0;
+    uint8_t type = LZ;
+    if (storedLength == 0) {
+        type = RAW;
+        storedLength = rawLength;
+        std::memcpy(frame.data() + FRAME_HEADER_SIZE, _buffer.data(), rawLength);
+    }
+    if (FRAME_HEADER_SIZE + storedLength > _start + _length - _next) {
+        _errorCode = error::LOG_FULL;
+        return false;
+    }
+    putU16(frame.data(), FRAME_MAGIC);
+    frame[2] = type;
+    frame[3] = 0xFF;
+    putU16(frame.data() + 4, static_cast<uint16_t>(rawLength));
+    putU16(frame.data() + 6, static_cast<uint16_t>(storedLength));
+    putU32(frame.data() + 8, bufferOffset());
+    putU32(frame.data() + 12, crc32(0, _buffer.data(), rawLength));
+    //! Заголовок пишется последним: кадр без заголовка mount() пропустит
+    if (_storage->program(_next + FRAME_HEADER_SIZE, storedLength, frame.data() + FRAME_HEADER_SIZE) != storageError::OK ||
+        _storage->program(_next, FRAME_HEADER_SIZE, frame.data()) != storageError::OK) {
+        _errorCode = error::STORAGE_ERROR;
+        return false;
+    }
+    _index.push_back(block{bufferOffset(), _next, static_cast<uint16_t>(rawLength)});
+    _next = alignPage(_next + FRAME_HEADER_SIZE + storedLength);
+    _buffer.clear();
+    _stats.blocks++;
+    _stats.rawBytes += rawLength;
+    _stats.storedBytes += FRAME_HEADER_SIZE + storedLength;
+    return true;
+}
+bool CompressedLog::loadFrame(uint32_t address, uint8_t* out, block& item){
+    uint8_t header[FRAME_HEADER_SIZE];
+    if (!readStorage(address, header, FRAME_HEADER_SIZE)) {
+        return false;
+    }
+    uint16_t rawLength = getU16(header + 4);
+    uint16_t storedLength = getU16(header + 6);
+    if (getU16(header) != FRAME_MAGIC || rawLength == 0 || rawLength > BLOCK_SIZE ||
+        (header[2] == RAW && storedLength != rawLength)) {
+        _errorCode = error::CORRUPTED;
+        return false;
+    }
+    std::vector<uint8_t> stored(storedLength);
+    if (!readStorage(address + FRAME_HEADER_SIZE, stored.data(), storedLength)) {
+        return false;
+    }
+    bool ok{false};
+    if (header[2] == LZ) {
+        ok = LZCodec::decompress(stored.data(), storedLength, out, rawLength);
+    } else if (header[2] == RAW) {
+        std::memcpy(out, stored.data(), rawLength);
+        ok = true;
+    }
+    if (!ok || crc32(0, out, rawLength) != getU32(header + 12)) {
+        _errorCode = error::CORRUPTED;
+        return false;
+    }
+    item = block{getU32(header + 8), address, rawLength};
+    _stats.decompressed++;
+    return true;
+}
+
+bool CompressedLog::append(const uint8_t* data, uint32_t length){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (data == nullptr && length != 0) {
+        _errorCode = error::NULL_POINTER;
+        return false;
+    }
+    while (length > 0) {
+        //! Полный буфер мог остаться после LOG_FULL или ошибки памяти
+        if (_buffer.size() == BLOCK_SIZE && !writeBlock()) {
+            return false;
+        }
+        uint32_t chunk = std::min(BLOCK_SIZE - static_cast<uint32_t>(_buffer.size()), length);
+        _buffer.insert(_buffer.end(), data, data + chunk);
+        data += chunk; length -= chunk;
+    }
+    if (_buffer.size() == BLOCK_SIZE && !writeBlock()) {
+        return false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+bool CompressedLog::flush(){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (!writeBlock()) {
+        return false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+bool CompressedLog::read(uint32_t offset, uint8_t* out, uint32_t length){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (out == nullptr && length != 0) {
+        _errorCode = error::NULL_POINTER;
+        return false;
+    }
+    if (uint64_t(offset) + length > size()) {
+        _errorCode = error::OUT_OF_RANGE;
+        return false;
+    }
+    uint32_t buffered = bufferOffset();
+    while (length > 0) {
+        if (offset >= buffered) {
+            std::memcpy(out, _buffer.data() + (offset - buffered), length);
+            break;
+        }
+        size_t number = std::upper_bound(_index.begin(), _index.end(), offset,
+            [](uint32_t value, const block& item){ return value < item.offset; }) - _index.begin() - 1;
+        const block& item = _index[number];
+        if (_cached != number) {
+            block loaded{};
+            if (!loadFrame(item.address, _cache.data(), loaded)) {
+                _cached = SIZE_MAX;
+                return false;
+            }
+            if (loaded.offset != item.offset || loaded.rawLength != item.rawLength) {
+                _cached = SIZE_MAX;
+                _errorCode = error::CORRUPTED;
+                return false;
+            }
+            _cached = number;
+        }
+        uint32_t chunk = std::min(item.offset + item.rawLength - offset, length);
+        std::memcpy(out, _cache.data() + (offset - item.offset), chunk);
+        offset += chunk; out += chunk; length -= chunk;
+    }
+    _errorCode = error::OK;
+    return true;
+}
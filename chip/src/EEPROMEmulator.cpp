@@ -0,0 +1,254 @@
+#include "EEPROMEmulator.h"
+#include <algorithm>
+#include <cassert>
+
+EEPROMEmulator::EEPROMEmulator(NORW25Q128* chip, uint32_t startAddress, uint16_t capacity){
+    assert(chip != nullptr);
+    _chip = chip;
+    _start = startAddress;
+    _capacity = capacity;
+}
+EEPROMEmulator::error EEPROMEmulator::checkError(){ return _errorCode; }
+uint32_t EEPROMEmulator::consolidations() const{ return _consolidations; }
+
+uint32_t EEPROMEmulator::sectorSize() const{ return _chip->geometry().minEraseSize(); }
+uint32_t EEPROMEmulator::sectorAddress(uint8_t sector) const{
+    return _start + sector * sectorSize();
+}
+bool EEPROMEmulator::checkRegion(){
+    uint32_t size = sectorSize();
+    if (_capacity == 0 || _capacity > MAX_CAPACITY || size < journalStart() + RECORD_SIZE ||
+        _start % size != 0 || uint64_t(_start) + 2 * uint64_t(size) > _chip->geometry().capacity) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    return true;
+}
+uint32_t EEPROMEmulator::journalStart() const{
+    //! Записи журнала выровнены на 4 байта и не пересекают границы страниц
+    return (SECTOR_HEADER_SIZE + _capacity + RECORD_SIZE - 1) / RECORD_SIZE * RECORD_SIZE;
+}
+uint8_t EEPROMEmulator::recordCheck(uint16_t address, uint8_t value){
+    return static_cast<uint8_t>((address & 0xFF) ^ (address >> 8) ^ value ^ 0xA5);
+}
+bool EEPROMEmulator::program(uint32_t address, const uint8_t* data, uint32_t length){
+    uint32_t pageSize = _chip->geometry().pageSize;
+    while (length > 0) {
+        uint32_t chunk = std::min(pageSize - address % pageSize, length);
+        _chip->pageProgram(address, data, static_cast<uint16_t>(chunk));
+        if (_chip->checkError() != NORW25Q128::error::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return false;
+        }
+        address += chunk; data += chunk; length -= chunk;
+    }
+    return true;
+}
+bool EEPROMEmulator::consolidate(const std::vector<uint8_t>& image){
+    uint8_t target = _active ^ 1;
+    _chip->eraseSector(sectorAddress(target));
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    if (!program(sectorAddress(target) + SECTOR_HEADER_SIZE, image.data(), _capacity)) {
+        return false;
+    }
+    //! Заголовок пишется после снимка: целый заголовок означает целый снимок
+    uint32_t sequence = _sequence + 1;
+    uint8_t header[SECTOR_HEADER_SIZE];
+    for (uint8_t i{0}; i < 4; i++) {
+        header[i] = (SECTOR_MAGIC >> (8 * i)) & 0xFF;
+        header[4 + i] = (sequence >> (8 * i)) & 0xFF;
+    }
+    if (!program(sectorAddress(target), header, SECTOR_HEADER_SIZE)) {
+        return false;
+    }
+    //! Второй сектор стал действующим; старый сектор при ошибке стирания сотрет следующее уплотнение
+    uint8_t previous = _active;
+    _image = image;
+    _active = target;
+    _sequence = sequence;
+    _journalOffset = journalStart();
+    _consolidations++;
+    _chip->eraseSector(sectorAddress(previous));
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    return true;
+}
+void EEPROMEmulator::store(uint16_t address, uint16_t length, const uint8_t* data){
+    std::vector<uint8_t> records;
+    for (uint16_t i{0}; i < length; i++) {
+        uint16_t target = address + i;
+        if (_image[target] == data[i]) {
+            continue;
+        }
+        records.push_back(target & 0xFF);
+        records.push_back(target >> 8);
+        records.push_back(data[i]);
+        records.push_back(recordCheck(target, data[i]));
+    }
+    if (records.empty()) {
+        _errorCode = error::OK;
+        return;
+    }
+    //! Не хватает места в журнале: новое содержимое сразу пишется снимком
+    if (_journalOffset + records.size() > sectorSize()) {
+        std::vector<uint8_t> image = _image;
+        std::copy(data, data + length, image.begin() + address);
+        if (consolidate(image)) {
+            _errorCode = error::OK;
+        }
+        return;
+    }
+    //! Место попытки занято и при ошибке: поверх частично записанных байтов писать нельзя
+    uint32_t offset = _journalOffset;
+    _journalOffset += static_cast<uint32_t>(records.size());
+    if (!program(sectorAddress(_active) + offset, records.data(), static_cast<uint32_t>(records.size()))) {
+        //! Часть записей могла попасть в журнал: снимок неизмененной копии отменяет их
+        consolidate(_image);
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    for (size_t r{0}; r < records.size(); r += RECORD_SIZE) {
+        _image[records[r] | (records[r + 1] << 8)] = records[r + 2];
+    }
+    _errorCode = error::OK;
+}
+
+void EEPROMEmulator::mount(){
+    _mounted = false;
+    if (!checkRegion()) {
+        return;
+    }
+    _errorCode = error::OK;
+    bool valid[2] {false, false};
+    uint32_t sequence[2] {0, 0};
+    for (uint8_t s{0}; s < 2; s++) {
+        uint8_t header[SECTOR_HEADER_SIZE];
+        _chip->readArray(sectorAddress(s), SECTOR_HEADER_SIZE, header);
+        if (_chip->checkError() != NORW25Q128::error::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return;
+        }
+        uint32_t magic{0};
+        for (uint8_t i{0}; i < 4; i++) {
+            magic |= uint32_t(header[i]) << (8 * i);
+            sequence[s] |= uint32_t(header[4 + i]) << (8 * i);
+        }
+        valid[s] = magic == SECTOR_MAGIC;
+    }
+    if (!valid[0] && !valid[1]) {
+        format();
+        return;
+    }
+    _active = (valid[0] && (!valid[1] || sequence[0] > sequence[1])) ? 0 : 1;
+    _sequence = sequence[_active];
+
+    //! Снимок и журнал читаются одним чтением
+    std::vector<uint8_t> content(sectorSize());
+    if (_chip->read(sectorAddress(_active), sectorSize(), content.data()) != storageError::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    _image.assign(content.begin() + SECTOR_HEADER_SIZE, content.begin() + SECTOR_HEADER_SIZE + _capacity);
+    _journalOffset = journalStart();
+    while (_journalOffset + RECORD_SIZE <= content.size()) {
+        const uint8_t* record = content.data() + _journalOffset;
+        if (std::all_of(record, record + RECORD_SIZE, [](uint8_t b){ return b == 0xFF; })) {
+            break;
+        }
+        uint16_t address = static_cast<uint16_t>(record[0] | (record[1] << 8));
+        //! Оборванная запись пропускается, ее место занято
+        if (address < _capacity && record[3] == recordCheck(address, record[2])) {
+            _image[address] = record[2];
+        }
+        _journalOffset += RECORD_SIZE;
+    }
+    _mounted = true;
+}
+void EEPROMEmulator::format(){
+    _mounted = false;
+    if (!checkRegion()) {
+        return;
+    }
+    _sequence = 0;
+    _active = 1;
+    //! Уплотнение стирает оба сектора и пишет пустой снимок в сектор 0
+    if (!consolidate(std::vector<uint8_t>(_capacity, 0xFF))) {
+        return;
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+}
+uint8_t EEPROMEmulator::readByte(uint16_t address){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return 0; }
+    if (address >= _capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return 0;
+    }
+    _errorCode = error::OK;
+    return _image[address];
+}
+void EEPROMEmulator::writeByte(uint16_t address, uint8_t byte){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (address >= _capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return;
+    }
+    store(address, 1, &byte);
+}
+bool EEPROMEmulator::readBit(uint16_t address, uint8_t index){
+    if (index > 7) {
+        _errorCode = error::INDEX_BIT_OUT_OF_RANGE;
+        return 0;
+    }
+    return readByte(address) >> index & 0x01;
+}
+void EEPROMEmulator::writeBit(uint16_t address, uint8_t index, bool value){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (address >= _capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return;
+    }
+    if (index > 7) {
+        _errorCode = error::INDEX_BIT_OUT_OF_RANGE;
+        return;
+    }
+    uint8_t byte = _image[address];
+    if (value) {
+        byte |= (1 << index);
+    } else {
+        byte &= ~(1 << index);
+    }
+    store(address, 1, &byte);
+}
+void EEPROMEmulator::readArray(uint16_t address, uint16_t length, uint8_t* out){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (length == 0) { _errorCode = error::OK; return; }
+    if (uint32_t(address) + length > _capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return;
+    }
+    if (out == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return;
+    }
+    std::copy(_image.begin() + address, _image.begin() + address + length, out);
+    _errorCode = error::OK;
+}
+void EEPROMEmulator::writeArray(uint16_t address, uint16_t length, const uint8_t* data){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (length == 0) { _errorCode = error::OK; return; }
+    if (uint32_t(address) + length > _capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return;
+    }
+    if (data == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return;
+    }
+    store(address, length, data);
+}
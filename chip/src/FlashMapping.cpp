@@ -0,0 +1,221 @@
+#include "FlashMapping.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+FlashMapping::FlashMapping(NORW25Q128* chip, uint32_t address, uint32_t length){
+    assert(chip != nullptr);
+    _chip = chip;
+    _address = address;
+    _length = length;
+#ifdef __linux__
+    _pageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+FlashMapping::~FlashMapping(){
+    unmap();
+}
+FlashMapping::error FlashMapping::checkError(){ return _errorCode; }
+bool FlashMapping::lazy() const{ return _region != nullptr; }
+const uint8_t* FlashMapping::data() const{ return _region; }
+uint32_t FlashMapping::pageSize() const{ return _pageSize; }
+uint32_t FlashMapping::size() const{ return _length; }
+FlashMapping::statistics FlashMapping::stats() const{
+    return statistics{_pagesLoaded.load(), _readErrors.load()};
+}
+
+void FlashMapping::loadPage(uint32_t index, uint8_t* out){
+    uint32_t offset = index * _pageSize;
+    uint32_t length = std::min(_pageSize, _length - offset);
+    //! Хвост последней страницы за концом области - стертое значение
+    std::memset(out + length, _chip->geometry().eraseValue, _pageSize - length);
+    if (_chip->read(_address + offset, length, out) != storageError::OK) {
+        std::memset(out, _chip->geometry().eraseValue, length);
+        _readErrors++;
+    }
+    _pagesLoaded++;
+}
+
+bool FlashMapping::map(bool allowUserfault){
+    unmap();
+    if (_length == 0 || uint64_t(_address) + _length > _chip->geometry().capacity) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return false;
+    }
+    _pagesLoaded = 0;
+    _readErrors = 0;
+    if (allowUserfault && mapLazy()) {
+        _errorCode = error::OK;
+        return true;
+    }
+    //! Кэш не инициализируется: память занимается только затронутыми страницами
+    size_t pages = (size_t(_length) + _pageSize - 1) / _pageSize;
+    _cache.reset(new (std::nothrow) uint8_t[pages * _pageSize]);
+    if (_cache == nullptr) {
+        _errorCode = error::ALLOCATION_FAILED;
+        return false;
+    }
+    _loaded.assign(pages, false);
+    _errorCode = error::OK;
+    return true;
+}
+const uint8_t* FlashMapping::page(uint32_t offset){
+    if (offset >= _length) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return nullptr;
+    }
+    if (_region != nullptr) {
+        return _region + offset;
+    }
+    if (_cache == nullptr) {
+        _errorCode = error::NOT_MAPPED;
+        return nullptr;
+    }
+    uint32_t index = offset / _pageSize;
+    if (!_loaded[index]) {
+        uint64_t errors = _readErrors;
+        loadPage(index, _cache.get() + size_t(index) * _pageSize);
+        _loaded[index] = true;
+        _errorCode = _readErrors != errors ? error::CHIP_ERROR : error::OK;
+    }
+    return _cache.get() + offset;
+}
+
+#ifdef __linux__
+bool FlashMapping::mapLazy(){
+    //! UFFD_USER_MODE_ONLY разрешает userfaultfd без прав при vm.unprivileged_userfaultfd = 0
+    int uffd = -1;
+#ifdef UFFD_USER_MODE_ONLY
+    uffd = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+#endif
+    if (uffd < 0) {
+        uffd = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+    }
+    if (uffd < 0) {
+        return false;
+    }
+    uffdio_api api{};
+    api.api = UFFD_API;
+    size_t size = (size_t(_length) + _pageSize - 1) / _pageSize * _pageSize;
+    void* region = MAP_FAILED;
+    int stopFd = -1;
+    bool ok = ioctl(uffd, UFFDIO_API, &api) == 0;
+    if (ok) {
+        region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        ok = region != MAP_FAILED;
+    }
+    if (ok) {
+        uffdio_register reg{};
+        reg.range.start = reinterpret_cast<uintptr_t>(region);
+        reg.range.len = size;
+        reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+        ok = ioctl(uffd, UFFDIO_REGISTER, &reg) == 0 && (reg.ioctls & (1ull << _UFFDIO_COPY)) != 0;
+    }
+    if (ok) {
+        stopFd = eventfd(0, EFD_CLOEXEC);
+        ok = stopFd >= 0;
+    }
+    if (!ok) {
+        if (region != MAP_FAILED) {
+            munmap(region, size);
+        }
+        close(uffd);
+        return false;
+    }
+    _uffd = uffd;
+    _stopFd = stopFd;
+    _region = static_cast<uint8_t*>(region);
+    _regionSize = size;
+    _handler = std::thread(&FlashMapping::serveFaults, this);
+    return true;
+}
+void FlashMapping::serveFaults(){
+    //! Повторов UFFDIO_COPY при EAGAIN до подстановки нулевой страницы
+    constexpr uint8_t COPY_ATTEMPTS = 16;
+    std::vector<uint8_t> buffer(_pageSize);
+    pollfd fds[2] = {{_uffd, POLLIN, 0}, {_stopFd, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        //! Ошибка или закрытие userfaultfd - остановка, иначе poll() возвращался бы сразу в цикле
+        if (fds[1].revents != 0 || (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+            return;
+        }
+        uffd_msg message;
+        if (read(_uffd, &message, sizeof(message)) != sizeof(message) || message.event != UFFD_EVENT_PAGEFAULT) {
+            continue;
+        }
+        uintptr_t base = reinterpret_cast<uintptr_t>(_region);
+        uint32_t index = static_cast<uint32_t>((message.arg.pagefault.address - base) / _pageSize);
+        loadPage(index, buffer.data());
+        uffdio_copy copy{};
+        copy.dst = base + uintptr_t(index) * _pageSize;
+        copy.src = reinterpret_cast<uintptr_t>(buffer.data());
+        copy.len = _pageSize;
+        bool resolved = false;
+        for (uint8_t attempt{0}; attempt < COPY_ATTEMPTS && !resolved; attempt++) {
+            copy.copy = 0;
+            //! EEXIST - страницу уже подставили по одновременной ошибке другого потока
+            resolved = ioctl(_uffd, UFFDIO_COPY, &copy) == 0 || errno == EEXIST;
+            if (!resolved && errno != EAGAIN) {
+                break;
+            }
+            //! EAGAIN: часть страницы могла быть скопирована, повтор - с остатка
+            if (!resolved && copy.copy > 0) {
+                copy.dst += static_cast<uint64_t>(copy.copy);
+                copy.src += static_cast<uint64_t>(copy.copy);
+                copy.len -= static_cast<uint64_t>(copy.copy);
+            }
+        }
+        if (!resolved) {
+            _readErrors++;
+            uffdio_zeropage zero{};
+            zero.range.start = base + uintptr_t(index) * _pageSize;
+            zero.range.len = _pageSize;
+            if (ioctl(_uffd, UFFDIO_ZEROPAGE, &zero) != 0 && errno != EEXIST) {
+                //! Страница не подставлена: поток просыпается и повторяет обращение
+                ioctl(_uffd, UFFDIO_WAKE, &zero.range);
+            }
+        }
+    }
+}
+void FlashMapping::unmap(){
+    if (_region != nullptr) {
+        //! Поток обработчика пользуется регионом и дескрипторами: они освобождаются после его завершения
+        uint64_t stop = 1;
+        while (write(_stopFd, &stop, sizeof(stop)) < 0 && errno == EINTR) {}
+        _handler.join();
+        munmap(_region, _regionSize);
+        close(_uffd);
+        close(_stopFd);
+        _region = nullptr;
+        _uffd = -1;
+        _stopFd = -1;
+    }
+    _cache.reset();
+    _loaded.clear();
+}
+#else
+bool FlashMapping::mapLazy(){ return false; }
+void FlashMapping::serveFaults(){}
+void FlashMapping::unmap(){
+    _cache.reset();
+    _loaded.clear();
+}
+#endif
@@ -0,0 +1,593 @@
+#include "KVStore.h"
+#include "CRC32.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+void putU16(uint8_t* out, uint16_t value){
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+void putU32(uint8_t* out, uint32_t value){
+    for (uint8_t i{0}; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+uint16_t getU16(const uint8_t* in){
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+uint32_t getU32(const uint8_t* in){
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+}
+
+KVStore::KVStore(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount, uint16_t checkpointSectors){
+    assert(chip != nullptr);
+    _chip = chip;
+    _start = startAddress;
+    _sectorCount = sectorCount;
+    _checkpointSectors = checkpointSectors;
+}
+KVStore::error KVStore::checkError(){ return _errorCode; }
+const KVStore::statistics& KVStore::stats() const{ return _stats; }
+size_t KVStore::size() const{ return _index.size(); }
+bool KVStore::contains(const std::string& key) const{ return _index.count(key) != 0; }
+std::vector<std::string> KVStore::keys(const std::string& prefix) const{
+    std::vector<std::string> result;
+    for (const auto& item : _index) {
+        if (item.first.compare(0, prefix.size(), prefix) == 0) {
+            result.push_back(item.first);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool KVStore::validRegion() const{
+    const StorageGeometry& geometry = _chip->geometry();
+    uint64_t sectors = uint64_t(_sectorCount) + _checkpointSectors;
+    uint32_t eraseUnit = geometry.minEraseSize();
+    return eraseUnit != 0 && SECTOR_SIZE % eraseUnit == 0 && geometry.pageSize % NORW25Q128::PAGE_SIZE == 0 &&
+           _sectorCount >= 2 && _checkpointSectors % 2 == 0 && _start % SECTOR_SIZE == 0 &&
+           uint64_t(_start) + sectors * SECTOR_SIZE <= geometry.capacity;
+}
+uint32_t KVStore::checkpointHalfSize() const{
+    return uint32_t(_checkpointSectors / 2) * SECTOR_SIZE;
+}
+uint32_t KVStore::checkpointAddress(uint8_t half) const{
+    return sectorAddress(_sectorCount) + half * checkpointHalfSize();
+}
+uint32_t KVStore::sectorAddress(uint16_t sector) const{
+    return _start + uint32_t(sector) * SECTOR_SIZE;
+}
+uint16_t KVStore::sectorOf(uint32_t address) const{
+    return static_cast<uint16_t>((address - _start) / SECTOR_SIZE);
+}
+uint32_t KVStore::recordSize(uint16_t keyLength, uint16_t valueLength){
+    return RECORD_HEADER_SIZE + keyLength + valueLength;
+}
+uint16_t KVStore::freeSectors() const{
+    return static_cast<uint16_t>(std::count(_sequence.begin(), _sequence.end(), ERASED_SEQUENCE));
+}
+uint16_t KVStore::oldestSector() const{
+    uint16_t oldest = _sectorCount;
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        if (s == _active || _sequence[s] == ERASED_SEQUENCE) {
+            continue;
+        }
+        if (oldest == _sectorCount || _sequence[s] < _sequence[oldest]) {
+            oldest = s;
+        }
+    }
+    return oldest;
+}
+uint16_t KVStore::nextErasedSector() const{
+    for (uint16_t i{1}; i <= _sectorCount; i++) {
+        uint16_t s = (_active + i) % _sectorCount;
+        if (_sequence[s] == ERASED_SEQUENCE) {
+            return s;
+        }
+    }
+    return _sectorCount;
+}
+bool KVStore::program(uint32_t address, const uint8_t* data, uint32_t length){
+    //! Страничная запись не может пересекать границу страницы
+    uint32_t pageSize = _chip->geometry().pageSize;
+    while (length > 0) {
+        uint32_t chunk = std::min(pageSize - address % pageSize, length);
+        _chip->pageProgram(address, data, static_cast<uint16_t>(chunk));
+        if (_chip->checkError() != NORW25Q128::error::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return false;
+        }
+        _stats.programmedBytes += chunk;
+        address += chunk; data += chunk; length -= chunk;
+    }
+    return true;
+}
+bool KVStore::read(uint32_t address, uint8_t* out, uint16_t length){
+    _chip->readArray(address, length, out);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    return true;
+}
+bool KVStore::eraseSector(uint16_t sector){
+    if (_chip->erase(sectorAddress(sector), SECTOR_SIZE) != storageError::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    _stats.erases++;
+    _sequence[sector] = ERASED_SEQUENCE;
+    _liveBytes[sector] = 0;
+    _usedBytes[sector] = 0;
+    return true;
+}
+bool KVStore::openSector(uint16_t sector){
+    uint8_t header[SECTOR_HEADER_SIZE];
+    putU32(header, SECTOR_MAGIC);
+    putU32(header + 4, _nextSequence);
+    if (!program(sectorAddress(sector), header, SECTOR_HEADER_SIZE)) {
+        return false;
+    }
+    _sequence[sector] = _nextSequence++;
+    _usedBytes[sector] = SECTOR_HEADER_SIZE;
+    _active = sector;
+    _sectorsSinceCheckpoint++;
+    return true;
+}
+bool KVStore::makeRoom(uint32_t size){
+    //! Каждая итерация освобождает не меньше одного сектора мусора, иначе место кончилось
+    for (uint16_t attempt{0}; attempt <= _sectorCount; attempt++) {
+        if (_usedBytes[_active] + size <= SECTOR_SIZE) {
+            return true;
+        }
+        uint16_t next = nextErasedSector();
+        if (next == _sectorCount) {
+            break;
+        }
+        if (!openSector(next)) {
+            return false;
+        }
+        //! Резервный сектор израсходован - освобождаем самый старый
+        if (freeSectors() == 0 && !collectSector(oldestSector())) {
+            return false;
+        }
+    }
+    _errorCode = error::STORE_FULL;
+    return false;
+}
+bool KVStore::collectSector(uint16_t sector){
+    if (sector == _sectorCount) {
+        _errorCode = error::STORE_FULL;
+        return false;
+    }
+    if (_liveBytes[sector] > SECTOR_SIZE - _usedBytes[_active]) {
+        _errorCode = error::STORE_FULL;
+        return false;
+    }
+    if (_liveBytes[sector] > 0) {
+        //! Сектор читается одной транзакцией, актуальные записи переносятся одной серией записи
+        uint8_t content[SECTOR_SIZE];
+        uint8_t relocated[SECTOR_SIZE];
+        uint32_t base = sectorAddress(sector);
+        uint32_t target = sectorAddress(_active) + _usedBytes[_active];
+        uint32_t moved{0};
+        if (!read(base, content, static_cast<uint16_t>(_usedBytes[sector]))) {
+            return false;
+        }
+        std::vector<std::pair<entry*, uint32_t>> updates;
+        uint32_t offset = SECTOR_HEADER_SIZE;
+        while (offset + RECORD_HEADER_SIZE <= _usedBytes[sector]) {
+            const uint8_t* record = content + offset;
+            uint16_t keyLength = record[0];
+            uint32_t size = recordSize(keyLength, getU16(record + 2));
+            if (keyLength == 0xFF || offset + size > _usedBytes[sector]) {
+                break;
+            }
+            if (record[1] == VALUE) {
+                std::string key(reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE), keyLength);
+                auto it = _index.find(key);
+                if (it != _index.end() && it->second.address == base + offset) {
+                    std::copy(record, record + size, relocated + moved);
+                    updates.emplace_back(&it->second, target + moved);
+                    moved += size;
+                }
+            }
+            offset += size;
+        }
+        if (!program(target, relocated, moved)) {
+            return false;
+        }
+        for (auto& update : updates) {
+            update.first->address = update.second;
+        }
+        _usedBytes[_active] += moved;
+        _liveBytes[_active] += moved;
+        _stats.relocatedBytes += moved;
+    }
+    return eraseSector(sector);
+}
+bool KVStore::appendRecord(recordType type, const std::string& key, const uint8_t* data, uint16_t length){
+    uint32_t size = recordSize(static_cast<uint16_t>(key.size()), length);
+    if (!makeRoom(size)) {
+        return false;
+    }
+    std::vector<uint8_t> record(size);
+    record[0] = static_cast<uint8_t>(key.size());
+    record[1] = type;
+    putU16(record.data() + 2, length);
+    std::copy(key.begin(), key.end(), record.begin() + RECORD_HEADER_SIZE);
+    if (length > 0) {
+        std::copy(data, data + length, record.begin() + RECORD_HEADER_SIZE + key.size());
+    }
+    putU32(record.data() + 4, crc32(crc32(0, record.data(), 4), record.data() + RECORD_HEADER_SIZE, size - RECORD_HEADER_SIZE));
+
+    uint32_t address = sectorAddress(_active) + _usedBytes[_active];
+    if (!program(address, record.data(), size)) {
+        return false;
+    }
+    _usedBytes[_active] += size;
+
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        _liveBytes[sectorOf(it->second.address)] -= recordSize(static_cast<uint16_t>(key.size()), it->second.valueLength);
+    }
+    if (type == VALUE) {
+        _liveBytes[_active] += size;
+        _index[key] = entry{address, length};
+    } else if (it != _index.end()) {
+        _index.erase(it);
+    }
+    return true;
+}
+uint32_t KVStore::scanSector(uint16_t sector, uint32_t offset){
+    uint8_t content[SECTOR_SIZE];
+    uint32_t base = sectorAddress(sector);
+    if (offset >= SECTOR_SIZE) {
+        return offset;
+    }
+    //! Читается только непрочитанная часть сектора, content индексируется смещением в секторе
+    if (!read(base + offset, content + offset, static_cast<uint16_t>(SECTOR_SIZE - offset))) {
+        return SECTOR_SIZE;
+    }
+    _stats.mountReadBytes += SECTOR_SIZE - offset;
+    while (offset + RECORD_HEADER_SIZE <= SECTOR_SIZE) {
+        const uint8_t* record = content + offset;
+        uint16_t keyLength = record[0];
+        uint16_t valueLength = getU16(record + 2);
+        if (std::all_of(record, record + RECORD_HEADER_SIZE, [](uint8_t b){ return b == 0xFF; })) {
+            return offset;
+        }
+        uint32_t size = recordSize(keyLength, valueLength);
+        //! Оборванная при отключении питания запись: дописывать в сектор больше нельзя
+        if (offset + size > SECTOR_SIZE || keyLength == 0 || keyLength > MAX_KEY_LENGTH ||
+            crc32(crc32(0, record, 4), record + RECORD_HEADER_SIZE, size - RECORD_HEADER_SIZE) != getU32(record + 4)) {
+            return SECTOR_SIZE;
+        }
+        std::string key(reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE), keyLength);
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            _liveBytes[sectorOf(it->second.address)] -= recordSize(keyLength, it->second.valueLength);
+        }
+        if (record[1] == VALUE) {
+            _liveBytes[sector] += size;
+            _index[key] = entry{base + offset, valueLength};
+        } else if (it != _index.end()) {
+            _index.erase(it);
+        }
+        offset += size;
+    }
+    return offset;
+}
+
+bool KVStore::loadCheckpoint(uint32_t& activeSequence, uint32_t& activeUsed){
+    struct candidate{
+        uint32_t address;
+        uint32_t sequence;
+        uint32_t length;
+        uint32_t crc;
+    };
+    std::vector<candidate> candidates;
+    uint32_t halfSize = checkpointHalfSize();
+    uint32_t newest{0};
+    bool any{false};
+    //! Проход по заголовкам обеих половин: где дописывать следующую точку и какие точки есть
+    for (uint8_t half{0}; half < 2; half++) {
+        uint32_t offset{0};
+        while (offset + CHECKPOINT_HEADER_SIZE <= halfSize) {
+            uint8_t header[CHECKPOINT_HEADER_SIZE];
+            if (!read(checkpointAddress(half) + offset, header, CHECKPOINT_HEADER_SIZE)) {
+                return false;
+            }
+            _stats.mountReadBytes += CHECKPOINT_HEADER_SIZE;
+            if (std::all_of(header, header + CHECKPOINT_HEADER_SIZE, [](uint8_t b){ return b == 0xFF; })) {
+                break;
+            }
+            uint32_t length = getU32(header + 8);
+            if (getU32(header) != CHECKPOINT_MAGIC || length > halfSize - offset - CHECKPOINT_HEADER_SIZE) {
+                //! Мусор после прерванного стирания: дописывать в половину нельзя
+                offset = halfSize;
+                break;
+            }
+            candidates.push_back(candidate{checkpointAddress(half) + offset, getU32(header + 4), length, getU32(header + 12)});
+            if (!any || candidates.back().sequence >= newest) {
+                newest = candidates.back().sequence;
+                _checkpointHalf = half;
+                any = true;
+            }
+            offset += CHECKPOINT_HEADER_SIZE + length;
+            offset = (offset + NORW25Q128::PAGE_SIZE - 1) / NORW25Q128::PAGE_SIZE * NORW25Q128::PAGE_SIZE;
+        }
+        if (!any || _checkpointHalf == half) {
+            _checkpointOffset = offset;
+        }
+    }
+    if (!any) {
+        _checkpointHalf = 0;
+        _checkpointOffset = 0;
+        return false;
+    }
+    _checkpointSequence = newest + 1;
+    std::sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b){ return a.sequence > b.sequence; });
+
+    //! Берется самая новая точка с верной контрольной суммой (последняя могла оборваться)
+    std::vector<uint8_t> payload;
+    for (const candidate& c : candidates) {
+        payload.resize(c.length);
+        uint32_t done{0};
+        while (done < c.length) {
+            uint16_t chunk = static_cast<uint16_t>(std::min<uint32_t>(c.length - done, SECTOR_SIZE));
+            if (!read(c.address + CHECKPOINT_HEADER_SIZE + done, payload.data() + done, chunk)) {
+                return false;
+            }
+            done += chunk;
+        }
+        _stats.mountReadBytes += c.length;
+        if (crc32(0, payload.data(), c.length) == c.crc && c.length >= 12u + 12u * _sectorCount &&
+            getU16(payload.data()) == _sectorCount) {
+            break;
+        }
+        payload.clear();
+    }
+    if (payload.empty()) {
+        return false;
+    }
+    const uint8_t* in = payload.data();
+    uint16_t activeSector = getU16(in + 2);
+    activeUsed = getU32(in + 4);
+    in += 8;
+    std::vector<bool> unchanged(_sectorCount);
+    for (uint16_t s{0}; s < _sectorCount; s++, in += 12) {
+        unchanged[s] = getU32(in) != ERASED_SEQUENCE && getU32(in) == _sequence[s];
+        if (unchanged[s]) {
+            _liveBytes[s] = getU32(in + 4);
+            _usedBytes[s] = getU32(in + 8);
+        }
+    }
+    activeSequence = _sequence[activeSector];
+    if (!unchanged[activeSector]) {
+        //! Активный сектор точки уже стерт: хвост журнала - все более новые сектора
+        activeSequence = getU32(payload.data() + 8 + 12 * activeSector);
+        activeUsed = SECTOR_SIZE;
+    }
+    uint32_t count = getU32(in);
+    in += 4;
+    for (uint32_t i{0}; i < count; i++) {
+        uint8_t keyLength = in[0];
+        std::string key(reinterpret_cast<const char*>(in + 1), keyLength);
+        in += 1 + keyLength;
+        uint32_t address = getU32(in);
+        uint16_t valueLength = getU16(in + 4);
+        in += 6;
+        if (unchanged[sectorOf(address)]) {
+            _index.emplace(std::move(key), entry{address, valueLength});
+        }
+    }
+    return true;
+}
+void KVStore::mount(){
+    _mounted = false;
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return;
+    }
+    _errorCode = error::OK;
+    _index.clear();
+    _sequence.assign(_sectorCount, ERASED_SEQUENCE);
+    _liveBytes.assign(_sectorCount, 0);
+    _usedBytes.assign(_sectorCount, 0);
+    _nextSequence = 0;
+    _checkpointSequence = 0;
+    _checkpointHalf = 0;
+    _checkpointOffset = 0;
+    _sectorsSinceCheckpoint = 0;
+    _stats.mountReadBytes = 0;
+
+    std::vector<uint16_t> order;
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        uint8_t header[SECTOR_HEADER_SIZE];
+        if (!read(sectorAddress(s), header, SECTOR_HEADER_SIZE)) {
+            return;
+        }
+        _stats.mountReadBytes += SECTOR_HEADER_SIZE;
+        if (getU32(header) == SECTOR_MAGIC && getU32(header + 4) != ERASED_SEQUENCE) {
+            _sequence[s] = getU32(header + 4);
+            _nextSequence = std::max(_nextSequence, _sequence[s] + 1);
+            order.push_back(s);
+        } else if (std::any_of(header, header + SECTOR_HEADER_SIZE, [](uint8_t b){ return b != 0xFF; })) {
+            //! Сектор с прерванным стиранием или открытием
+            if (!eraseSector(s)) {
+                return;
+            }
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](uint16_t a, uint16_t b){ return _sequence[a] < _sequence[b]; });
+    uint32_t checkpointSequence{0};
+    uint32_t checkpointUsed{0};
+    bool restored = _checkpointSectors > 0 && loadCheckpoint(checkpointSequence, checkpointUsed);
+    if (_errorCode == error::CHIP_ERROR) {
+        return;
+    }
+    for (uint16_t s : order) {
+        if (restored && _sequence[s] < checkpointSequence) {
+            //! Закрытый до контрольной точки сектор уже учтен
+            continue;
+        }
+        if (restored && _sequence[s] == checkpointSequence) {
+            _usedBytes[s] = scanSector(s, checkpointUsed);
+        } else {
+            _usedBytes[s] = scanSector(s);
+        }
+        if (_errorCode == error::CHIP_ERROR) {
+            return;
+        }
+    }
+    if (order.empty()) {
+        if (!openSector(0)) {
+            return;
+        }
+    } else {
+        _active = order.back();
+    }
+    //! Восстановление резерва после сбоя во время сборки мусора
+    if (freeSectors() == 0 && !collectSector(oldestSector())) {
+        return;
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+}
+void KVStore::format(){
+    _mounted = false;
+    if (!validRegion()) {
+        _errorCode = error::INVALID_REGION;
+        return;
+    }
+    for (uint16_t s{0}; s < _sectorCount + _checkpointSectors; s++) {
+        if (_chip->erase(sectorAddress(s), SECTOR_SIZE) != storageError::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return;
+        }
+        _stats.erases++;
+    }
+    mount();
+}
+void KVStore::checkpoint(){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (_checkpointSectors == 0) { _errorCode = error::NO_CHECKPOINT_AREA; return; }
+    std::vector<uint8_t> data(CHECKPOINT_HEADER_SIZE + 8 + 12 * _sectorCount + 4);
+    uint8_t* out = data.data() + CHECKPOINT_HEADER_SIZE;
+    putU16(out, _sectorCount);
+    putU16(out + 2, _active);
+    putU32(out + 4, _usedBytes[_active]);
+    out += 8;
+    for (uint16_t s{0}; s < _sectorCount; s++, out += 12) {
+        putU32(out, _sequence[s]);
+        putU32(out + 4, _liveBytes[s]);
+        putU32(out + 8, _usedBytes[s]);
+    }
+    putU32(out, static_cast<uint32_t>(_index.size()));
+    for (const auto& item : _index) {
+        data.push_back(static_cast<uint8_t>(item.first.size()));
+        data.insert(data.end(), item.first.begin(), item.first.end());
+        uint8_t location[6];
+        putU32(location, item.second.address);
+        putU16(location + 4, item.second.valueLength);
+        data.insert(data.end(), location, location + 6);
+    }
+    uint32_t length = static_cast<uint32_t>(data.size()) - CHECKPOINT_HEADER_SIZE;
+    if (data.size() > checkpointHalfSize()) { _errorCode = error::CHECKPOINT_TOO_LARGE; return; }
+    putU32(data.data(), CHECKPOINT_MAGIC);
+    putU32(data.data() + 4, _checkpointSequence);
+    putU32(data.data() + 8, length);
+    putU32(data.data() + 12, crc32(0, data.data() + CHECKPOINT_HEADER_SIZE, length));
+
+    //! Текущая половина заполнена: стираем другую, последняя точка остается целой
+    if (_checkpointOffset + data.size() > checkpointHalfSize()) {
+        uint8_t other = _checkpointHalf ^ 1;
+        for (uint32_t offset{0}; offset < checkpointHalfSize(); offset += SECTOR_SIZE) {
+            if (_chip->erase(checkpointAddress(other) + offset, SECTOR_SIZE) != storageError::OK) {
+                _errorCode = error::CHIP_ERROR;
+                return;
+            }
+            _stats.erases++;
+        }
+        _checkpointHalf = other;
+        _checkpointOffset = 0;
+    }
+    //! Заголовок с длиной и CRC пишется первым, оборванная точка не пройдет проверку
+    if (!program(checkpointAddress(_checkpointHalf) + _checkpointOffset, data.data(), static_cast<uint32_t>(data.size()))) {
+        return;
+    }
+    _checkpointOffset += static_cast<uint32_t>(data.size());
+    _checkpointOffset = (_checkpointOffset + NORW25Q128::PAGE_SIZE - 1) / NORW25Q128::PAGE_SIZE * NORW25Q128::PAGE_SIZE;
+    _checkpointSequence++;
+    _sectorsSinceCheckpoint = 0;
+    _stats.checkpoints++;
+    _errorCode = error::OK;
+}
+void KVStore::setCheckpointInterval(uint16_t sectors){
+    _checkpointInterval = sectors;
+}
+void KVStore::checkpointIfDue(){
+    if (_checkpointSectors > 0 && _checkpointInterval > 0 && _sectorsSinceCheckpoint >= _checkpointInterval) {
+        checkpoint();
+    }
+}
+void KVStore::put(const std::string& key, const uint8_t* data, uint16_t length){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (key.empty() || key.size() > MAX_KEY_LENGTH) { _errorCode = error::KEY_TOO_LONG; return; }
+    if (length > MAX_VALUE_LENGTH) { _errorCode = error::VALUE_TOO_LONG; return; }
+    if (data == nullptr && length > 0) { _errorCode = error::NULL_POINTER; return; }
+    if (!appendRecord(VALUE, key, data, length)) {
+        return;
+    }
+    _stats.puts++;
+    _errorCode = error::OK;
+    checkpointIfDue();
+}
+uint16_t KVStore::get(const std::string& key, uint8_t* out, uint16_t capacity){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return 0; }
+    auto it = _index.find(key);
+    if (it == _index.end()) { _errorCode = error::NOT_FOUND; return 0; }
+    uint16_t length = it->second.valueLength;
+    if (length > capacity) { _errorCode = error::BUFFER_TOO_SMALL; return length; }
+    if (length > 0 && out == nullptr) { _errorCode = error::NULL_POINTER; return 0; }
+    //! Значение читается одной транзакцией, заголовок и ключ уже известны из индекса
+    if (length > 0 && !read(it->second.address + RECORD_HEADER_SIZE + key.size(), out, length)) {
+        return 0;
+    }
+    _stats.gets++;
+    _errorCode = error::OK;
+    return length;
+}
+void KVStore::remove(const std::string& key){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (_index.count(key) == 0) { _errorCode = error::NOT_FOUND; return; }
+    if (!appendRecord(TOMBSTONE, key, nullptr, 0)) {
+        return;
+    }
+    _stats.removes++;
+    _errorCode = error::OK;
+    checkpointIfDue();
+}
+bool KVStore::compactStep(uint32_t minGarbage){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return false; }
+    _errorCode = error::OK;
+    uint16_t oldest = oldestSector();
+    if (oldest == _sectorCount || SECTOR_SIZE - SECTOR_HEADER_SIZE - _liveBytes[oldest] < minGarbage) {
+        return false;
+    }
+    //! Если данные не помещаются в активный сектор, открываем следующий, сохраняя резерв
+    if (_liveBytes[oldest] > SECTOR_SIZE - _usedBytes[_active]) {
+        if (freeSectors() < 2 || !openSector(nextErasedSector())) {
+            return false;
+        }
+    }
+    if (!collectSector(oldest)) {
+        return false;
+    }
+    checkpointIfDue();
+    return true;
+}
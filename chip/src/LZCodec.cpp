@@ -0,0 +1,115 @@
+#include "LZCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+uint32_t read32(const uint8_t* in){
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+/*!
+    Записать продолжение длины (значение сверх 15 в токене)
+    \return Указатель за последним байтом или nullptr, если не хватило места
+*/
+uint8_t* putLength(uint8_t* out, const uint8_t* end, uint32_t length){
+    for (; length >= 255; length -= 255) {
+        if (out == end) { return nullptr; }
+        *out++ = 255;
+    }
+    if (out == end) { return nullptr; }
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+/*!
+    Прочитать продолжение длины
+    \return false - данные закончились раньше байта меньше 255
+*/
+bool getLength(const uint8_t*& in, const uint8_t* end, uint32_t& length){
+    uint8_t b;
+    do {
+        if (in == end) { return false; }
+        b = *in++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+}
+
+uint32_t LZCodec::compress(const uint8_t* src, uint32_t length, uint8_t* dst, uint32_t capacity){
+    std::fill(std::begin(_table), std::end(_table), 0u);
+    uint8_t* out = dst;
+    const uint8_t* end = dst + capacity;
+    uint32_t anchor{0};
+    //! Записать литералы [anchor, position) и, если matchLength != 0, совпадение
+    auto emit = [&](uint32_t position, uint32_t offset, uint32_t matchLength){
+        uint32_t literals = position - anchor;
+        if (out == end) { return false; }
+        uint8_t* token = out++;
+        *token = static_cast<uint8_t>(std::min<uint32_t>(literals, 15) << 4);
+        if (literals >= 15 && (out = putLength(out, end, literals - 15)) == nullptr) { return false; }
+        if (uint32_t(end - out) < literals) { return false; }
+        std::memcpy(out, src + anchor, literals);
+        out += literals;
+        if (matchLength == 0) { return true; }
+        if (end - out < 2) { return false; }
+        *out++ = offset & 0xFF;
+        *out++ = (offset >> 8) & 0xFF;
+        uint32_t extra = matchLength - MIN_MATCH;
+        *token |= static_cast<uint8_t>(std::min<uint32_t>(extra, 15));
+        if (extra >= 15 && (out = putLength(out, end, extra - 15)) == nullptr) { return false; }
+        return true;
+    };
+    if (length > MIN_MATCH + LAST_LITERALS) {
+        uint32_t limit = length - LAST_LITERALS;
+        uint32_t i{0};
+        while (i + MIN_MATCH <= limit) {
+            uint32_t sequence = read32(src + i);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+            uint32_t candidate = _table[hash];
+            _table[hash] = i + 1;
+            if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+                i++;
+                continue;
+            }
+            candidate--;
+            uint32_t matchLength{MIN_MATCH};
+            while (i + matchLength < limit && src[candidate + matchLength] == src[i + matchLength]) {
+                matchLength++;
+            }
+            if (!emit(i, i - candidate, matchLength)) { return 0; }
+            i += matchLength;
+            anchor = i;
+        }
+    }
+    if (!emit(length, 0, 0)) { return 0; }
+    return static_cast<uint32_t>(out - dst);
+}
+bool LZCodec::decompress(const uint8_t* src, uint32_t length, uint8_t* dst, uint32_t rawLength){
+    const uint8_t* in = src;
+    const uint8_t* inEnd = src + length;
+    uint32_t out{0};
+    while (in != inEnd) {
+        uint8_t token = *in++;
+        uint32_t literals = token >> 4;
+        if (literals == 15 && !getLength(in, inEnd, literals)) { return false; }
+        if (uint32_t(inEnd - in) < literals || rawLength - out < literals) { return false; }
+        std::memcpy(dst + out, in, literals);
+        in += literals;
+        out += literals;
+        if (in == inEnd) { break; }
+        if (inEnd - in < 2) { return false; }
+        uint32_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        uint32_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !getLength(in, inEnd, matchLength)) { return false; }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > out || rawLength - out < matchLength) { return false; }
+        //! Совпадение может перекрывать само себя (повтор коротких фрагментов), копирование побайтное
+        for (uint32_t k{0}; k < matchLength; k++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+    return out == rawLength;
+}
@@ -0,0 +1,281 @@
+#include "MirroredVolume.h"
+#include <algorithm>
+#include <cassert>
+
+MirroredVolume::MirroredVolume(std::vector<NORW25Q128*> chips){
+    assert(!chips.empty());
+    _geometry = GEOMETRY;
+    _geometry.capacity = chips.front()->info().capacity;
+    for (NORW25Q128* chip : chips) {
+        assert(chip != nullptr);
+        _replicas.push_back(replica{chip, {}});
+        _geometry.capacity = std::min(_geometry.capacity, chip->info().capacity);
+    }
+    const NORW25Q128::deviceInfo& info = chips.front()->info();
+    _geometry.pageSize = static_cast<uint16_t>(info.pageSize);
+    for (uint8_t i{0}; i < STORAGE_ERASE_TYPES; i++) {
+        _geometry.eraseSizes[i] = info.erase[i].size;
+    }
+}
+const StorageGeometry& MirroredVolume::geometry() const{ return _geometry; }
+const MirroredVolume::statistics& MirroredVolume::stats() const{ return _stats; }
+uint32_t MirroredVolume::pending() const{
+    uint32_t count{0};
+    for (const replica& r : _replicas) {
+        count += static_cast<uint32_t>(r.queue.size());
+    }
+    return count;
+}
+uint8_t MirroredVolume::healthyReplicas() const{
+    return static_cast<uint8_t>(std::count_if(_replicas.begin(), _replicas.end(), [](const replica& r){ return !r.failed; }));
+}
+
+void MirroredVolume::service(replica& r){
+    while (!r.queue.empty()) {
+        if (r.started) {
+            if (r.chip->busy()) {
+                return;
+            }
+            r.queue.pop_front();
+            r.started = false;
+            continue;
+        }
+        const operation& op = r.queue.front();
+        if (op.erase) {
+            r.chip->beginErase(op.address, op.length);
+        } else {
+            r.chip->beginPageProgram(op.address, op.data.data(), static_cast<uint16_t>(op.length));
+        }
+        NORW25Q128::error code = r.chip->checkError();
+        if (code != NORW25Q128::error::OK) {
+            if (_asyncError == storageError::OK) {
+                _asyncError = NORW25Q128::toStorageError(code);
+            }
+            //! Неверные параметры одинаковы для всех копий: операция отбрасывается, копия остается в томе
+            if (code == NORW25Q128::error::ADDRESS_OUT_OF_RANGE || code == NORW25Q128::error::BAD_ADDRESS_ALIGNMENT ||
+                code == NORW25Q128::error::NULL_POINTER || code == NORW25Q128::error::UNSUPPORTED_ERASE ||
+                code == NORW25Q128::error::OUT_OF_PAGE) {
+                r.queue.pop_front();
+                continue;
+            }
+            //! Ошибка микросхемы: копия расходится с остальными и исключается до resync()
+            r.failed = true;
+            r.queue.clear();
+            return;
+        }
+        r.started = true;
+    }
+}
+void MirroredVolume::service(){
+    for (replica& r : _replicas) {
+        service(r);
+    }
+}
+storageError MirroredVolume::flush(){
+    for (replica& r : _replicas) {
+        while (!r.queue.empty()) {
+            r.chip->waitReady();
+            service(r);
+        }
+    }
+    storageError result = _asyncError;
+    _asyncError = storageError::OK;
+    return result;
+}
+bool MirroredVolume::overlaps(const replica& r, uint32_t address, uint32_t length){
+    return std::any_of(r.queue.begin(), r.queue.end(), [address, length](const operation& op){
+        return op.address < address + length && address < op.address + op.length;
+    });
+}
+bool MirroredVolume::settle(replica& r, uint32_t address, uint32_t length){
+    while (!r.failed && overlaps(r, address, length)) {
+        r.chip->waitReady();
+        service(r);
+    }
+    return !r.failed;
+}
+storageError MirroredVolume::checkProgram(uint32_t address, uint32_t length, const uint8_t* data){
+    uint8_t current[256];
+    while (healthyReplicas() != 0) {
+        //! Ранг копии: 0 - очередь пуста, 1 - свободна, 2 - занята, 3 - область еще изменяется очередью
+        replica* best{nullptr};
+        uint8_t bestRank{4};
+        for (replica& r : _replicas) {
+            if (r.failed) {
+                continue;
+            }
+            uint8_t rank = overlaps(r, address, length) ? 3 : (r.queue.empty() ? 0 : (r.chip->busy() ? 2 : 1));
+            if (rank < bestRank) {
+                best = &r;
+                bestRank = rank;
+            }
+        }
+        replica& r = *best;
+        if (!settle(r, address, length)) {
+            continue;
+        }
+        for (uint32_t offset{0}; offset < length;) {
+            uint32_t chunk = std::min<uint32_t>(sizeof(current), length - offset);
+            r.chip->readArray(address + offset, static_cast<uint16_t>(chunk), current);
+            if (r.chip->checkError() != NORW25Q128::error::OK) {
+                return NORW25Q128::toStorageError(r.chip->checkError());
+            }
+            for (uint32_t i{0}; i < chunk; i++) {
+                if ((current[i] & data[offset + i]) != data[offset + i]) {
+                    return storageError::NEEDS_ERASE;
+                }
+            }
+            offset += chunk;
+        }
+        service(r);
+        return storageError::OK;
+    }
+    return storageError::DEVICE_ERROR;
+}
+void MirroredVolume::enqueue(const operation& op){
+    for (replica& r : _replicas) {
+        if (!r.failed) {
+            r.queue.push_back(op);
+        }
+    }
+}
+
+storageError MirroredVolume::read(uint32_t address, uint32_t length, uint8_t* out){
+    if (length == 0) { return storageError::OK; }
+    if (out == nullptr) { return storageError::NULL_POINTER; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    uint32_t page = _geometry.pageSize;
+    while (length > 0) {
+        uint32_t chunk = std::min(page - address % page, length);
+        service();
+        //! Ранг копии: 0 - очередь пуста, 1 - свободна по регистру состояния, 2 - занята
+        replica* best{nullptr};
+        uint8_t bestRank{3};
+        for (;;) {
+            for (replica& r : _replicas) {
+                if (r.failed || overlaps(r, address, chunk)) {
+                    continue;
+                }
+                uint8_t rank = r.queue.empty() ? 0 : (r.chip->busy() ? 2 : 1);
+                if (rank < bestRank || (rank == bestRank && r.queue.size() < best->queue.size())) {
+                    best = &r;
+                    bestRank = rank;
+                }
+            }
+            if (best != nullptr) {
+                break;
+            }
+            if (healthyReplicas() == 0) {
+                return _asyncError == storageError::OK ? storageError::DEVICE_ERROR : _asyncError;
+            }
+            //! Во всех копиях область еще записывается: ждать первую операцию каждой копии
+            for (replica& r : _replicas) {
+                if (!r.failed && !r.queue.empty()) {
+                    r.chip->waitReady();
+                    service(r);
+                }
+            }
+        }
+        _stats.reads++;
+        _stats.idleReads += bestRank == 0;
+        _stats.busyReads += bestRank == 2;
+        best->chip->readArray(address, static_cast<uint16_t>(chunk), out);
+        if (best->chip->checkError() != NORW25Q128::error::OK) {
+            return NORW25Q128::toStorageError(best->chip->checkError());
+        }
+        //! Чтение дождалось операции этой копии, следующую можно запускать
+        service(*best);
+        address += chunk; out += chunk; length -= chunk;
+    }
+    return storageError::OK;
+}
+storageError MirroredVolume::program(uint32_t address, uint32_t length, const uint8_t* data){
+    if (length == 0) { return storageError::OK; }
+    if (data == nullptr) { return storageError::NULL_POINTER; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    if (healthyReplicas() == 0) { return storageError::DEVICE_ERROR; }
+    //! NEEDS_ERASE возвращается сразу, как у микросхемы, а не откладывается до flush()
+    storageError check = checkProgram(address, length, data);
+    if (check != storageError::OK) {
+        return check;
+    }
+    uint32_t page = _geometry.pageSize;
+    while (length > 0) {
+        uint32_t chunk = std::min(page - address % page, length);
+        enqueue(operation{false, address, chunk, std::vector<uint8_t>(data, data + chunk)});
+        address += chunk; data += chunk; length -= chunk;
+    }
+    service();
+    return storageError::OK;
+}
+storageError MirroredVolume::erase(uint32_t address, uint32_t length){
+    if (length == 0) { return storageError::OK; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    uint32_t unit = _geometry.minEraseSize();
+    if (unit == 0 || address % unit != 0 || length % unit != 0) {
+        return storageError::BAD_ADDRESS_ALIGNMENT;
+    }
+    if (healthyReplicas() == 0) { return storageError::DEVICE_ERROR; }
+    while (length > 0) {
+        uint32_t size = unit;
+        for (uint32_t candidate : _geometry.eraseSizes) {
+            if (candidate != 0 && address % candidate == 0 && length >= candidate) {
+                size = std::max(size, candidate);
+            }
+        }
+        enqueue(operation{true, address, size, {}});
+        address += size; length -= size;
+    }
+    service();
+    return storageError::OK;
+}
+bool MirroredVolume::replicaFailed(size_t index) const{
+    return index < _replicas.size() && _replicas[index].failed;
+}
+storageError MirroredVolume::resync(size_t index){
+    if (index >= _replicas.size()) {
+        return storageError::ADDRESS_OUT_OF_RANGE;
+    }
+    storageError pendingError = flush();
+    replica& target = _replicas[index];
+    auto source = std::find_if(_replicas.begin(), _replicas.end(), [&target](const replica& r){ return !r.failed && &r != &target; });
+    if (source == _replicas.end()) {
+        _asyncError = pendingError;
+        return target.failed ? storageError::DEVICE_ERROR : storageError::OK;
+    }
+    //! Копируются только отличающиеся блоки стирания; стертые страницы не записываются
+    uint32_t unit = _geometry.minEraseSize();
+    uint32_t page = _geometry.pageSize;
+    std::vector<uint8_t> expected(unit);
+    std::vector<uint8_t> actual(unit);
+    for (uint32_t address{0}; address < _geometry.capacity; address += unit) {
+        if (source->chip->read(address, unit, expected.data()) != storageError::OK) {
+            _asyncError = pendingError;
+            return storageError::DEVICE_ERROR;
+        }
+        if (target.chip->read(address, unit, actual.data()) == storageError::OK && actual == expected) {
+            continue;
+        }
+        target.chip->beginErase(address, unit);
+        target.chip->waitReady();
+        bool ok = target.chip->checkError() == NORW25Q128::error::OK;
+        for (uint32_t offset{0}; ok && offset < unit; offset += page) {
+            const uint8_t* data = expected.data() + offset;
+            if (std::all_of(data, data + page, [this](uint8_t b){ return b == _geometry.eraseValue; })) {
+                continue;
+            }
+            target.chip->pageProgram(address + offset, data, static_cast<uint16_t>(page));
+            ok = target.chip->checkError() == NORW25Q128::error::OK;
+        }
+        if (!ok) {
+            target.failed = true;
+            _asyncError = pendingError;
+            return storageError::DEVICE_ERROR;
+        }
+    }
+    target.queue.clear();
+    target.started = false;
+    target.failed = false;
+    _asyncError = pendingError;
+    return storageError::OK;
+}
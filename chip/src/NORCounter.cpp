@@ -0,0 +1,189 @@
+#include "NORCounter.h"
+#include "AppendPoint.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+NORCounter::NORCounter(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount){
+    assert(chip != nullptr);
+    _chip = chip;
+    _start = startAddress;
+    _sectorCount = sectorCount;
+}
+NORCounter::error NORCounter::checkError(){ return _errorCode; }
+uint32_t NORCounter::value() const{ return _base + _count; }
+uint32_t NORCounter::erases() const{ return _erases; }
+
+uint32_t NORCounter::sectorSize() const{ return _chip->geometry().minEraseSize(); }
+uint32_t NORCounter::sectorAddress(uint16_t sector) const{
+    return _start + uint32_t(sector) * sectorSize();
+}
+bool NORCounter::checkRegion(){
+    const StorageGeometry& geometry = _chip->geometry();
+    uint32_t size = sectorSize();
+    if (_sectorCount < 2 || size == 0 || size % PAGE_SIZE != 0 || geometry.pageSize % PAGE_SIZE != 0 ||
+        _start % size != 0 || uint64_t(_start) + uint64_t(_sectorCount) * size > geometry.capacity) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    return true;
+}
+bool NORCounter::readBase(uint32_t page, uint32_t& base){
+    uint8_t header[PAGE_HEADER_SIZE];
+    _chip->readArray(page, PAGE_HEADER_SIZE, header);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    base = 0;
+    uint32_t check{0};
+    for (uint8_t i{0}; i < 4; i++) {
+        base |= uint32_t(header[i]) << (8 * i);
+        check |= uint32_t(header[4 + i]) << (8 * i);
+    }
+    return base == ~check;
+}
+bool NORCounter::openPage(uint32_t page, uint32_t base){
+    uint8_t header[PAGE_HEADER_SIZE];
+    for (uint8_t i{0}; i < 4; i++) {
+        header[i] = (base >> (8 * i)) & 0xFF;
+        header[4 + i] = (~base >> (8 * i)) & 0xFF;
+    }
+    _chip->pageProgram(page, header, PAGE_HEADER_SIZE);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    _page = page;
+    _base = base;
+    _count = 0;
+    return true;
+}
+bool NORCounter::eraseSector(uint16_t sector){
+    _chip->eraseSector(sectorAddress(sector));
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    _erases++;
+    return true;
+}
+
+void NORCounter::mount(){
+    _mounted = false;
+    if (!checkRegion()) {
+        return;
+    }
+    _errorCode = error::OK;
+    uint16_t current = _sectorCount;
+    uint32_t currentBase{0};
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        uint32_t base{0};
+        bool valid = readBase(sectorAddress(s), base);
+        if (_errorCode != error::OK) {
+            return;
+        }
+        if (valid && (current == _sectorCount || base > currentBase)) {
+            current = s;
+            currentBase = base;
+        }
+    }
+    if (current == _sectorCount) {
+        format();
+        return;
+    }
+    //! Страницы сектора заполняются по порядку: текущая - последняя непустая
+    AppendPointFinder finder{_chip};
+    uint32_t blank = finder.findFirstBlankPage(sectorAddress(current), sectorSize());
+    if (finder.checkError() != AppendPointFinder::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    uint32_t page = blank - PAGE_SIZE;
+    uint32_t base{0};
+    bool valid = readBase(page, base);
+    if (_errorCode != error::OK) {
+        return;
+    }
+    _page = page;
+    if (valid) {
+        uint8_t bits[PAGE_SIZE - PAGE_HEADER_SIZE];
+        _chip->readArray(page + PAGE_HEADER_SIZE, sizeof(bits), bits);
+        if (_chip->checkError() != NORW25Q128::error::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return;
+        }
+        _base = base;
+        _count = 0;
+        for (uint8_t byte : bits) {
+            for (uint8_t bit{0}; bit < 8; bit++) {
+                _count += (byte >> bit & 1) == 0;
+            }
+        }
+    } else {
+        //! Заголовок оборван при записи: предыдущая страница заполнена, эта непригодна
+        readBase(page - PAGE_SIZE, base);
+        _base = base;
+        _count = INCREMENTS_PER_PAGE;
+    }
+    //! Сектора, кроме текущего, должны быть стерты для следующего перехода
+    std::vector<uint8_t> content(sectorSize());
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        if (s == current) {
+            continue;
+        }
+        if (_chip->read(sectorAddress(s), static_cast<uint32_t>(content.size()), content.data()) != storageError::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return;
+        }
+        if (std::any_of(content.begin(), content.end(), [](uint8_t b){ return b != 0xFF; }) && !eraseSector(s)) {
+            return;
+        }
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+}
+void NORCounter::format(uint32_t initial){
+    _mounted = false;
+    if (!checkRegion()) {
+        return;
+    }
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        if (!eraseSector(s)) {
+            return;
+        }
+    }
+    if (!openPage(sectorAddress(0), initial)) {
+        return;
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+}
+void NORCounter::increment(){
+    if (!_mounted) { _errorCode = error::NOT_MOUNTED; return; }
+    if (_count == INCREMENTS_PER_PAGE) {
+        uint32_t next = _page + PAGE_SIZE;
+        uint16_t sector = static_cast<uint16_t>((_page - _start) / sectorSize());
+        if ((next - _start) % sectorSize() != 0) {
+            if (!openPage(next, _base + _count)) {
+                return;
+            }
+        } else {
+            //! Новый сектор открывается до стирания старого, значение не теряется при сбое
+            uint16_t following = (sector + 1) % _sectorCount;
+            if (!openPage(sectorAddress(following), _base + _count) || !eraseSector(sector)) {
+                return;
+            }
+        }
+    }
+    //! Байт термометра с уже сброшенными младшими битами, сбрасывается еще один
+    uint32_t offset = PAGE_HEADER_SIZE + _count / 8;
+    uint8_t byte = static_cast<uint8_t>(0xFF << (_count % 8 + 1));
+    _chip->pageProgram(_page + offset, &byte, 1);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    _count++;
+    _errorCode = error::OK;
+}
@@ -0,0 +1,535 @@
+#include "NORFileSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+namespace {
+void putU32(uint8_t* out, uint32_t value){
+    for (uint8_t i{0}; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+uint32_t getU32(const uint8_t* in){
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+std::string putKey(char prefix, uint32_t id){
+    uint8_t raw[4];
+    putU32(raw, id);
+    return std::string(1, prefix) + std::string(reinterpret_cast<const char*>(raw), 4);
+}
+}
+
+NORFileSystem::NORFileSystem(KVStore* store){
+    assert(store != nullptr);
+    _store = store;
+}
+NORFileSystem::error NORFileSystem::checkError(){ return _errorCode; }
+
+bool NORFileSystem::validPath(const std::string& path){
+    if (path.empty() || path[0] != '/' || path.size() > MAX_PATH_LENGTH) {
+        return false;
+    }
+    if (path.size() == 1) {
+        return true;
+    }
+    return path.back() != '/' && path.find("//") == std::string::npos;
+}
+std::string NORFileSystem::parentOf(const std::string& path){
+    size_t slash = path.rfind('/');
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+std::string NORFileSystem::metaKey(const std::string& path){ return "m" + path; }
+std::string NORFileSystem::chunkKey(uint32_t id, uint32_t index){
+    uint8_t raw[4];
+    putU32(raw, index);
+    return putKey('d', id) + std::string(reinterpret_cast<const char*>(raw), 4);
+}
+std::string NORFileSystem::removalKey(uint32_t id){ return putKey('r', id); }
+bool NORFileSystem::storeFailed(){
+    _errorCode = error::STORE_ERROR;
+    return false;
+}
+
+bool NORFileSystem::loadMeta(const std::string& path, bool& found, objectType& type, uint32_t& id, uint32_t& size){
+    if (path == "/") {
+        found = true;
+        type = DIRECTORY;
+        id = 0;
+        size = 0;
+        return true;
+    }
+    uint8_t meta[META_SIZE];
+    uint16_t length = _store->get(metaKey(path), meta, META_SIZE);
+    if (_store->checkError() == KVStore::error::NOT_FOUND) {
+        found = false;
+        return true;
+    }
+    if (_store->checkError() != KVStore::error::OK || length != META_SIZE) {
+        return storeFailed();
+    }
+    found = true;
+    type = static_cast<objectType>(meta[0]);
+    id = getU32(meta + 1);
+    size = getU32(meta + 5);
+    return true;
+}
+bool NORFileSystem::storeMeta(const std::string& path, objectType type, uint32_t id, uint32_t size){
+    uint8_t meta[META_SIZE];
+    meta[0] = type;
+    putU32(meta + 1, id);
+    putU32(meta + 5, size);
+    _store->put(metaKey(path), meta, META_SIZE);
+    return _store->checkError() == KVStore::error::OK || storeFailed();
+}
+NORFileSystem::handle* NORFileSystem::findOpen(const std::string& path){
+    for (handle& h : _handles) {
+        if (h.used && h.path == path) {
+            return &h;
+        }
+    }
+    return nullptr;
+}
+bool NORFileSystem::checkParent(const std::string& path){
+    std::string parent = parentOf(path);
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(parent, found, type, id, size)) {
+        return false;
+    }
+    if (!found) {
+        _errorCode = error::NOT_FOUND;
+        return false;
+    }
+    //! Созданный, но еще не записанный файл тоже занимает путь
+    if (type != DIRECTORY || findOpen(parent) != nullptr) {
+        _errorCode = error::NOT_A_DIRECTORY;
+        return false;
+    }
+    return true;
+}
+bool NORFileSystem::allocateId(uint32_t& id){
+    if (_nextId == _reservedId) {
+        uint8_t raw[4];
+        putU32(raw, _reservedId + ID_BATCH);
+        _store->put("n", raw, 4);
+        if (_store->checkError() != KVStore::error::OK) {
+            return storeFailed();
+        }
+        _reservedId += ID_BATCH;
+    }
+    id = _nextId++;
+    return true;
+}
+bool NORFileSystem::removeChunks(uint32_t id, uint32_t first){
+    for (const std::string& key : _store->keys(putKey('d', id))) {
+        if (getU32(reinterpret_cast<const uint8_t*>(key.data()) + 5) < first) {
+            continue;
+        }
+        _store->remove(key);
+        if (_store->checkError() != KVStore::error::OK) {
+            return storeFailed();
+        }
+    }
+    return true;
+}
+bool NORFileSystem::finishRemoval(uint32_t id){
+    if (!removeChunks(id, 0)) {
+        return false;
+    }
+    _store->remove(removalKey(id));
+    return _store->checkError() == KVStore::error::OK || storeFailed();
+}
+
+bool NORFileSystem::mount(){
+    _mounted = false;
+    for (handle& h : _handles) {
+        h = handle{};
+    }
+    _store->mount();
+    if (_store->checkError() != KVStore::error::OK) {
+        return storeFailed();
+    }
+    uint8_t raw[4];
+    _reservedId = 1;
+    if (_store->get("n", raw, 4) == 4 && _store->checkError() == KVStore::error::OK) {
+        _reservedId = getU32(raw);
+    } else if (_store->checkError() != KVStore::error::NOT_FOUND) {
+        return storeFailed();
+    }
+    //! Номера, выданные до сбоя, не используются повторно
+    _nextId = _reservedId;
+    for (const std::string& key : _store->keys("r")) {
+        if (!finishRemoval(getU32(reinterpret_cast<const uint8_t*>(key.data()) + 1))) {
+            return false;
+        }
+    }
+    _mounted = true;
+    _errorCode = error::OK;
+    return true;
+}
+bool NORFileSystem::format(){
+    _mounted = false;
+    for (handle& h : _handles) {
+        h = handle{};
+    }
+    _store->format();
+    if (_store->checkError() != KVStore::error::OK) {
+        return storeFailed();
+    }
+    _nextId = 1;
+    _reservedId = 1;
+    _mounted = true;
+    _errorCode = error::OK;
+    return true;
+}
+bool NORFileSystem::mkdir(const std::string& path){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (!validPath(path)) {
+        _errorCode = error::BAD_PATH;
+        return false;
+    }
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(path, found, type, id, size)) {
+        return false;
+    }
+    if (found || findOpen(path) != nullptr) {
+        _errorCode = error::EXISTS;
+        return false;
+    }
+    if (!checkParent(path) || !storeMeta(path, DIRECTORY, 0, 0)) {
+        return false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+bool NORFileSystem::remove(const std::string& path){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (!validPath(path) || path == "/") {
+        _errorCode = error::BAD_PATH;
+        return false;
+    }
+    if (findOpen(path) != nullptr) {
+        _errorCode = error::BUSY;
+        return false;
+    }
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(path, found, type, id, size)) {
+        return false;
+    }
+    if (!found) {
+        _errorCode = error::NOT_FOUND;
+        return false;
+    }
+    if (type == DIRECTORY) {
+        std::string prefix = path + "/";
+        bool openChild = std::any_of(std::begin(_handles), std::end(_handles), [&](const handle& h){
+            return h.used && h.path.compare(0, prefix.size(), prefix) == 0;
+        });
+        if (openChild || !_store->keys(metaKey(prefix)).empty()) {
+            _errorCode = error::NOT_EMPTY;
+            return false;
+        }
+        _store->remove(metaKey(path));
+        if (_store->checkError() != KVStore::error::OK) {
+            return storeFailed();
+        }
+        _errorCode = error::OK;
+        return true;
+    }
+    //! Отметка пишется до удаления метаданных: иначе после сбоя блоки остались бы без владельца
+    _store->put(removalKey(id), nullptr, 0);
+    if (_store->checkError() != KVStore::error::OK) {
+        return storeFailed();
+    }
+    _store->remove(metaKey(path));
+    if (_store->checkError() != KVStore::error::OK) {
+        return storeFailed();
+    }
+    if (!finishRemoval(id)) {
+        return false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+bool NORFileSystem::stat(const std::string& path, objectInfo& info){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return false;
+    }
+    if (!validPath(path)) {
+        _errorCode = error::BAD_PATH;
+        return false;
+    }
+    //! Размер открытого файла учитывает незаписанные данные
+    if (handle* h = findOpen(path)) {
+        info = objectInfo{false, h->size};
+        _errorCode = error::OK;
+        return true;
+    }
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(path, found, type, id, size)) {
+        return false;
+    }
+    if (!found) {
+        _errorCode = error::NOT_FOUND;
+        return false;
+    }
+    info = objectInfo{type == DIRECTORY, size};
+    _errorCode = error::OK;
+    return true;
+}
+std::vector<std::string> NORFileSystem::list(const std::string& path){
+    std::vector<std::string> names;
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return names;
+    }
+    if (!validPath(path)) {
+        _errorCode = error::BAD_PATH;
+        return names;
+    }
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(path, found, type, id, size)) {
+        return names;
+    }
+    if (!found) {
+        _errorCode = error::NOT_FOUND;
+        return names;
+    }
+    if (type != DIRECTORY) {
+        _errorCode = error::NOT_A_DIRECTORY;
+        return names;
+    }
+    std::string prefix = metaKey(path == "/" ? path : path + "/");
+    //! Ключи отсортированы, поэтому и имена; вложенные глубже пропускаются
+    for (const std::string& key : _store->keys(prefix)) {
+        std::string name = key.substr(prefix.size());
+        if (name.find('/') == std::string::npos) {
+            names.push_back(name);
+        }
+    }
+    _errorCode = error::OK;
+    return names;
+}
+
+NORFileSystem::handle* NORFileSystem::getHandle(int32_t file, uint8_t mode){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return nullptr;
+    }
+    if (file < 0 || file >= MAX_OPEN_FILES || !_handles[file].used || (_handles[file].mode & mode) != mode) {
+        _errorCode = error::BAD_HANDLE;
+        return nullptr;
+    }
+    return &_handles[file];
+}
+bool NORFileSystem::flushChunk(handle& h){
+    if (!h.chunkDirty) {
+        return true;
+    }
+    uint32_t base = h.chunkIndex * CHUNK_SIZE;
+    uint16_t length = static_cast<uint16_t>(std::min<uint32_t>(CHUNK_SIZE, h.size - base));
+    _store->put(chunkKey(h.id, h.chunkIndex), h.chunk.data(), length);
+    if (_store->checkError() != KVStore::error::OK) {
+        return storeFailed();
+    }
+    h.chunkDirty = false;
+    return true;
+}
+bool NORFileSystem::loadChunk(handle& h, uint32_t index){
+    if (h.chunkLoaded && h.chunkIndex == index) {
+        return true;
+    }
+    if (!flushChunk(h)) {
+        return false;
+    }
+    h.chunkLoaded = false;
+    std::fill(h.chunk.begin(), h.chunk.end(), 0);
+    //! Блока за концом файла нет в хранилище: проверка по индексу в RAM, без чтения памяти
+    _store->get(chunkKey(h.id, index), h.chunk.data(), CHUNK_SIZE);
+    if (_store->checkError() != KVStore::error::OK && _store->checkError() != KVStore::error::NOT_FOUND) {
+        return storeFailed();
+    }
+    h.chunkIndex = index;
+    h.chunkLoaded = true;
+    return true;
+}
+int32_t NORFileSystem::open(const std::string& path, uint8_t mode){
+    if (!_mounted) {
+        _errorCode = error::NOT_MOUNTED;
+        return -1;
+    }
+    if (!validPath(path) || path == "/") {
+        _errorCode = error::BAD_PATH;
+        return -1;
+    }
+    if ((mode & (READ | WRITE)) == 0 || ((mode & (CREATE | TRUNCATE | APPEND)) != 0 && (mode & WRITE) == 0)) {
+        _errorCode = error::BAD_HANDLE;
+        return -1;
+    }
+    if (findOpen(path) != nullptr) {
+        _errorCode = error::BUSY;
+        return -1;
+    }
+    auto free = std::find_if(std::begin(_handles), std::end(_handles), [](const handle& h){ return !h.used; });
+    if (free == std::end(_handles)) {
+        _errorCode = error::TOO_MANY_OPEN;
+        return -1;
+    }
+    bool found;
+    objectType type;
+    uint32_t id, size;
+    if (!loadMeta(path, found, type, id, size)) {
+        return -1;
+    }
+    bool created = false;
+    if (found && type == DIRECTORY) {
+        _errorCode = error::IS_A_DIRECTORY;
+        return -1;
+    }
+    if (!found) {
+        if ((mode & CREATE) == 0) {
+            _errorCode = error::NOT_FOUND;
+            return -1;
+        }
+        if (!checkParent(path) || !allocateId(id)) {
+            return -1;
+        }
+        size = 0;
+        created = true;
+    } else if ((mode & TRUNCATE) != 0 && size != 0) {
+        //! Сначала метаданные: оставшиеся после сбоя блоки лежат за концом файла и не читаются
+        if (!storeMeta(path, FILE, id, 0) || !removeChunks(id, 0)) {
+            return -1;
+        }
+        size = 0;
+    }
+    handle& h = *free;
+    h = handle{};
+    h.used = true;
+    h.path = path;
+    h.id = id;
+    h.size = size;
+    h.mode = mode;
+    h.chunk.resize(CHUNK_SIZE);
+    h.metaDirty = created;
+    _errorCode = error::OK;
+    return static_cast<int32_t>(free - std::begin(_handles));
+}
+uint32_t NORFileSystem::read(int32_t file, uint8_t* out, uint32_t length){
+    handle* h = getHandle(file, READ);
+    if (h == nullptr) {
+        return 0;
+    }
+    length = std::min(length, h->size - h->position);
+    uint32_t done{0};
+    while (done < length) {
+        uint32_t offset = h->position % CHUNK_SIZE;
+        uint32_t chunk = std::min(CHUNK_SIZE - offset, length - done);
+        if (!loadChunk(*h, h->position / CHUNK_SIZE)) {
+            return done;
+        }
+        std::memcpy(out + done, h->chunk.data() + offset, chunk);
+        done += chunk;
+        h->position += chunk;
+    }
+    _errorCode = error::OK;
+    return done;
+}
+uint32_t NORFileSystem::write(int32_t file, const uint8_t* data, uint32_t length){
+    handle* h = getHandle(file, WRITE);
+    if (h == nullptr) {
+        return 0;
+    }
+    if ((h->mode & APPEND) != 0) {
+        h->position = h->size;
+    }
+    if (length > UINT32_MAX - h->position) {
+        _errorCode = error::FILE_TOO_LARGE;
+        return 0;
+    }
+    uint32_t done{0};
+    while (done < length) {
+        uint32_t index = h->position / CHUNK_SIZE;
+        uint32_t offset = h->position % CHUNK_SIZE;
+        uint32_t chunk = std::min(CHUNK_SIZE - offset, length - done);
+        if (chunk == CHUNK_SIZE) {
+            //! Блок заменяется целиком, прежнее содержимое не читается
+            if ((!h->chunkLoaded || h->chunkIndex != index) && !flushChunk(*h)) {
+                return done;
+            }
+            h->chunkIndex = index;
+            h->chunkLoaded = true;
+        } else if (!loadChunk(*h, index)) {
+            return done;
+        }
+        std::memcpy(h->chunk.data() + offset, data + done, chunk);
+        h->chunkDirty = true;
+        done += chunk;
+        h->position += chunk;
+        if (h->position > h->size) {
+            h->size = h->position;
+            h->metaDirty = true;
+        }
+    }
+    _errorCode = error::OK;
+    return done;
+}
+bool NORFileSystem::seek(int32_t file, uint32_t position){
+    handle* h = getHandle(file, 0);
+    if (h == nullptr) {
+        return false;
+    }
+    if (position > h->size) {
+        _errorCode = error::OUT_OF_RANGE;
+        return false;
+    }
+    h->position = position;
+    _errorCode = error::OK;
+    return true;
+}
+uint32_t NORFileSystem::tell(int32_t file){
+    handle* h = getHandle(file, 0);
+    return h == nullptr ? 0 : h->position;
+}
+bool NORFileSystem::sync(int32_t file){
+    handle* h = getHandle(file, 0);
+    if (h == nullptr) {
+        return false;
+    }
+    //! Данные - до метаданных: новый размер становится виден только вместе с данными
+    if (!flushChunk(*h)) {
+        return false;
+    }
+    if (h->metaDirty) {
+        if (!storeMeta(h->path, FILE, h->id, h->size)) {
+            return false;
+        }
+        h->metaDirty = false;
+    }
+    _errorCode = error::OK;
+    return true;
+}
+bool NORFileSystem::close(int32_t file){
+    if (!sync(file)) {
+        return false;
+    }
+    _handles[file] = handle{};
+    return true;
+}
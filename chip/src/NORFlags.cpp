@@ -0,0 +1,82 @@
+#include "NORFlags.h"
+#include <algorithm>
+#include <cassert>
+
+NORFlags::NORFlags(NORW25Q128* chip, uint32_t startAddress, uint16_t sectorCount){
+    assert(chip != nullptr);
+    _chip = chip;
+    _start = startAddress;
+    _sectorCount = sectorCount;
+}
+NORFlags::error NORFlags::checkError(){ return _errorCode; }
+uint32_t NORFlags::capacity() const{
+    //! Номер флага 32-битный: при больших секторах лишние биты области не используются
+    return static_cast<uint32_t>(std::min<uint64_t>(uint64_t(_sectorCount) * _chip->geometry().minEraseSize() * 8, UINT32_MAX));
+}
+
+bool NORFlags::checkRegion(){
+    uint32_t sectorSize = _chip->geometry().minEraseSize();
+    if (sectorSize == 0 || _start % sectorSize != 0 ||
+        uint64_t(_start) + uint64_t(_sectorCount) * sectorSize > _chip->geometry().capacity) {
+        _errorCode = error::INVALID_REGION;
+        return false;
+    }
+    return true;
+}
+void NORFlags::set(uint32_t index){
+    if (index >= capacity()) {
+        _errorCode = error::INDEX_OUT_OF_RANGE;
+        return;
+    }
+    if (!checkRegion()) {
+        return;
+    }
+    uint32_t address = _start + index / 8;
+    uint8_t byte = _chip->readByte(address);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    //! Флаг уже установлен: цикл записи не нужен
+    if ((byte >> (index % 8) & 1) == 0) {
+        _errorCode = error::OK;
+        return;
+    }
+    //! Уже сброшенные биты байта должны остаться сброшенными в записываемом значении
+    byte &= static_cast<uint8_t>(~(1u << (index % 8)));
+    _chip->pageProgram(address, &byte, 1);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return;
+    }
+    _errorCode = error::OK;
+}
+bool NORFlags::test(uint32_t index){
+    if (index >= capacity()) {
+        _errorCode = error::INDEX_OUT_OF_RANGE;
+        return false;
+    }
+    if (!checkRegion()) {
+        return false;
+    }
+    bool bit = _chip->readBit(_start + index / 8, index % 8);
+    if (_chip->checkError() != NORW25Q128::error::OK) {
+        _errorCode = error::CHIP_ERROR;
+        return false;
+    }
+    _errorCode = error::OK;
+    return !bit;
+}
+void NORFlags::reset(){
+    if (!checkRegion()) {
+        return;
+    }
+    for (uint16_t s{0}; s < _sectorCount; s++) {
+        _chip->eraseSector(_start + uint32_t(s) * _chip->geometry().minEraseSize());
+        if (_chip->checkError() != NORW25Q128::error::OK) {
+            _errorCode = error::CHIP_ERROR;
+            return;
+        }
+    }
+    _errorCode = error::OK;
+}
@@ -0,0 +1,194 @@
+#include "NORScheduler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace {
+bool overlap(const NORScheduler::request& a, const NORScheduler::request& b){
+    return a.address < b.address + b.length && b.address < a.address + a.length;
+}
+}
+
+NORScheduler::NORScheduler(NORW25Q128* chip, uint64_t deadlineNs, std::function<uint64_t()> clock){
+    assert(chip != nullptr);
+    _chip = chip;
+    _deadlineNs = deadlineNs;
+    _clock = clock ? std::move(clock) : [](){
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    };
+}
+size_t NORScheduler::pending() const{ return _queue.size(); }
+const NORScheduler::statistics& NORScheduler::stats() const{ return _stats; }
+void NORScheduler::resetStats(){ _stats = statistics{}; }
+
+bool NORScheduler::submit(request* r){
+    assert(r != nullptr);
+    r->done = false;
+    r->submitted = _clock();
+    storageError result = storageError::OK;
+    const StorageGeometry& geometry = _chip->geometry();
+    uint32_t unit = geometry.minEraseSize();
+    if (r->length == 0 || uint64_t(r->address) + r->length > geometry.capacity) {
+        result = storageError::ADDRESS_OUT_OF_RANGE;
+    } else if ((r->type == operationType::READ && r->out == nullptr) ||
+               (r->type == operationType::PROGRAM && r->data == nullptr)) {
+        result = storageError::NULL_POINTER;
+    } else if (r->type == operationType::ERASE && unit == 0) {
+        result = storageError::NOT_SUPPORTED;
+    } else if (r->type == operationType::ERASE && (r->address % unit != 0 || r->length % unit != 0)) {
+        result = storageError::BAD_ADDRESS_ALIGNMENT;
+    }
+    if (result != storageError::OK) {
+        r->result = result;
+        r->completed = r->submitted;
+        r->done = true;
+        return false;
+    }
+    _queue.push_back({r, _nextSequence++});
+    return true;
+}
+bool NORScheduler::blocked(size_t index) const{
+    const entry& e = _queue[index];
+    for (const entry& other : _queue) {
+        if (other.sequence < e.sequence && overlap(*other.r, *e.r) &&
+            (other.r->type != operationType::READ || e.r->type != operationType::READ)) {
+            return true;
+        }
+    }
+    return false;
+}
+size_t NORScheduler::pick() const{
+    uint64_t now = _clock();
+    size_t oldest = _queue.size();
+    size_t best[CLASS_COUNT];
+    size_t wrap[CLASS_COUNT];
+    std::fill(std::begin(best), std::end(best), _queue.size());
+    std::fill(std::begin(wrap), std::end(wrap), _queue.size());
+    for (size_t i{0}; i < _queue.size(); i++) {
+        if (blocked(i)) {
+            continue;
+        }
+        const request& r = *_queue[i].r;
+        if (now - r.submitted >= _deadlineNs && (oldest == _queue.size() || _queue[i].sequence < _queue[oldest].sequence)) {
+            oldest = i;
+        }
+        //! Лифт: ближайший адрес не ниже позиции, иначе наименьший (возврат к началу)
+        uint8_t c = static_cast<uint8_t>(r.type);
+        size_t& slot = r.address >= _head ? best[c] : wrap[c];
+        if (slot == _queue.size() || r.address < _queue[slot].r->address) {
+            slot = i;
+        }
+    }
+    if (oldest != _queue.size()) {
+        return oldest;
+    }
+    for (uint8_t c{0}; c < CLASS_COUNT; c++) {
+        if (best[c] != _queue.size()) { return best[c]; }
+        if (wrap[c] != _queue.size()) { return wrap[c]; }
+    }
+    //! Первый по порядку запрос ни от кого не зависит, сюда не доходим
+    return 0;
+}
+void NORScheduler::complete(request* r, storageError result){
+    r->result = result;
+    r->completed = _clock();
+    r->done = true;
+    latency& l = _stats.classes[static_cast<uint8_t>(r->type)];
+    uint64_t ns = r->completed - r->submitted;
+    l.count++;
+    l.totalNs += ns;
+    l.maxNs = std::max(l.maxNs, ns);
+}
+void NORScheduler::dispatchReads(){
+    std::vector<NORW25Q128::readSegment> segments;
+    std::vector<request*> reads;
+    for (size_t i{0}; i < _queue.size(); i++) {
+        request* r = _queue[i].r;
+        if (r->type == operationType::READ && !blocked(i)) {
+            segments.push_back({r->address, r->length, r->out});
+            reads.push_back(r);
+        }
+    }
+    _queue.erase(std::remove_if(_queue.begin(), _queue.end(), [&reads](const entry& e){
+        return std::find(reads.begin(), reads.end(), e.r) != reads.end();
+    }), _queue.end());
+    _chip->readv(segments.data(), segments.size());
+    storageError result = NORW25Q128::toStorageError(_chip->checkError());
+    for (request* r : reads) {
+        complete(r, result);
+    }
+    _stats.dispatches++;
+    if (reads.size() > 1) {
+        _stats.mergedReads += reads.size();
+    }
+}
+void NORScheduler::dispatchProgram(size_t index){
+    std::vector<request*> run {_queue[index].r};
+    _queue.erase(_queue.begin() + index);
+    uint32_t start = run[0]->address;
+    uint32_t end = start + run[0]->length;
+    //! Присоединяются готовые записи, начинающиеся точно в конце уже собранной
+    for (bool extended = true; extended;) {
+        extended = false;
+        for (size_t i{0}; i < _queue.size(); i++) {
+            request* r = _queue[i].r;
+            if (r->type == operationType::PROGRAM && r->address == end && !blocked(i)) {
+                run.push_back(r);
+                end += r->length;
+                _queue.erase(_queue.begin() + i);
+                extended = true;
+                break;
+            }
+        }
+    }
+    storageError result;
+    if (run.size() == 1) {
+        result = _chip->program(start, end - start, run[0]->data);
+    } else {
+        std::vector<uint8_t> data(end - start);
+        for (request* r : run) {
+            std::memcpy(data.data() + (r->address - start), r->data, r->length);
+        }
+        result = _chip->program(start, end - start, data.data());
+        _stats.mergedPrograms += run.size() - 1;
+    }
+    for (request* r : run) {
+        complete(r, result);
+    }
+    _head = end;
+    _stats.dispatches++;
+}
+bool NORScheduler::step(){
+    if (_queue.empty()) {
+        return false;
+    }
+    size_t index = pick();
+    const request& chosen = *_queue[index].r;
+    if (_clock() - chosen.submitted >= _deadlineNs) {
+        _stats.deadlineDispatches++;
+    }
+    switch (chosen.type) {
+        case operationType::READ:
+            dispatchReads();
+            break;
+        case operationType::PROGRAM:
+            dispatchProgram(index);
+            break;
+        case operationType::ERASE: {
+            request* r = _queue[index].r;
+            _queue.erase(_queue.begin() + index);
+            complete(r, _chip->erase(r->address, r->length));
+            _head = r->address + r->length;
+            _stats.dispatches++;
+            break;
+        }
+    }
+    return true;
+}
+void NORScheduler::run(){
+    while (step()) {}
+}
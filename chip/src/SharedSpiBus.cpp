@@ -0,0 +1,45 @@
+#include "SharedSpiBus.h"
+#include <cassert>
+#include <thread>
+
+SharedSpiBus::SharedSpiBus(ISpiBus* bus){
+    assert(bus != nullptr);
+    _bus = bus;
+}
+void SharedSpiBus::acquire(uint8_t line){
+    bool contended = !_mutex.try_lock();
+    if (contended) {
+        _mutex.lock();
+    }
+    _stats.transactions++;
+    _stats.contended += contended;
+    _bus->setChipSelect(line, true);
+}
+void SharedSpiBus::release(uint8_t line){
+    _bus->setChipSelect(line, false);
+    _mutex.unlock();
+}
+uint8_t SharedSpiBus::transfer(uint8_t byte){
+    return _bus->transfer(byte);
+}
+SharedSpiBus::statistics SharedSpiBus::stats(){
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _stats;
+}
+
+SpiDevice::SpiDevice(SharedSpiBus* bus, uint8_t line, std::chrono::microseconds pollInterval){
+    assert(bus != nullptr);
+    _bus = bus;
+    _line = line;
+    _pollInterval = pollInterval;
+}
+void SpiDevice::select(){ _bus->acquire(_line); }
+void SpiDevice::deselect(){ _bus->release(_line); }
+uint8_t SpiDevice::transfer(uint8_t byte){ return _bus->transfer(byte); }
+void SpiDevice::idle(){
+    if (_pollInterval.count() == 0) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(_pollInterval);
+    }
+}
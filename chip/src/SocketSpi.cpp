@@ -0,0 +1,349 @@
+#include "SocketSpi.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace {
+bool sendAll(int fd, const uint8_t* data, size_t length){
+    while (length != 0) {
+        ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+bool receiveAll(int fd, uint8_t* data, size_t length){
+    while (length != 0) {
+        ssize_t received = ::recv(fd, data, length, 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        length -= static_cast<size_t>(received);
+    }
+    return true;
+}
+bool makeAddress(const std::string& path, sockaddr_un& address){
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+}
+
+SocketSpiServer::SocketSpiServer(std::vector<IDriver*> devices) : _devices(std::move(devices)) {}
+SocketSpiServer::~SocketSpiServer(){
+    stop();
+}
+SocketSpiServer::error SocketSpiServer::checkError(){ return _errorCode; }
+SocketSpiServer::statistics SocketSpiServer::stats() const{
+    return statistics{_clientCount.load(), _messages.load(), _transactions.load(), _contended.load(), _bytes.load()};
+}
+
+bool SocketSpiServer::start(const std::string& path){
+    stop();
+    sockaddr_un address;
+    if (!makeAddress(path, address)) {
+        _errorCode = error::PATH_TOO_LONG;
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(path.c_str());
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        _errorCode = error::SOCKET_ERROR;
+        return false;
+    }
+    _stopFd = eventfd(0, EFD_CLOEXEC);
+    if (_stopFd < 0) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        _errorCode = error::SOCKET_ERROR;
+        return false;
+    }
+    _listenFd = fd;
+    _path = path;
+    _acceptor = std::thread(&SocketSpiServer::acceptClients, this);
+    _errorCode = error::OK;
+    return true;
+}
+void SocketSpiServer::stop(){
+    if (_listenFd < 0) {
+        return;
+    }
+    //! Поток приема пользуется сокетом и eventfd: они закрываются после его завершения
+    uint64_t value = 1;
+    while (::write(_stopFd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+    _acceptor.join();
+    {
+        //! Потоки клиентов выходят из recv() и закрывают свои сокеты
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        for (client& c : _clients) {
+            if (c.fd >= 0) {
+                ::shutdown(c.fd, SHUT_RDWR);
+            }
+        }
+    }
+    //! Поток приема остановлен, список больше никто не меняет
+    for (client& c : _clients) {
+        c.thread.join();
+    }
+    _clients.clear();
+    ::close(_listenFd);
+    ::close(_stopFd);
+    ::unlink(_path.c_str());
+    _listenFd = -1;
+    _stopFd = -1;
+}
+void SocketSpiServer::acceptClients(){
+    pollfd fds[2] = {{_listenFd, POLLIN, 0}, {_stopFd, POLLIN, 0}};
+    while (true) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0 || (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+            return;
+        }
+        int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        _clientCount++;
+        reapClients();
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        _clients.emplace_back();
+        client& c = _clients.back();
+        c.fd = fd;
+        c.thread = std::thread(&SocketSpiServer::serve, this, &c);
+    }
+}
+void SocketSpiServer::reapClients(){
+    std::list<client> finished;
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        for (auto it = _clients.begin(); it != _clients.end();) {
+            auto next = std::next(it);
+            if (it->done.load(std::memory_order_acquire)) {
+                finished.splice(finished.end(), _clients, it);
+            }
+            it = next;
+        }
+    }
+    for (client& c : finished) {
+        c.thread.join();
+    }
+}
+void SocketSpiServer::serve(client* owner){
+    int fd = owner->fd;
+    std::vector<uint8_t> mosi;
+    std::vector<uint8_t> miso;
+    IDriver* selected = nullptr;
+    while (true) {
+        socketSpiHeader header;
+        if (!receiveAll(fd, reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+            break;
+        }
+        //! Заголовок проверяется до выделения памяти: неверное сообщение - разрыв соединения
+        if (header.line >= _devices.size() || header.length > SOCKET_SPI_MAX_MESSAGE ||
+            header.replyLength > header.length) {
+            break;
+        }
+        mosi.resize(header.length);
+        miso.resize(header.length);
+        if (!receiveAll(fd, mosi.data(), mosi.size())) {
+            break;
+        }
+        _messages++;
+        if (header.flags & SOCKET_SPI_SELECT) {
+            if (selected == nullptr) {
+                if (!_bus.try_lock()) {
+                    _contended++;
+                    _bus.lock();
+                }
+                _transactions++;
+            } else {
+                selected->deselect();
+            }
+            selected = _devices[header.line];
+            selected->select();
+        }
+        if (selected == nullptr) {
+            break;
+        }
+        selected->transferBlock(mosi.data(), miso.data(), header.length);
+        _bytes += header.length;
+        if (header.flags & SOCKET_SPI_DESELECT) {
+            selected->deselect();
+            selected = nullptr;
+            _bus.unlock();
+        }
+        if (header.replyLength != 0 && !sendAll(fd, miso.data() + header.length - header.replyLength, header.replyLength)) {
+            break;
+        }
+    }
+    if (selected != nullptr) {
+        selected->deselect();
+        _bus.unlock();
+    }
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        ::close(fd);
+        owner->fd = -1;
+    }
+    //! Последнее обращение к owner: после этого поток приема может удалить запись
+    owner->done.store(true, std::memory_order_release);
+}
+
+SocketSpiDriver::SocketSpiDriver(uint8_t line) : _line(line), _message(sizeof(socketSpiHeader)) {}
+SocketSpiDriver::~SocketSpiDriver(){
+    disconnect();
+}
+SocketSpiDriver::error SocketSpiDriver::checkError(){ return _errorCode; }
+const SocketSpiDriver::statistics& SocketSpiDriver::stats() const{ return _stats; }
+
+bool SocketSpiDriver::connect(const std::string& path){
+    disconnect();
+    sockaddr_un address;
+    int fd = -1;
+    if (makeAddress(path, address)) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        _errorCode = error::CONNECT_FAILED;
+        return false;
+    }
+    _fd = fd;
+    _errorCode = error::OK;
+    return true;
+}
+void SocketSpiDriver::disconnect(){
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _message.resize(sizeof(socketSpiHeader));
+    _selectPending = false;
+}
+bool SocketSpiDriver::flush(uint8_t flags, uint8_t* reply, uint32_t replyLength){
+    if (_selectPending) {
+        flags |= SOCKET_SPI_SELECT;
+        _selectPending = false;
+    }
+    socketSpiHeader header{flags, _line, 0, static_cast<uint32_t>(_message.size() - sizeof(header)), replyLength};
+    std::memcpy(_message.data(), &header, sizeof(header));
+    bool ok = _fd >= 0 && sendAll(_fd, _message.data(), _message.size()) &&
+              (replyLength == 0 || receiveAll(_fd, reply, replyLength));
+    _message.resize(sizeof(socketSpiHeader));
+    _stats.messages++;
+    if (replyLength != 0) {
+        _stats.roundTrips++;
+    }
+    if (!ok) {
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+            _errorCode = error::IO_ERROR;
+        }
+        if (reply != nullptr) {
+            std::memset(reply, 0xFF, replyLength);
+        }
+    }
+    return ok;
+}
+#else
+SocketSpiServer::SocketSpiServer(std::vector<IDriver*> devices) : _devices(std::move(devices)) {}
+SocketSpiServer::~SocketSpiServer(){}
+SocketSpiServer::error SocketSpiServer::checkError(){ return _errorCode; }
+SocketSpiServer::statistics SocketSpiServer::stats() const{ return statistics{}; }
+bool SocketSpiServer::start(const std::string&){
+    _errorCode = error::SOCKET_ERROR;
+    return false;
+}
+void SocketSpiServer::stop(){}
+void SocketSpiServer::acceptClients(){}
+void SocketSpiServer::reapClients(){}
+void SocketSpiServer::serve(client*){}
+
+SocketSpiDriver::SocketSpiDriver(uint8_t line) : _line(line), _message(sizeof(socketSpiHeader)) {}
+SocketSpiDriver::~SocketSpiDriver(){}
+SocketSpiDriver::error SocketSpiDriver::checkError(){ return _errorCode; }
+const SocketSpiDriver::statistics& SocketSpiDriver::stats() const{ return _stats; }
+bool SocketSpiDriver::connect(const std::string&){
+    _errorCode = error::CONNECT_FAILED;
+    return false;
+}
+void SocketSpiDriver::disconnect(){}
+bool SocketSpiDriver::flush(uint8_t, uint8_t* reply, uint32_t replyLength){
+    _message.resize(sizeof(socketSpiHeader));
+    _selectPending = false;
+    if (reply != nullptr) {
+        std::memset(reply, 0xFF, replyLength);
+    }
+    return false;
+}
+#endif
+
+void SocketSpiDriver::select(){
+    _message.resize(sizeof(socketSpiHeader));
+    _selectPending = true;
+}
+void SocketSpiDriver::deselect(){
+    flush(SOCKET_SPI_DESELECT, nullptr, 0);
+}
+uint8_t SocketSpiDriver::transfer(uint8_t byte){
+    if (_message.size() - sizeof(socketSpiHeader) == SOCKET_SPI_MAX_MESSAGE) {
+        flush(0, nullptr, 0);
+    }
+    _message.push_back(byte);
+    uint8_t reply = 0xFF;
+    flush(0, &reply, 1);
+    return reply;
+}
+void SocketSpiDriver::transferBlock(const uint8_t* tx, uint8_t* rx, uint32_t length){
+    while (length != 0) {
+        //! Сообщение не длиннее SOCKET_SPI_MAX_MESSAGE: заполненное отправляется, блок продолжается в следующем
+        uint32_t queued = static_cast<uint32_t>(_message.size() - sizeof(socketSpiHeader));
+        if (queued == SOCKET_SPI_MAX_MESSAGE) {
+            flush(0, nullptr, 0);
+            queued = 0;
+        }
+        uint32_t chunk = std::min(length, SOCKET_SPI_MAX_MESSAGE - queued);
+        if (tx != nullptr) {
+            _message.insert(_message.end(), tx, tx + chunk);
+            tx += chunk;
+        } else {
+            _message.insert(_message.end(), chunk, 0xFF);
+        }
+        if (rx != nullptr) {
+            flush(0, rx, chunk);
+            rx += chunk;
+        }
+        length -= chunk;
+    }
+}
+void SocketSpiDriver::idle(){
+    std::this_thread::yield();
+}
@@ -0,0 +1,225 @@
+#include "StorageStream.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+StorageStreamBuf::StorageStreamBuf(IStorage* storage, size_t bufferSize){
+    assert(storage != nullptr);
+    assert(bufferSize != 0);
+    _storage = storage;
+    _buffer.resize(bufferSize);
+}
+StorageStreamBuf::~StorageStreamBuf(){
+    flushPutArea();
+}
+storageError StorageStreamBuf::checkError() const{ return _errorCode; }
+
+uint32_t StorageStreamBuf::position() const{
+    if (pbase() != nullptr) {
+        return _base + static_cast<uint32_t>(pptr() - pbase());
+    }
+    if (eback() != nullptr) {
+        return _base + static_cast<uint32_t>(gptr() - eback());
+    }
+    return _base;
+}
+void StorageStreamBuf::dropGetArea(){
+    if (eback() == nullptr) {
+        return;
+    }
+    _base += static_cast<uint32_t>(gptr() - eback());
+    setg(nullptr, nullptr, nullptr);
+}
+bool StorageStreamBuf::flushPutArea(){
+    if (pbase() == nullptr) {
+        return true;
+    }
+    uint32_t length = static_cast<uint32_t>(pptr() - pbase());
+    setp(nullptr, nullptr);
+    if (length != 0) {
+        _errorCode = _storage->program(_base, length, reinterpret_cast<const uint8_t*>(_buffer.data()));
+        if (_errorCode != storageError::OK) {
+            return false;
+        }
+    }
+    _base += length;
+    return true;
+}
+
+StorageStreamBuf::int_type StorageStreamBuf::underflow(){
+    if (!flushPutArea()) {
+        return traits_type::eof();
+    }
+    dropGetArea();
+    uint32_t capacity = _storage->geometry().capacity;
+    if (_base >= capacity) {
+        return traits_type::eof();
+    }
+    uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(_buffer.size(), capacity - _base));
+    _errorCode = _storage->read(_base, length, reinterpret_cast<uint8_t*>(_buffer.data()));
+    if (_errorCode != storageError::OK) {
+        return traits_type::eof();
+    }
+    setg(_buffer.data(), _buffer.data(), _buffer.data() + length);
+    return traits_type::to_int_type(*gptr());
+}
+std::streamsize StorageStreamBuf::xsgetn(char_type* s, std::streamsize count){
+    std::streamsize done{0};
+    while (done < count) {
+        std::streamsize available = egptr() - gptr();
+        if (available > 0) {
+            std::streamsize chunk = std::min(available, count - done);
+            std::memcpy(s + done, gptr(), static_cast<size_t>(chunk));
+            gbump(static_cast<int>(chunk));
+            done += chunk;
+            continue;
+        }
+        //! Длинное чтение - напрямую в буфер вызывающего, одной операцией памяти
+        if (count - done >= static_cast<std::streamsize>(_buffer.size())) {
+            if (!flushPutArea()) {
+                break;
+            }
+            dropGetArea();
+            uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(count - done, _storage->geometry().capacity - _base));
+            if (length == 0) {
+                break;
+            }
+            _errorCode = _storage->read(_base, length, reinterpret_cast<uint8_t*>(s + done));
+            if (_errorCode != storageError::OK) {
+                break;
+            }
+            _base += length;
+            done += length;
+            continue;
+        }
+        if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+            break;
+        }
+    }
+    return done;
+}
+StorageStreamBuf::int_type StorageStreamBuf::overflow(int_type c){
+    dropGetArea();
+    if (!flushPutArea()) {
+        return traits_type::eof();
+    }
+    uint32_t capacity = _storage->geometry().capacity;
+    if (_base >= capacity) {
+        return traits_type::eof();
+    }
+    size_t length = static_cast<size_t>(std::min<uint64_t>(_buffer.size(), capacity - _base));
+    setp(_buffer.data(), _buffer.data() + length);
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+std::streamsize StorageStreamBuf::xsputn(const char_type* s, std::streamsize count){
+    std::streamsize done{0};
+    while (done < count) {
+        std::streamsize available = epptr() - pptr();
+        if (available > 0) {
+            std::streamsize chunk = std::min(available, count - done);
+            std::memcpy(pptr(), s + done, static_cast<size_t>(chunk));
+            pbump(static_cast<int>(chunk));
+            done += chunk;
+            continue;
+        }
+        //! Длинная запись - напрямую из буфера вызывающего
+        if (count - done >= static_cast<std::streamsize>(_buffer.size())) {
+            dropGetArea();
+            if (!flushPutArea()) {
+                break;
+            }
+            uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(count - done, _storage->geometry().capacity - _base));
+            if (length == 0) {
+                break;
+            }
+            _errorCode = _storage->program(_base, length, reinterpret_cast<const uint8_t*>(s + done));
+            if (_errorCode != storageError::OK) {
+                break;
+            }
+            _base += length;
+            done += length;
+            continue;
+        }
+        if (traits_type::eq_int_type(overflow(traits_type::eof()), traits_type::eof())) {
+            break;
+        }
+    }
+    return done;
+}
+int StorageStreamBuf::sync(){
+    return flushPutArea() ? 0 : -1;
+}
+std::streamsize StorageStreamBuf::showmanyc(){
+    uint32_t capacity = _storage->geometry().capacity;
+    uint32_t current = position();
+    return current < capacity ? std::streamsize(capacity - current) : -1;
+}
+StorageStreamBuf::pos_type StorageStreamBuf::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode){
+    int64_t target = offset;
+    if (direction == std::ios_base::cur) {
+        target += position();
+    } else if (direction == std::ios_base::end) {
+        target += _storage->geometry().capacity;
+    }
+    if (target < 0 || target > _storage->geometry().capacity || !flushPutArea()) {
+        return pos_type(off_type(-1));
+    }
+    //! Перемещение внутри прочитанного блока не сбрасывает буфер
+    if (eback() != nullptr && target >= _base && target < _base + (egptr() - eback())) {
+        setg(eback(), eback() + (target - _base), egptr());
+    } else {
+        setg(nullptr, nullptr, nullptr);
+        _base = static_cast<uint32_t>(target);
+    }
+    return pos_type(target);
+}
+StorageStreamBuf::pos_type StorageStreamBuf::seekpos(pos_type position, std::ios_base::openmode which){
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+StorageView::StorageView(IStorage* storage, uint32_t blockSize){
+    assert(storage != nullptr);
+    assert(blockSize != 0);
+    _storage = storage;
+    _blockSize = blockSize;
+    _erased = storage->geometry().eraseValue;
+}
+uint32_t StorageView::size() const{ return _storage->geometry().capacity; }
+storageError StorageView::checkError() const{ return _errorCode; }
+uint32_t StorageView::blockReads() const{ return _blockReads; }
+StorageView::iterator StorageView::begin(){ return iterator(this, 0); }
+StorageView::iterator StorageView::end(){ return iterator(this, size()); }
+void StorageView::invalidate(){
+    _blocks.clear();
+    _block = nullptr;
+    _blockLength = 0;
+}
+
+const uint8_t& StorageView::load(uint32_t address){
+    uint32_t start = address - address % _blockSize;
+    uint32_t length = std::min(_blockSize, size() - std::min(start, size()));
+    if (length == 0) {
+        _errorCode = storageError::ADDRESS_OUT_OF_RANGE;
+        return _erased;
+    }
+    std::unique_ptr<uint8_t[]>& block = _blocks[start];
+    if (block == nullptr) {
+        std::unique_ptr<uint8_t[]> data(new uint8_t[length]);
+        _errorCode = _storage->read(start, length, data.get());
+        if (_errorCode != storageError::OK) {
+            _blocks.erase(start);
+            return _erased;
+        }
+        _blockReads++;
+        block = std::move(data);
+    }
+    _errorCode = storageError::OK;
+    _block = block.get();
+    _blockStart = start;
+    _blockLength = length;
+    return _block[address - start];
+}
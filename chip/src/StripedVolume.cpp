@@ -0,0 +1,97 @@
+#include "StripedVolume.h"
+#include <algorithm>
+#include <cassert>
+
+StripedVolume::StripedVolume(std::vector<NORW25Q128*> chips) : _chips(std::move(chips)){
+    assert(!_chips.empty());
+    uint32_t capacity = _chips.front()->info().capacity;
+    for (NORW25Q128* chip : _chips) {
+        assert(chip != nullptr);
+        capacity = std::min(capacity, chip->info().capacity);
+    }
+    const NORW25Q128::deviceInfo& info = _chips.front()->info();
+    uint32_t count = static_cast<uint32_t>(_chips.size());
+    _geometry = GEOMETRY;
+    _geometry.capacity = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(capacity) * count, NORW25Q128::MAX_CAPACITY));
+    _geometry.pageSize = static_cast<uint16_t>(info.pageSize);
+    for (uint8_t i{0}; i < STORAGE_ERASE_TYPES; i++) {
+        _geometry.eraseSizes[i] = info.erase[i].size * count;
+    }
+}
+uint8_t StripedVolume::chipCount() const{ return static_cast<uint8_t>(_chips.size()); }
+const StorageGeometry& StripedVolume::geometry() const{ return _geometry; }
+
+void StripedVolume::waitAll(){
+    for (NORW25Q128* chip : _chips) {
+        chip->waitReady();
+    }
+}
+storageError StripedVolume::read(uint32_t address, uint32_t length, uint8_t* out){
+    if (length == 0) { return storageError::OK; }
+    if (out == nullptr) { return storageError::NULL_POINTER; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    uint32_t page = _geometry.pageSize;
+    uint32_t count = static_cast<uint32_t>(_chips.size());
+    while (length > 0) {
+        uint32_t logical = address / page;
+        uint32_t chunk = std::min(page - address % page, length);
+        NORW25Q128* chip = _chips[logical % count];
+        chip->readArray(logical / count * page + address % page, static_cast<uint16_t>(chunk), out);
+        if (chip->checkError() != NORW25Q128::error::OK) {
+            return NORW25Q128::toStorageError(chip->checkError());
+        }
+        address += chunk; out += chunk; length -= chunk;
+    }
+    return storageError::OK;
+}
+storageError StripedVolume::program(uint32_t address, uint32_t length, const uint8_t* data){
+    if (length == 0) { return storageError::OK; }
+    if (data == nullptr) { return storageError::NULL_POINTER; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    uint32_t page = _geometry.pageSize;
+    uint32_t count = static_cast<uint32_t>(_chips.size());
+    while (length > 0) {
+        uint32_t logical = address / page;
+        uint32_t chunk = std::min(page - address % page, length);
+        //! Если микросхема еще занята предыдущей страницей, beginPageProgram() дождется ее сам
+        NORW25Q128* chip = _chips[logical % count];
+        chip->beginPageProgram(logical / count * page + address % page, data, static_cast<uint16_t>(chunk));
+        if (chip->checkError() != NORW25Q128::error::OK) {
+            waitAll();
+            return NORW25Q128::toStorageError(chip->checkError());
+        }
+        address += chunk; data += chunk; length -= chunk;
+    }
+    waitAll();
+    return storageError::OK;
+}
+storageError StripedVolume::erase(uint32_t address, uint32_t length){
+    if (length == 0) { return storageError::OK; }
+    if (uint64_t(address) + length > _geometry.capacity) { return storageError::ADDRESS_OUT_OF_RANGE; }
+    uint32_t unit = _geometry.minEraseSize();
+    if (unit == 0 || address % unit != 0 || length % unit != 0) {
+        return storageError::BAD_ADDRESS_ALIGNMENT;
+    }
+    uint32_t count = static_cast<uint32_t>(_chips.size());
+    const NORW25Q128::deviceInfo& info = _chips.front()->info();
+    while (length > 0) {
+        //! Наибольший тип стирания микросхемы, выровненный и помещающийся в остаток
+        uint32_t size = unit / count;
+        for (const NORW25Q128::eraseType& type : info.erase) {
+            uint32_t step = type.size * count;
+            if (type.size != 0 && address % step == 0 && length >= step) {
+                size = std::max(size, type.size);
+            }
+        }
+        for (NORW25Q128* chip : _chips) {
+            chip->beginErase(address / count, size);
+            if (chip->checkError() != NORW25Q128::error::OK) {
+                waitAll();
+                return NORW25Q128::toStorageError(chip->checkError());
+            }
+        }
+        address += size * count; length -= size * count;
+    }
+    waitAll();
+    return storageError::OK;
+}
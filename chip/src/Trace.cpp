@@ -0,0 +1,124 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace {
+//! Строка JSON (имена - литералы, но кавычки и управляющие символы экранируются)
+void writeString(std::ostream& out, const char* text){
+    out << '"';
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            out << ' ';
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+}
+
+TraceRing::TraceRing(size_t capacity){
+    assert(capacity != 0);
+    _events.reset(new event[capacity]);
+    _capacity = capacity;
+    _origin = std::chrono::steady_clock::now();
+}
+uint32_t TraceRing::threadId(){
+    static std::atomic<uint32_t> counter {0};
+    thread_local uint32_t id = ++counter;
+    return id;
+}
+void TraceRing::record(char phase, const char* category, const char* name,
+                       const char* argName0, uint64_t arg0, const char* argName1, uint64_t arg1){
+    uint64_t timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _origin).count());
+    uint64_t index = _next.fetch_add(1, std::memory_order_relaxed);
+    event& e = _events[index % _capacity];
+    e.category = category;
+    e.name = name;
+    e.timestampNs = timestamp;
+    e.thread = threadId();
+    e.phase = phase;
+    e.argNames[0] = argName0;
+    e.argNames[1] = argName1;
+    e.args[0] = arg0;
+    e.args[1] = arg1;
+}
+void TraceRing::begin(const char* category, const char* name, const char* argName0, uint64_t arg0,
+                      const char* argName1, uint64_t arg1){
+    record('B', category, name, argName0, arg0, argName1, arg1);
+}
+void TraceRing::end(const char* category, const char* name){
+    record('E', category, name, nullptr, 0, nullptr, 0);
+}
+void TraceRing::clear(){
+    _next.store(0);
+}
+size_t TraceRing::size() const{
+    return static_cast<size_t>(std::min<uint64_t>(_next.load(), _capacity));
+}
+uint64_t TraceRing::dropped() const{
+    uint64_t next = _next.load();
+    return next > _capacity ? next - _capacity : 0;
+}
+std::vector<TraceRing::event> TraceRing::snapshot() const{
+    uint64_t next = _next.load(std::memory_order_acquire);
+    uint64_t first = next > _capacity ? next - _capacity : 0;
+    std::vector<event> events;
+    events.reserve(static_cast<size_t>(next - first));
+    for (uint64_t i{first}; i < next; i++) {
+        events.push_back(_events[i % _capacity]);
+    }
+    return events;
+}
+bool TraceRing::exportChromeTrace(std::ostream& out) const{
+    std::vector<event> events = snapshot();
+    //! Кольцо заполняется в порядке номеров, а не времени: потоки могли записать события вперемешку
+    std::stable_sort(events.begin(), events.end(),
+        [](const event& a, const event& b){ return a.timestampNs < b.timestampNs; });
+    std::unordered_map<uint32_t, uint32_t> depth;
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const event& e : events) {
+        uint32_t& level = depth[e.thread];
+        if (e.phase == 'E') {
+            if (level == 0) {
+                continue;
+            }
+            level--;
+        } else {
+            level++;
+        }
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        first = false;
+        writeString(out, e.name);
+        out << ",\"cat\":";
+        writeString(out, e.category);
+        out << ",\"ph\":\"" << e.phase << "\",\"ts\":" << e.timestampNs / 1000 << '.';
+        uint64_t fraction = e.timestampNs % 1000;
+        out << char('0' + fraction / 100) << char('0' + fraction / 10 % 10) << char('0' + fraction % 10);
+        out << ",\"pid\":1,\"tid\":" << e.thread;
+        if (e.argNames[0] != nullptr || e.argNames[1] != nullptr) {
+            out << ",\"args\":{";
+            bool firstArg = true;
+            for (uint8_t k{0}; k < 2; k++) {
+                if (e.argNames[k] == nullptr) {
+                    continue;
+                }
+                if (!firstArg) {
+                    out << ',';
+                }
+                firstArg = false;
+                writeString(out, e.argNames[k]);
+                out << ':' << e.args[k];
+            }
+            out << '}';
+        }
+        out << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return static_cast<bool>(out);
+}
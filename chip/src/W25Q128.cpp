@@ -1,42 +1,254 @@
 #include "W25Q128.h"
+#include "CRC32.h"
+#include "Trace.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+//! Категория интервалов трассировки
+constexpr const char* TRACE_CATEGORY = "NORW25Q128";
+//! Передать байт, ответ которого не нужен (драйвер может отложить передачу)
+void send(IDriver* driver, uint8_t byte){
+    driver->transferBlock(&byte, nullptr, 1);
+}
+}
 
 NORW25Q128::NORW25Q128(IDriver* driver){
     assert(driver != nullptr);
     _driver = driver;
 }
 void NORW25Q128::wait(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "wait"};
     while (readStatusReg1() & static_cast<uint8_t>(status::BUSY)) {
+        _driver->idle();
     }
 }
 NORW25Q128::error NORW25Q128::checkError(){ return _errorCode; }
+bool NORW25Q128::busy(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "busy"};
+    if (_pending && !(readStatusReg1() & static_cast<uint8_t>(status::BUSY))) {
+        _pending = false;
+    }
+    return _pending;
+}
+void NORW25Q128::waitReady(){
+    if (_pending) {
+        TraceSpan span{_tracer, TRACE_CATEGORY, "waitReady"};
+        wait();
+        _pending = false;
+    }
+}
 bool NORW25Q128::writeEnable(){
     _driver->select();
-    _driver->transfer(instruction::WRITE_ENABLE);
+    send(_driver, instruction::WRITE_ENABLE);
     _driver->deselect();
     return readStatusReg1() & static_cast<uint8_t>(status::WEL);
 }
 
 void NORW25Q128::sendAddress(uint32_t address){
-    _driver->transfer((address >> 16) & 0xFF);
-    _driver->transfer((address >> 8) & 0xFF);
-    _driver->transfer(address & 0xFF);
+    uint8_t bytes[4] = {static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+                        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+    _driver->transferBlock(bytes + 4 - _info.addressBytes, nullptr, _info.addressBytes);
 }
 uint8_t NORW25Q128::readStatusReg1(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readStatusReg1"};
     _driver->select();
-    _driver->transfer(instruction::READ_STATUS_REG1);
+    send(_driver, instruction::READ_STATUS_REG1);
     uint8_t status = _driver->transfer(0xFF);
     _driver->deselect();
     return status;
 }
+void NORW25Q128::readSFDP(uint32_t address, uint16_t length, uint8_t* out){
+    //! SFDP всегда адресуется 3 байтами и требует 8 холостых тактов
+    _driver->select();
+    send(_driver, instruction::READ_SFDP);
+    send(_driver, (address >> 16) & 0xFF);
+    send(_driver, (address >> 8) & 0xFF);
+    send(_driver, address & 0xFF);
+    send(_driver, 0xFF);
+    for(uint16_t i = 0; i < length; i++){
+        out[i] = _driver->transfer(0xFF);
+    }
+    _driver->deselect();
+}
+bool NORW25Q128::parseBasicTable(const uint32_t* dwords, uint8_t count, deviceInfo& info){
+    //! Обязательны двойные слова 1-9 (JESD216)
+    if (count < 9) {
+        return false;
+    }
+    uint64_t bits = (dwords[1] & 0x80000000u) ? (uint64_t(1) << std::min<uint32_t>(dwords[1] & 0x7FFFFFFFu, 40)) : uint64_t(dwords[1]) + 1;
+    if (bits < 8 * 1024) {
+        return false;
+    }
+    info.capacity = static_cast<uint32_t>(std::min<uint64_t>(bits / 8, MAX_CAPACITY));
+    //! Типы стирания: размер 2^N и инструкция, по два в словах 8 и 9
+    eraseType types[STORAGE_ERASE_TYPES] {};
+    uint8_t found{0};
+    for (uint8_t i{0}; i < STORAGE_ERASE_TYPES; i++) {
+        uint32_t field = (dwords[7 + i / 2] >> (16 * (i % 2))) & 0xFFFF;
+        uint8_t exponent = field & 0xFF;
+        if (exponent == 0 || exponent > 31) {
+            continue;
+        }
+        types[found].size = uint32_t(1) << exponent;
+        types[found].opcode = static_cast<uint8_t>(field >> 8);
+        //! Типовое время: (count + 1) * единица, единицы 1 мс, 16 мс, 128 мс, 1 с
+        if (count >= 10) {
+            static constexpr uint32_t units[4] {1000, 16000, 128000, 1000000};
+            uint32_t time = (dwords[9] >> (4 + 7 * i)) & 0x7F;
+            types[found].typicalUs = ((time & 0x1F) + 1) * units[time >> 5];
+        }
+        found++;
+    }
+    //! Старые таблицы без типов стирания описывают только сектор 4 Кбайт в слове 1
+    if (found == 0 && (dwords[0] & 0x03) == 0x01) {
+        types[0] = {SECTOR_SIZE, static_cast<uint8_t>(dwords[0] >> 8), DEFAULT_INFO.erase[0].typicalUs};
+        found = 1;
+    }
+    if (found == 0) {
+        return false;
+    }
+    std::sort(types, types + found, [](const eraseType& a, const eraseType& b){ return a.size < b.size; });
+    std::copy(std::begin(types), std::end(types), std::begin(info.erase));
+    if (count >= 11) {
+        uint32_t page = uint32_t(1) << ((dwords[10] >> 4) & 0x0F);
+        if (page > UINT16_MAX) {
+            return false;
+        }
+        info.pageSize = page;
+        uint32_t program = (dwords[10] >> 8) & 0x3F;
+        info.pageProgramUs = ((program & 0x1F) + 1) * ((program & 0x20) ? 64 : 8);
+        static constexpr uint32_t chipUnits[4] {16000, 256000, 4000000, 64000000};
+        uint32_t chip = (dwords[10] >> 24) & 0x7F;
+        info.chipEraseUs = ((chip & 0x1F) + 1) * chipUnits[chip >> 5];
+    }
+    //! Драйвер передает данные по одной линии: из режимов чтения доступен 1-1-1 FAST READ
+    info.readDummy = 1;
+    info.sfdp = true;
+    selectAddressing(info, (dwords[0] >> 17) & 0x03, count >= 16 ? dwords[15] >> 24 : 0);
+    return true;
+}
+void NORW25Q128::selectAddressing(deviceInfo& info, uint8_t addressField, uint8_t enterMethods){
+    info.readOpcode = instruction::FAST_READ;
+    info.byteReadOpcode = instruction::READ;
+    info.programOpcode = instruction::PAGE_PROGRAM;
+    if (addressField == 0x02) {
+        info.addressMode = addressing::FOUR_BYTE_ONLY;
+        info.addressBytes = 4;
+        return;
+    }
+    if (info.capacity <= MAX_ADDR + 1) {
+        info.addressMode = addressing::THREE_BYTE;
+        info.addressBytes = 3;
+        return;
+    }
+    info.addressBytes = 4;
+    //! Отдельные инструкции не меняют состояние микросхемы, поэтому предпочтительнее режима 0xB7
+    auto wide = [](uint8_t opcode) -> uint8_t {
+        switch (opcode) {
+            case instruction::SECTOR_ERASE: return instruction::SECTOR_ERASE_4B;
+            case instruction::BLOCK_ERASE_32K: return instruction::BLOCK_ERASE_32K_4B;
+            case instruction::BLOCK_ERASE_64K: return instruction::BLOCK_ERASE_64K_4B;
+            default: return 0;
+        }
+    };
+    bool opcodes = (enterMethods & 0x20) != 0 && std::all_of(std::begin(info.erase), std::end(info.erase),
+        [&wide](const eraseType& type){ return type.size == 0 || wide(type.opcode) != 0; });
+    if (!opcodes) {
+        info.addressMode = addressing::FOUR_BYTE_MODE;
+        return;
+    }
+    info.addressMode = addressing::FOUR_BYTE_OPCODES;
+    info.readOpcode = instruction::FAST_READ_4B;
+    info.byteReadOpcode = instruction::READ_4B;
+    info.programOpcode = instruction::PAGE_PROGRAM_4B;
+    for (eraseType& type : info.erase) {
+        if (type.size != 0) {
+            type.opcode = wide(type.opcode);
+        }
+    }
+}
+void NORW25Q128::detect(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "detect"};
+    waitReady();
+    deviceInfo info {DEFAULT_INFO};
+    _driver->select();
+    send(_driver, instruction::READ_JEDEC_ID);
+    info.manufacturer = _driver->transfer(0xFF);
+    info.memoryType = _driver->transfer(0xFF);
+    info.capacityId = _driver->transfer(0xFF);
+    _driver->deselect();
+
+    uint8_t header[8];
+    readSFDP(0, sizeof(header), header);
+    bool parsed = false;
+    if (header[0] == 'S' && header[1] == 'F' && header[2] == 'D' && header[3] == 'P') {
+        //! Ищется основная таблица (ID 0xFF00) старшей версии
+        uint16_t headers = header[6] + 1;
+        uint8_t best[8] {};
+        for (uint16_t i{0}; i < headers; i++) {
+            uint8_t parameter[8];
+            readSFDP(8 + 8 * i, sizeof(parameter), parameter);
+            if (parameter[0] == 0x00 && parameter[7] == 0xFF && (best[3] == 0 || parameter[2] >= best[2])) {
+                std::copy(parameter, parameter + 8, best);
+            }
+        }
+        if (best[3] != 0) {
+            uint8_t count = std::min<uint8_t>(best[3], 16);
+            uint32_t pointer = best[4] | (best[5] << 8) | (best[6] << 16);
+            uint8_t raw[16 * 4];
+            readSFDP(pointer, count * 4, raw);
+            uint32_t dwords[16] {};
+            for (uint8_t i{0}; i < count; i++) {
+                dwords[i] = raw[4 * i] | (raw[4 * i + 1] << 8) | (raw[4 * i + 2] << 16) | (uint32_t(raw[4 * i + 3]) << 24);
+            }
+            parsed = parseBasicTable(dwords, count, info);
+        }
+    }
+    if (!parsed) {
+        //! Без SFDP объем берется из кода JEDEC ID (2^N байт), остальное - как у W25Q128
+        uint8_t manufacturer = info.manufacturer, memoryType = info.memoryType, capacityId = info.capacityId;
+        info = DEFAULT_INFO;
+        info.manufacturer = manufacturer;
+        info.memoryType = memoryType;
+        info.capacityId = capacityId;
+        if (capacityId >= 0x10 && capacityId <= 0x1F) {
+            info.capacity = uint32_t(1) << capacityId;
+        }
+        selectAddressing(info, 0, 0);
+    }
+    _info = info;
+    if (_info.addressMode == addressing::FOUR_BYTE_MODE) {
+        //! Части микросхем нужен WREN перед 0xB7, WRDI снимает его для остальных
+        _driver->select();
+        send(_driver, instruction::WRITE_ENABLE);
+        _driver->deselect();
+        _driver->select();
+        send(_driver, instruction::ENTER_4B_MODE);
+        _driver->deselect();
+        _driver->select();
+        send(_driver, instruction::WRITE_DISABLE);
+        _driver->deselect();
+    }
+    _geometry.capacity = _info.capacity;
+    _geometry.pageSize = static_cast<uint16_t>(_info.pageSize);
+    for (uint8_t i{0}; i < STORAGE_ERASE_TYPES; i++) {
+        _geometry.eraseSizes[i] = _info.erase[i].size;
+    }
+    _errorCode = parsed ? error::OK : error::NO_SFDP;
+}
 uint8_t NORW25Q128::readByte(uint32_t address){
-    if(address > MAX_ADDR){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readByte", "address", address};
+    if(address > _info.capacity - 1){
         _errorCode = error::ADDRESS_OUT_OF_RANGE;
         return 0;
     }
+    waitReady();
     _driver->select();
-    _driver->transfer(instruction::READ);
+    send(_driver, _info.byteReadOpcode);
     sendAddress(address);
     uint8_t byte = _driver->transfer(0xFF);
     _driver->deselect();
@@ -44,6 +256,7 @@ uint8_t NORW25Q128::readByte(uint32_t address){
     return byte;
 }
 bool NORW25Q128::readBit(uint32_t address, uint8_t index){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readBit", "address", address, "index", index};
     if(index > 7){
         _errorCode = error::INDEX_BIT_OUT_OF_RANGE;
         return false;
@@ -52,47 +265,168 @@ bool NORW25Q128::readBit(uint32_t address, uint8_t index){
     return (byte >> index) & 1;
 }
 void NORW25Q128::readArray(uint32_t address, uint16_t length, uint8_t* out){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readArray", "address", address, "length", length};
     if (length == 0) { _errorCode = error::OK; return; }
     if(out == nullptr){
         _errorCode = error::NULL_POINTER;
         return;
     }
-    if(address + length - 1 > MAX_ADDR){
+    if(uint64_t(address) + length - 1 > _info.capacity - 1){
         _errorCode = error::ADDRESS_OUT_OF_RANGE;
         return;
     }
+    waitReady();
     _driver->select();
-    _driver->transfer(instruction::FAST_READ);
+    send(_driver, _info.readOpcode);
     sendAddress(address);
-    _driver->transfer(0xFF);
-    for(uint16_t i = 0; i < length; i++){
-        out[i] = _driver->transfer(0xFF);
-    }
+    _driver->transferBlock(nullptr, nullptr, _info.readDummy);
+    _driver->transferBlock(nullptr, out, length);
     _driver->deselect();
     _errorCode = error::OK;
 }
+uint32_t NORW25Q128::readGapThreshold() const{
+    return 1u + _info.addressBytes + _info.readDummy;
+}
+uint32_t NORW25Q128::readv(const readSegment* segments, size_t count){
+    return readv(segments, count, readGapThreshold());
+}
+uint32_t NORW25Q128::readv(const readSegment* segments, size_t count, uint32_t maxGap){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "readv", "count", count, "maxGap", maxGap};
+    if (segments == nullptr && count != 0) {
+        _errorCode = error::NULL_POINTER;
+        return 0;
+    }
+    std::vector<const readSegment*> order;
+    order.reserve(count);
+    for (size_t i{0}; i < count; i++) {
+        const readSegment& segment = segments[i];
+        if (segment.length == 0) {
+            continue;
+        }
+        if (segment.out == nullptr) {
+            _errorCode = error::NULL_POINTER;
+            return 0;
+        }
+        if (uint64_t(segment.address) + segment.length - 1 > _info.capacity - 1) {
+            _errorCode = error::ADDRESS_OUT_OF_RANGE;
+            return 0;
+        }
+        order.push_back(&segment);
+    }
+    std::sort(order.begin(), order.end(), [](const readSegment* a, const readSegment* b){ return a->address < b->address; });
+    waitReady();
+    uint32_t transactions{0};
+    for (size_t i{0}; i < order.size(); transactions++) {
+        //! Фрагмент, прочитанный дальше всех: он целиком содержит [свой адрес, position)
+        const readSegment* reach = order[i];
+        uint32_t position = reach->address;
+        _driver->select();
+        send(_driver, _info.readOpcode);
+        sendAddress(position);
+        _driver->transferBlock(nullptr, nullptr, _info.readDummy);
+        for (; i < order.size(); i++) {
+            const readSegment& segment = *order[i];
+            if (segment.address > position && segment.address - position > maxGap) {
+                break;
+            }
+            if (position < segment.address) {
+                _driver->transferBlock(nullptr, nullptr, segment.address - position);
+                position = segment.address;
+            }
+            uint32_t end = segment.address + segment.length;
+            uint32_t copied{0};
+            if (segment.address < position) {
+                copied = std::min(end, position) - segment.address;
+                std::memcpy(segment.out, reach->out + (segment.address - reach->address), copied);
+            }
+            _driver->transferBlock(nullptr, segment.out + copied, segment.length - copied);
+            if (end > position) {
+                position = end;
+                reach = &segment;
+            }
+        }
+        _driver->deselect();
+    }
+    _errorCode = error::OK;
+    return transactions;
+}
+template<class Consumer>
+void NORW25Q128::streamRead(uint32_t address, uint32_t length, Consumer consume){
+    uint8_t chunk[64];
+    waitReady();
+    _driver->select();
+    send(_driver, _info.readOpcode);
+    sendAddress(address);
+    _driver->transferBlock(nullptr, nullptr, _info.readDummy);
+    for (uint32_t offset{0}; offset < length;) {
+        uint32_t size = std::min<uint32_t>(sizeof(chunk), length - offset);
+        _driver->transferBlock(nullptr, chunk, size);
+        if (!consume(chunk, size, offset)) {
+            break;
+        }
+        offset += size;
+    }
+    _driver->deselect();
+}
 bool NORW25Q128::isProgramCompatible(uint32_t address, const uint8_t* data, uint16_t length)
 {
-    for (uint16_t i = 0; i < length; ++i) {
-        uint8_t oldByte = readByte(address + i);
-        if (_errorCode != error::OK) {
-            return false;
-        }
-        if ((oldByte & data[i]) != data[i]) {
-            return false;
+    //! Текущее содержимое читается одной транзакцией, а не по байту
+    bool compatible = true;
+    streamRead(address, length, [data, &compatible](const uint8_t* chunk, uint32_t size, uint32_t offset){
+        for (uint32_t i{0}; i < size; i++) {
+            if ((chunk[i] & data[offset + i]) != data[offset + i]) {
+                compatible = false;
+                return false;
+            }
         }
+        return true;
+    });
+    return compatible;
+}
+bool NORW25Q128::verifyRange(uint32_t address, uint32_t length, uint32_t expected){
+    uint32_t crc{0};
+    streamRead(address, length, [&crc](const uint8_t* chunk, uint32_t size, uint32_t){
+        crc = crc32(crc, chunk, size);
+        return true;
+    });
+    return crc == expected;
+}
+void NORW25Q128::setVerifyWrites(bool enable){ _verifyWrites = enable; }
+bool NORW25Q128::verifyWrites() const{ return _verifyWrites; }
+void NORW25Q128::setTracer(TraceRing* tracer){ _tracer = tracer; }
+uint32_t NORW25Q128::checksum(uint32_t address, uint32_t length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "checksum", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return 0; }
+    if (uint64_t(address) + length - 1 > _info.capacity - 1) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return 0;
     }
-    return true;
+    uint32_t crc{0};
+    streamRead(address, length, [&crc](const uint8_t* chunk, uint32_t size, uint32_t){
+        crc = crc32(crc, chunk, size);
+        return true;
+    });
+    _errorCode = error::OK;
+    return crc;
 }
 
 void NORW25Q128::pageProgram(uint32_t address, const uint8_t* data, uint16_t length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "pageProgram", "address", address, "length", length};
+    beginPageProgram(address, data, length);
+    waitReady();
+    if (_verifyWrites && _errorCode == error::OK && length != 0 && !verifyRange(address, length, crc32(0, data, length))) {
+        _errorCode = error::VERIFY_FAILED;
+    }
+}
+void NORW25Q128::beginPageProgram(uint32_t address, const uint8_t* data, uint16_t length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "beginPageProgram", "address", address, "length", length};
     if (length == 0) { _errorCode = error::OK; return; }
-    if(address + length - 1 > MAX_ADDR || length > 256){
+    if(uint64_t(address) + length - 1 > _info.capacity - 1 || length > _info.pageSize){
         _errorCode = error::ADDRESS_OUT_OF_RANGE;
         return;
     }
-    uint32_t page_off = address & 0xFFu;
-    if (page_off + length > 256u) { 
+    uint32_t page_off = address % _info.pageSize;
+    if (page_off + length > _info.pageSize) { 
         _errorCode = error::OUT_OF_PAGE; 
         return; 
     }
@@ -100,6 +434,7 @@ void NORW25Q128::pageProgram(uint32_t address, const uint8_t* data, uint16_t len
         _errorCode = error::NULL_POINTER;
         return;
     }
+    waitReady();
     if (!isProgramCompatible(address, data, length)) {
         _errorCode = error::NEEDS_ERASE;
         return;
@@ -109,83 +444,163 @@ void NORW25Q128::pageProgram(uint32_t address, const uint8_t* data, uint16_t len
         return;
     }
     _driver->select();
-    _driver->transfer(instruction::PAGE_PROGRAM);
+    send(_driver, _info.programOpcode);
     sendAddress(address);
-    for(uint16_t i = 0; i < length; i++){
-        _driver->transfer(data[i]);
-    }
+    _driver->transferBlock(data, nullptr, length);
     _driver->deselect();
-    wait();
+    _pending = true;
     _errorCode = error::OK;
 }
-void NORW25Q128::eraseSector(uint32_t address){
-    if(address > MAX_ADDR){
+void NORW25Q128::beginErase(uint32_t address, uint32_t size){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "beginErase", "address", address, "size", size};
+    if(address > _info.capacity - 1){
         _errorCode = error::ADDRESS_OUT_OF_RANGE;
         return;
     }
-    if(address % SECTOR_SIZE != 0){
+    const eraseType* type = std::find_if(std::begin(_info.erase), std::end(_info.erase),
+        [size](const eraseType& e){ return e.size == size; });
+    if (size == 0 || type == std::end(_info.erase)) {
+        _errorCode = error::UNSUPPORTED_ERASE;
+        return;
+    }
+    if(address % size != 0){
         _errorCode = error::BAD_ADDRESS_ALIGNMENT;
         return;
     }
+    waitReady();
     if(!writeEnable()){
         _errorCode = error::WRITE_NOT_ENABLED;
         return;
     }
     _driver->select();
-    _driver->transfer(instruction::SECTOR_ERASE);
+    send(_driver, type->opcode);
     sendAddress(address);
     _driver->deselect();
-    wait();
+    _pending = true;
     _errorCode = error::OK;
 }
+void NORW25Q128::eraseSector(uint32_t address){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "eraseSector", "address", address};
+    beginErase(address, _geometry.minEraseSize());
+    waitReady();
+}
 void NORW25Q128::eraseBlock32(uint32_t address){
-    if(address > MAX_ADDR){
-        _errorCode = error::ADDRESS_OUT_OF_RANGE;
-        return;
-    }
-    if(address % BLOCK_32K_SIZE != 0){
-        _errorCode = error::BAD_ADDRESS_ALIGNMENT;
-        return;
-    }
+    TraceSpan span{_tracer, TRACE_CATEGORY, "eraseBlock32", "address", address};
+    beginErase(address, BLOCK_32K_SIZE);
+    waitReady();
+}
+void NORW25Q128::eraseBlock64(uint32_t address){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "eraseBlock64", "address", address};
+    beginErase(address, BLOCK_64K_SIZE);
+    waitReady();
+}
+void NORW25Q128::eraseChip(){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "eraseChip"};
+    waitReady();
     if(!writeEnable()){
         _errorCode = error::WRITE_NOT_ENABLED;
         return;
     }
     _driver->select();
-    _driver->transfer(instruction::BLOCK_ERASE_32K);
-    sendAddress(address);
+    send(_driver, instruction::CHIP_ERASE);
     _driver->deselect();
     wait();
     _errorCode = error::OK;
 }
-void NORW25Q128::eraseBlock64(uint32_t address){
-    if(address > MAX_ADDR){
+storageError NORW25Q128::toStorageError(error code){
+    switch (code) {
+        case error::OK: return storageError::OK;
+        case error::ADDRESS_OUT_OF_RANGE: return storageError::ADDRESS_OUT_OF_RANGE;
+        case error::BAD_ADDRESS_ALIGNMENT: return storageError::BAD_ADDRESS_ALIGNMENT;
+        case error::WRITE_NOT_ENABLED: return storageError::WRITE_NOT_ENABLED;
+        case error::NULL_POINTER: return storageError::NULL_POINTER;
+        case error::NEEDS_ERASE: return storageError::NEEDS_ERASE;
+        default: return storageError::DEVICE_ERROR;
+    }
+}
+const StorageGeometry& NORW25Q128::geometry() const{ return _geometry; }
+const NORW25Q128::deviceInfo& NORW25Q128::info() const{ return _info; }
+storageError NORW25Q128::read(uint32_t address, uint32_t length, uint8_t* out){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "read", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return storageError::OK; }
+    if (out == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return storageError::NULL_POINTER;
+    }
+    if (uint64_t(address) + length - 1 > _info.capacity - 1) {
         _errorCode = error::ADDRESS_OUT_OF_RANGE;
-        return;
+        return storageError::ADDRESS_OUT_OF_RANGE;
     }
-    if(address % BLOCK_64K_SIZE != 0){
-        _errorCode = error::BAD_ADDRESS_ALIGNMENT;
-        return;
+    while (length > 0) {
+        uint16_t chunk = static_cast<uint16_t>(std::min<uint32_t>(length, UINT16_MAX));
+        readArray(address, chunk, out);
+        if (_errorCode != error::OK) {
+            return toStorageError(_errorCode);
+        }
+        address += chunk; out += chunk; length -= chunk;
     }
-    if(!writeEnable()){
-        _errorCode = error::WRITE_NOT_ENABLED;
-        return;
+    return storageError::OK;
+}
+storageError NORW25Q128::program(uint32_t address, uint32_t length, const uint8_t* data){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "program", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return storageError::OK; }
+    if (data == nullptr) {
+        _errorCode = error::NULL_POINTER;
+        return storageError::NULL_POINTER;
     }
-    _driver->select();
-    _driver->transfer(instruction::BLOCK_ERASE_64K);
-    sendAddress(address);
-    _driver->deselect();
-    wait();
-    _errorCode = error::OK;
-}    
-void NORW25Q128::eraseChip(){
-    if(!writeEnable()){
-        _errorCode = error::WRITE_NOT_ENABLED;
-        return;
+    if (uint64_t(address) + length - 1 > _info.capacity - 1) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return storageError::ADDRESS_OUT_OF_RANGE;
     }
-    _driver->select();
-    _driver->transfer(instruction::CHIP_ERASE);
-    _driver->deselect();
-    wait();
-    _errorCode = error::OK;
-}
\ No newline at end of file
+    uint32_t start = address;
+    uint32_t total = length;
+    uint32_t crc{0};
+    while (length > 0) {
+        uint16_t chunk = static_cast<uint16_t>(std::min(_info.pageSize - address % _info.pageSize, length));
+        beginPageProgram(address, data, chunk);
+        if (_errorCode != error::OK) {
+            return toStorageError(_errorCode);
+        }
+        //! CRC считается, пока страница записывается
+        if (_verifyWrites) {
+            crc = crc32(crc, data, chunk);
+        }
+        address += chunk; data += chunk; length -= chunk;
+    }
+    waitReady();
+    //! Весь диапазон проверяется одним чтением
+    if (_verifyWrites && !verifyRange(start, total, crc)) {
+        _errorCode = error::VERIFY_FAILED;
+        return storageError::DEVICE_ERROR;
+    }
+    return storageError::OK;
+}
+storageError NORW25Q128::erase(uint32_t address, uint32_t length){
+    TraceSpan span{_tracer, TRACE_CATEGORY, "erase", "address", address, "length", length};
+    if (length == 0) { _errorCode = error::OK; return storageError::OK; }
+    if (uint64_t(address) + length - 1 > _info.capacity - 1) {
+        _errorCode = error::ADDRESS_OUT_OF_RANGE;
+        return storageError::ADDRESS_OUT_OF_RANGE;
+    }
+    uint32_t unit = _geometry.minEraseSize();
+    if (unit == 0 || address % unit != 0 || length % unit != 0) {
+        _errorCode = error::BAD_ADDRESS_ALIGNMENT;
+        return storageError::BAD_ADDRESS_ALIGNMENT;
+    }
+    while (length > 0) {
+        //! Типы упорядочены по возрастанию, ищется наибольший подходящий
+        uint32_t step = unit;
+        for (const eraseType& type : _info.erase) {
+            if (type.size != 0 && address % type.size == 0 && length >= type.size) {
+                step = std::max(step, type.size);
+            }
+        }
+        beginErase(address, step);
+        waitReady();
+        if (_errorCode != error::OK) {
+            return toStorageError(_errorCode);
+        }
+        address += step; length -= step;
+    }
+    return storageError::OK;
+}